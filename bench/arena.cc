@@ -0,0 +1,72 @@
+// Scratch buffers of a training step: a few hundred fp16 and fp32 buffers
+// of 1 to 256 KiB, each written once and all freed at the end of the step,
+// from std::vector and aligned_buffer against fps::arena and
+// fps::buffer_pool, in ns per buffer.
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+#include "fps/arena.hh"
+#include "fps/fp16_storage_t.hh"
+#include "bench.hh"
+
+int main() {
+  using namespace fps;
+  constexpr std::size_t buffers = 256;
+  std::vector<std::size_t> sizes(buffers);
+  std::uint32_t r = 12345;
+  for (auto &size : sizes) {
+    r = r * 1664525u + 1013904223u;
+    size = std::size_t{512} << (r >> 29);
+  }
+  // Each buffer is written at one element per page, like a kernel's first
+  // touch, without the cost of filling it.
+  const auto touch = [](auto buffer) {
+    for (std::size_t i = 0; i < buffer.size(); i += 1024)
+      buffer[i] = {};
+  };
+  const double vector = bench::ns_per_element(buffers, [&] {
+    std::vector<std::vector<fp16_storage_t>> h;
+    std::vector<std::vector<fp32_storage_t>> f;
+    for (std::size_t i = 0; i < buffers; i += 2) {
+      touch(std::span{h.emplace_back(sizes[i])});
+      touch(std::span{f.emplace_back(sizes[i + 1])});
+    }
+  });
+  const double buffer = bench::ns_per_element(buffers, [&] {
+    std::vector<aligned_buffer<fp16_storage_t>> h;
+    std::vector<aligned_buffer<fp32_storage_t>> f;
+    for (std::size_t i = 0; i < buffers; i += 2) {
+      touch(std::span{h.emplace_back(sizes[i])});
+      touch(std::span{f.emplace_back(sizes[i + 1])});
+    }
+  });
+  arena scratch;
+  const double bump = bench::ns_per_element(buffers, [&] {
+    const arena::scope step(scratch);
+    for (std::size_t i = 0; i < buffers; i += 2) {
+      touch(scratch.allocate<fp16_storage_t>(sizes[i]));
+      touch(scratch.allocate<fp32_storage_t>(sizes[i + 1]));
+    }
+  });
+  buffer_pool pool;
+  std::vector<std::span<fp16_storage_t>> h(buffers / 2);
+  std::vector<std::span<fp32_storage_t>> f(buffers / 2);
+  const double pooled = bench::ns_per_element(buffers, [&] {
+    for (std::size_t i = 0; i < buffers; i += 2) {
+      touch(h[i / 2] = pool.allocate<fp16_storage_t>(sizes[i]));
+      touch(f[i / 2] = pool.allocate<fp32_storage_t>(sizes[i + 1]));
+    }
+    for (std::size_t i = 0; i < buffers / 2; ++i) {
+      pool.deallocate(h[i]);
+      pool.deallocate(f[i]);
+    }
+  });
+  std::printf("%12s %14s %12s %12s  ns/buffer\n", "std::vector",
+              "aligned_buffer", "arena", "buffer_pool");
+  std::printf("%12.1f %14.1f %12.1f %12.1f\n", vector, buffer, bump, pooled);
+  std::printf("arena: %zu KiB high water, %zu KiB reserved; pool: %zu KiB "
+              "high water\n",
+              scratch.stats().high_water >> 10,
+              scratch.stats().reserved >> 10, pool.stats().high_water >> 10);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace bench {
+
+// Runs fn once to warm up, then repeatedly for at least 200 ms; returns the
+// time per call divided by n.
+template <typename Fn_> double ns_per_element(std::size_t n, Fn_ &&fn) {
+  using clock = std::chrono::steady_clock;
+  fn();
+  std::size_t reps = 0;
+  const auto start = clock::now();
+  auto elapsed = clock::duration{};
+  do {
+    fn();
+    ++reps;
+    elapsed = clock::now() - start;
+  } while (elapsed < std::chrono::milliseconds(200));
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         (double(reps) * double(n));
+}
+
+} // namespace bench
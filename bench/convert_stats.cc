@@ -0,0 +1,44 @@
+// Converting fp32 gradients to fp16 and checking them for loss scaling and
+// quantization: float_to_half_n, a pass over the halves for infinities and
+// NaNs and a pass over the floats for absmax, against the fused
+// float_to_half_n_stats, in ns/element for 64 Ki (in cache) and 16 Mi
+// elements.
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+#include "half-private/fp_convert_stats.hh"
+#include "bench.hh"
+
+int main() {
+  std::printf("backend: %s, threads: %u\n",
+              half::backend_name(half::active_backend()),
+              half::active_executor().concurrency());
+  std::printf("%10s %14s %10s\n", "elements", "three passes", "fused");
+  for (const std::size_t n : {std::size_t{1} << 16, std::size_t{1} << 24}) {
+    std::vector<std::uint32_t> f(n);
+    std::vector<std::uint16_t> h(n);
+    std::uint32_t r = 12345;
+    for (std::size_t i = 0; i < n; ++i) {
+      r = r * 1664525u + 1013904223u;
+      f[i] = (r & 0x807fffffu) | ((0x60u + (r >> 27)) << 23);
+    }
+    volatile std::size_t sink = 0;
+    const double separate = bench::ns_per_element(n, [&] {
+      half::float_to_half_n(f, h);
+      std::size_t nonfinite = 0;
+      for (const std::uint16_t v : h)
+        nonfinite += (v & 0x7c00) == 0x7c00;
+      std::uint32_t absmax = 0;
+      for (const std::uint32_t v : f)
+        absmax = std::max(absmax, v & 0x7fffffffu);
+      sink = nonfinite + absmax;
+    });
+    const double fused = bench::ns_per_element(n, [&] {
+      const half::conversion_stats stats = half::float_to_half_n_stats(f, h);
+      sink = stats.overflow + stats.nan + std::size_t(stats.absmax);
+    });
+    std::printf("%10zu %14.3f %10.3f  ns/element\n", n, separate, fused);
+  }
+}
@@ -0,0 +1,72 @@
+// The execution policy overloads on 16 Mi elements: float to half, sum
+// and a table-backed tanh under seq, unseq, par and par_unseq, against
+// std::transform / std::reduce with par_unseq over the scalar functions,
+// in ns per element.
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <execution>
+#include <numeric>
+#include <vector>
+
+#include "half-private/execution.hh"
+#include "bench.hh"
+
+namespace {
+
+template <typename Policy_>
+void run(const char *name, const Policy_ &policy,
+         const std::vector<std::uint32_t> &f, std::vector<std::uint16_t> &h,
+         const std::vector<numeric::float16_t> &x,
+         std::vector<numeric::float16_t> &y) {
+  const std::size_t n = f.size();
+  volatile float sink = 0.0f;
+  const double f2h = bench::ns_per_element(
+    n, [&] { half::float_to_half_n(policy, f, h); });
+  const double sum =
+    bench::ns_per_element(n, [&] { sink = numeric::sum(policy, x); });
+  const double tanh = bench::ns_per_element(n, [&] {
+    numeric::table::tanh(policy, std::span<const numeric::float16_t>(x), y);
+  });
+  std::printf("%24s %10.3f %10.3f %10.3f\n", name, f2h, sum, tanh);
+}
+
+} // namespace
+
+int main() {
+  constexpr std::size_t n = std::size_t{1} << 24;
+  std::vector<std::uint32_t> f(n);
+  std::vector<std::uint16_t> h(n);
+  std::vector<numeric::float16_t> x(n), y(n);
+  std::uint32_t r = 12345;
+  for (std::size_t i = 0; i < n; ++i) {
+    r = r * 1664525u + 1013904223u;
+    f[i] = (r >> 9) | 0x3f000000u;
+    x[i] = numeric::float16_t{std::uint16_t(0x3800 | (r >> 22))};
+  }
+  std::printf("backend: %s, threads: %u\n",
+              half::backend_name(half::active_backend()),
+              half::active_executor().concurrency());
+  std::printf("%24s %10s %10s %10s  ns/element\n", "", "f2h", "sum", "tanh");
+  run("seq", std::execution::seq, f, h, x, y);
+  run("unseq", std::execution::unseq, f, h, x, y);
+  run("par", std::execution::par, f, h, x, y);
+  run("par_unseq", std::execution::par_unseq, f, h, x, y);
+
+  volatile float sink = 0.0f;
+  const double f2h = bench::ns_per_element(n, [&] {
+    std::transform(std::execution::par_unseq, f.begin(), f.end(), h.begin(),
+                   [](std::uint32_t v) { return half::float_to_half(v); });
+  });
+  const double sum = bench::ns_per_element(n, [&] {
+    sink = std::transform_reduce(std::execution::par_unseq, x.begin(),
+                                 x.end(), 0.0f, std::plus<>{},
+                                 [](numeric::float16_t v) { return float(v); });
+  });
+  const double tanh = bench::ns_per_element(n, [&] {
+    std::transform(std::execution::par_unseq, x.begin(), x.end(), y.begin(),
+                   [](numeric::float16_t v) { return numeric::tanh(v); });
+  });
+  std::printf("%24s %10.3f %10.3f %10.3f\n", "std:: par_unseq, scalar", f2h,
+              sum, tanh);
+}
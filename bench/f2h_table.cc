@@ -0,0 +1,36 @@
+// float -> half: branchless emulation vs the base/shift tables.
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+#include "half-private/fp_convert_base_shift.hh"
+#include "half-private/fp_convert_n.hh"
+#include "bench.hh"
+
+int main() {
+  std::printf("backend: %s\n", half::backend_name(half::active_backend()));
+  std::printf("%10s %12s %12s %12s\n", "elements", "emulated", "table",
+              "emulated_n");
+  for (std::size_t n : {std::size_t{1} << 12, std::size_t{1} << 15,
+                        std::size_t{1} << 24}) {
+    std::vector<std::uint32_t> f(n);
+    std::uint32_t x = 12345;
+    for (auto &v : f) {
+      x = x * 1664525u + 1013904223u;
+      v = x;
+    }
+    std::vector<std::uint16_t> h(n);
+    const double emulated = bench::ns_per_element(n, [&] {
+      for (std::size_t i = 0; i < n; ++i)
+        h[i] = half::float_to_half(f[i]);
+    });
+    const double table = bench::ns_per_element(n, [&] {
+      for (std::size_t i = 0; i < n; ++i)
+        h[i] = half::half_private::_float_to_half_table(f[i]);
+    });
+    const double emulated_n =
+      bench::ns_per_element(n, [&] { half::float_to_half_n(f, h); });
+    std::printf("%10zu %12.3f %12.3f %12.3f  ns/element\n", n, emulated,
+                table, emulated_n);
+  }
+}
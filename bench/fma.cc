@@ -0,0 +1,51 @@
+// x * y + z on halves: through float and std::fma (what numeric::fma used
+// to do, rounding twice), half_fma, and the dispatched fma_n.
+#include <bit>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "half-private/arith_n.hh"
+#include "half-private/fp_convert.hh"
+#include "bench.hh"
+
+namespace {
+
+float half_value(std::uint16_t h) {
+  return std::bit_cast<float>(half::half_to_float(h));
+}
+
+} // namespace
+
+int main() {
+  std::printf("backend: %s\n", half::backend_name(half::active_backend()));
+  std::printf("%10s %12s %12s %12s\n", "elements", "float_fma", "half_fma",
+              "fma_n");
+  for (std::size_t n : {std::size_t{1} << 12, std::size_t{1} << 15,
+                        std::size_t{1} << 22}) {
+    std::vector<std::uint16_t> x(n), y(n), z(n);
+    std::uint32_t r = 12345;
+    for (std::size_t i = 0; i < n; ++i) {
+      r = r * 1664525u + 1013904223u;
+      x[i] = static_cast<std::uint16_t>(r >> 16);
+      r = r * 1664525u + 1013904223u;
+      y[i] = static_cast<std::uint16_t>(r >> 16);
+      z[i] = static_cast<std::uint16_t>(r);
+    }
+    std::vector<std::uint16_t> out(n);
+    const double float_fma = bench::ns_per_element(n, [&] {
+      for (std::size_t i = 0; i < n; ++i)
+        out[i] = half::float_to_half(std::bit_cast<std::uint32_t>(std::fma(
+          half_value(x[i]), half_value(y[i]), half_value(z[i]))));
+    });
+    const double half_fma = bench::ns_per_element(n, [&] {
+      for (std::size_t i = 0; i < n; ++i)
+        out[i] = half::half_fma(x[i], y[i], z[i]);
+    });
+    const double fma_n =
+      bench::ns_per_element(n, [&] { half::fma_n(x, y, z, out); });
+    std::printf("%10zu %12.3f %12.3f %12.3f  ns/element\n", n, float_fma,
+                half_fma, fma_n);
+  }
+}
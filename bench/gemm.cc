@@ -0,0 +1,83 @@
+// Square matrix products in GFLOP/s: fps::gemm on fp16 A and B with fp32
+// and fp16 C against fp32 GEMM on the same machine, a cache-friendly i-k-j
+// loop over floats (up to 1024) and, when the build found a BLAS, its sgemm
+// on the same values converted to fp32.
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+#include "fps/gemm.hh"
+#include "bench.hh"
+
+#ifdef FLOAT16_T_BENCH_BLAS
+extern "C" void sgemm_(const char *transa, const char *transb, const int *m,
+                       const int *n, const int *k, const float *alpha,
+                       const float *a, const int *lda, const float *b,
+                       const int *ldb, const float *beta, float *c,
+                       const int *ldc);
+#endif
+
+int main() {
+  using namespace fps;
+  std::printf("backend: %s, threads: %u\n",
+              half::backend_name(half::active_backend()),
+              std::thread::hardware_concurrency());
+  std::printf("%6s %12s %12s %14s %14s  GFLOP/s\n", "n", "i-k-j fp32",
+              "sgemm fp32", "gemm fp16>32", "gemm fp16>16");
+  for (std::size_t n : {128, 256, 512, 1024, 2048}) {
+    std::vector<fp16_storage_t> a(n * n), b(n * n), c16(n * n);
+    std::vector<fp32_storage_t> c32(n * n);
+    std::vector<float> af(n * n), bf(n * n), cf(n * n);
+    std::uint32_t r = 12345;
+    for (std::size_t i = 0; i < n * n; ++i) {
+      r = r * 1664525u + 1013904223u;
+      const float a_i = float(r >> 8) * 0x1p-23f - 1.0f;
+      r = r * 1664525u + 1013904223u;
+      const float b_i = float(r >> 8) * 0x1p-23f - 1.0f;
+      a[i] = convert_f2h(std::bit_cast<fp32_storage_t>(a_i));
+      b[i] = convert_f2h(std::bit_cast<fp32_storage_t>(b_i));
+      af[i] = std::bit_cast<float>(convert_h2f(a[i]));
+      bf[i] = std::bit_cast<float>(convert_h2f(b[i]));
+    }
+    const double flop = 2.0 * double(n) * double(n) * double(n);
+    double ikj = 0.0;
+    if (n <= 1024)
+      ikj = flop / bench::ns_per_element(1, [&] {
+              std::fill(cf.begin(), cf.end(), 0.0f);
+              for (std::size_t i = 0; i < n; ++i)
+                for (std::size_t p = 0; p < n; ++p) {
+                  const float a_ip = af[i * n + p];
+                  for (std::size_t j = 0; j < n; ++j)
+                    cf[i * n + j] += a_ip * bf[p * n + j];
+                }
+            });
+    double blas = 0.0;
+#ifdef FLOAT16_T_BENCH_BLAS
+    blas = flop / bench::ns_per_element(1, [&] {
+             // Column major, so C^T = B^T A^T gives the row major product.
+             const int size = int(n);
+             const float one = 1.0f, zero = 0.0f;
+             sgemm_("N", "N", &size, &size, &size, &one, bf.data(), &size,
+                    af.data(), &size, &zero, cf.data(), &size);
+           });
+#endif
+    const double gemm32 = flop / bench::ns_per_element(1, [&] {
+                            gemm(1.0f, {a.data(), n, n}, {b.data(), n, n},
+                                 0.0f,
+                                 matrix_view<fp32_storage_t>{c32.data(), n, n});
+                          });
+    const double gemm16 = flop / bench::ns_per_element(1, [&] {
+                            gemm(1.0f, {a.data(), n, n}, {b.data(), n, n},
+                                 0.0f,
+                                 matrix_view<fp16_storage_t>{c16.data(), n, n});
+                          });
+    // 0: not measured.
+    char ikj_text[16] = "-", blas_text[16] = "-";
+    if (ikj > 0.0)
+      std::snprintf(ikj_text, sizeof(ikj_text), "%.1f", ikj);
+    if (blas > 0.0)
+      std::snprintf(blas_text, sizeof(blas_text), "%.1f", blas);
+    std::printf("%6zu %12s %12s %14.1f %14.1f\n", n, ikj_text, blas_text,
+                gemm32, gemm16);
+  }
+}
@@ -0,0 +1,121 @@
+// Latency and bandwidth bound products. fps::gemv on an fp16 A (row and
+// column major) against an fp32 A of the same values, with a plain dot
+// product loop and, when the build found a BLAS, its sgemv: from an A that
+// fits L2 out to main memory, in microseconds per product. Then many small
+// products, a gemm call each against one fps::gemm_batched, in GFLOP/s.
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+#include "fps/gemv.hh"
+#include "bench.hh"
+
+#ifdef FLOAT16_T_BENCH_BLAS
+extern "C" void sgemv_(const char *trans, const int *m, const int *n,
+                       const float *alpha, const float *a, const int *lda,
+                       const float *x, const int *incx, const float *beta,
+                       float *y, const int *incy);
+#endif
+
+namespace {
+
+float next(std::uint32_t &r) {
+  r = r * 1664525u + 1013904223u;
+  return float(r >> 8) * 0x1p-23f - 1.0f;
+}
+
+} // namespace
+
+int main() {
+  using namespace fps;
+  std::printf("backend: %s, threads: %u\n",
+              half::backend_name(half::active_backend()),
+              std::thread::hardware_concurrency());
+  std::printf("%6s %12s %12s %12s %12s %10s  us/product\n", "n", "loop fp32",
+              "sgemv fp32", "gemv rows", "gemv cols", "GB/s");
+  for (std::size_t n : {512, 2048, 4096, 8192}) {
+    std::vector<fp16_storage_t> a(n * n), a_t(n * n);
+    std::vector<float> af(n * n), xf(n), yf(n);
+    std::vector<fp32_storage_t> x(n), y(n);
+    std::uint32_t r = 12345;
+    for (std::size_t i = 0; i < n * n; ++i) {
+      a[i] = convert_f2h(std::bit_cast<fp32_storage_t>(next(r)));
+      af[i] = std::bit_cast<float>(convert_h2f(a[i]));
+    }
+    for (std::size_t i = 0; i < n; ++i)
+      for (std::size_t j = 0; j < n; ++j)
+        a_t[i + j * n] = a[i * n + j];
+    for (std::size_t j = 0; j < n; ++j) {
+      xf[j] = next(r);
+      x[j] = std::bit_cast<fp32_storage_t>(xf[j]);
+    }
+    const double loop = 1e-3 * bench::ns_per_element(1, [&] {
+                          for (std::size_t i = 0; i < n; ++i) {
+                            float sum = 0.0f;
+                            for (std::size_t j = 0; j < n; ++j)
+                              sum += af[i * n + j] * xf[j];
+                            yf[i] = sum;
+                          }
+                        });
+    double blas = 0.0;
+#ifdef FLOAT16_T_BENCH_BLAS
+    blas = 1e-3 * bench::ns_per_element(1, [&] {
+             // Column major, so A^T x is the row major product.
+             const int size = int(n), one_step = 1;
+             const float one = 1.0f, zero = 0.0f;
+             sgemv_("T", &size, &size, &one, af.data(), &size, xf.data(),
+                    &one_step, &zero, yf.data(), &one_step);
+           });
+#endif
+    const std::span<const fp32_storage_t> x_span{x};
+    const double rows = 1e-3 * bench::ns_per_element(1, [&] {
+                          gemv(1.0f, {a.data(), n, n}, x_span, 0.0f,
+                               std::span{y});
+                        });
+    const double cols =
+      1e-3 * bench::ns_per_element(1, [&] {
+        gemv(1.0f, {a_t.data(), n, n, 0, layout::col_major}, x_span, 0.0f,
+             std::span{y});
+      });
+    // 0: not measured.
+    char blas_text[16] = "-";
+    if (blas > 0.0)
+      std::snprintf(blas_text, sizeof(blas_text), "%.1f", blas);
+    std::printf("%6zu %12.1f %12s %12.1f %12.1f %10.2f\n", n, loop, blas_text,
+                rows, cols, 2e-3 * double(n * n) / rows);
+  }
+
+  constexpr std::size_t batch = 256;
+  std::printf("\n%6s %6s %12s %14s  GFLOP/s\n", "n", "batch", "gemm loop",
+              "gemm_batched");
+  for (std::size_t n : {8, 16, 32, 64}) {
+    std::vector<fp16_storage_t> a(batch * n * n), b(batch * n * n);
+    std::vector<fp32_storage_t> c(batch * n * n);
+    std::uint32_t r = 12345;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      a[i] = convert_f2h(std::bit_cast<fp32_storage_t>(next(r)));
+      b[i] = convert_f2h(std::bit_cast<fp32_storage_t>(next(r)));
+    }
+    std::vector<matrix_view<const fp16_storage_t>> a_views, b_views;
+    std::vector<matrix_view<fp32_storage_t>> c_views;
+    for (std::size_t p = 0; p < batch; ++p) {
+      a_views.push_back({a.data() + p * n * n, n, n});
+      b_views.push_back({b.data() + p * n * n, n, n});
+      c_views.push_back({c.data() + p * n * n, n, n});
+    }
+    const std::span<const matrix_view<const fp16_storage_t>> a_span{a_views},
+      b_span{b_views};
+    const std::span<const matrix_view<fp32_storage_t>> c_span{c_views};
+    const double flop = 2.0 * double(batch * n * n * n);
+    const double loop = flop / bench::ns_per_element(1, [&] {
+                          for (std::size_t p = 0; p < batch; ++p)
+                            gemm(1.0f, a_views[p], b_views[p], 0.0f,
+                                 c_views[p]);
+                        });
+    const double batched =
+      flop / bench::ns_per_element(1, [&] {
+        gemm_batched(1.0f, a_span, b_span, 0.0f, c_span);
+      });
+    std::printf("%6zu %6zu %12.1f %14.1f\n", n, batch, loop, batched);
+  }
+}
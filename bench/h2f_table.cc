@@ -0,0 +1,39 @@
+// half -> float: branchless emulation vs the 65536 entry table, on buffers
+// that stay in L2 and on buffers that stream from memory.
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+#include "half-private/fp_convert_n.hh"
+#include "half-private/fp_convert_table.hh"
+#include "bench.hh"
+
+int main() {
+  std::printf("backend: %s\n", half::backend_name(half::active_backend()));
+  std::printf("%10s %12s %12s %12s %12s\n", "elements", "emulated",
+              "emulated_n", "table", "table_n");
+  for (std::size_t n : {std::size_t{1} << 12, std::size_t{1} << 15,
+                        std::size_t{1} << 24}) {
+    std::vector<std::uint16_t> h(n);
+    std::uint32_t x = 12345;
+    for (auto &v : h) {
+      x = x * 1664525u + 1013904223u;
+      v = static_cast<std::uint16_t>(x >> 16);
+    }
+    std::vector<std::uint32_t> f(n);
+    const double emulated = bench::ns_per_element(n, [&] {
+      for (std::size_t i = 0; i < n; ++i)
+        f[i] = half::half_to_float(h[i]);
+    });
+    const double emulated_n =
+      bench::ns_per_element(n, [&] { half::half_to_float_n(h, f); });
+    const double table = bench::ns_per_element(n, [&] {
+      for (std::size_t i = 0; i < n; ++i)
+        f[i] = half::half_to_float_table(h[i]);
+    });
+    const double table_n =
+      bench::ns_per_element(n, [&] { half::half_to_float_table_n(h, f); });
+    std::printf("%10zu %12.3f %12.3f %12.3f %12.3f  ns/element\n", n,
+                emulated, emulated_n, table, table_n);
+  }
+}
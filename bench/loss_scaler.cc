@@ -0,0 +1,73 @@
+// Checking fp16 gradients for loss scaling, on 16 Mi elements: all_finite
+// against std::all_of over numeric::is_finite, and loss_scaler::unscale
+// over 64 buffers against half_mul_n by the inverse scale and then
+// all_finite on each buffer, then against unscaling into fp32 master
+// gradients, in ns/element. The scale is 1, so the gradients keep their
+// values from one run to the next.
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <span>
+#include <vector>
+
+#include "half-private/arith_n.hh"
+#include "half-private/float16_t_loss_scaler.hh"
+#include "bench.hh"
+
+int main() {
+  using numeric::float16_t;
+  constexpr std::size_t n = std::size_t{1} << 24;
+  constexpr std::size_t buffers = 64;
+  std::vector<float16_t> x(n);
+  std::uint32_t r = 12345;
+  for (float16_t &v : x) {
+    r = r * 1664525u + 1013904223u;
+    v = float16_t{std::uint16_t((r >> 16) % 0x7c00 | (r & 0x8000))};
+  }
+  std::vector<float> master(n);
+  std::vector<std::span<float16_t>> spans;
+  std::vector<std::span<const float16_t>> inputs;
+  std::vector<std::span<float>> outputs;
+  for (std::size_t b = 0; b < buffers; ++b) {
+    spans.push_back(std::span<float16_t>(x).subspan(b * (n / buffers),
+                                                    n / buffers));
+    inputs.push_back(spans.back());
+    outputs.push_back(std::span<float>(master).subspan(b * (n / buffers),
+                                                       n / buffers));
+  }
+  std::printf("backend: %s, threads: %u\n",
+              half::backend_name(half::active_backend()),
+              half::active_executor().concurrency());
+
+  volatile bool sink = false;
+  const double all_of = bench::ns_per_element(n, [&] {
+    sink = std::all_of(x.begin(), x.end(),
+                       [](float16_t v) { return numeric::is_finite(v); });
+  });
+  const double all_finite =
+    bench::ns_per_element(n, [&] { sink = numeric::all_finite(x); });
+  std::printf("%24s %10.3f %10.3f  ns/element\n", "all_of, all_finite",
+              all_of, all_finite);
+
+  const numeric::loss_scaler scaler(1.0f);
+  const std::uint16_t inverse_scale = std::uint16_t(float16_t{1.0f});
+  const double separate = bench::ns_per_element(n, [&] {
+    bool finite = true;
+    for (const std::span<float16_t> g : spans) {
+      const std::span<std::uint16_t> bits(
+        reinterpret_cast<std::uint16_t *>(g.data()), g.size());
+      half::half_mul_n(bits, inverse_scale, bits);
+      finite &= numeric::all_finite(g);
+    }
+    sink = finite;
+  });
+  const double fused =
+    bench::ns_per_element(n, [&] { sink = scaler.unscale(spans); });
+  std::printf("%24s %10.3f %10.3f  ns/element\n", "mul + check, unscale",
+              separate, fused);
+
+  const double to_float =
+    bench::ns_per_element(n, [&] { sink = scaler.unscale(inputs, outputs); });
+  std::printf("%24s %10.3f %10.3f  ns/element\n", "unscale, into fp32", fused,
+              to_float);
+}
@@ -0,0 +1,50 @@
+// The bulk span functions on 16 Mi elements (64 MiB of fp32) on thread
+// pools of 1, 2, 4... threads up to the core count, and the smallest span
+// the default grain splits, in GB/s of input and output.
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <thread>
+
+#include "fps/aligned_buffer.hh"
+#include "fps/fp16_storage_t.hh"
+#include "half-private/arith_n.hh"
+#include "bench.hh"
+
+int main() {
+  const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  std::printf("backend: %s, cores: %u, grain: %zu\n",
+              half::backend_name(half::active_backend()), cores,
+              half::parallel_grain());
+  std::printf("%10s %8s %10s %10s %10s  GB/s\n", "elements", "threads",
+              "f2h", "h2f", "add_n");
+  for (const std::size_t n :
+       {2 * half::parallel_grain(), std::size_t{1} << 24}) {
+    fps::aligned_buffer<std::uint32_t> f(n);
+    fps::aligned_buffer<std::uint16_t> x(n), y(n), h(n);
+    std::uint32_t r = 12345;
+    for (std::size_t i = 0; i < n; ++i) {
+      r = r * 1664525u + 1013904223u;
+      f[i] = (r >> 9) | 0x3f000000u;
+      x[i] = std::uint16_t(0x3c00 | (r >> 22));
+      y[i] = std::uint16_t(0x3800 | (r & 0x3ff));
+    }
+    for (unsigned threads = 1;; threads = std::min(cores, 2 * threads)) {
+      half::thread_pool pool(threads);
+      half::set_executor(&pool);
+      // Six bytes moved per element, in bytes per ns.
+      const double bytes = 6 * double(n);
+      const double f2h =
+        bytes / bench::ns_per_element(1, [&] { half::float_to_half_n(f, h); });
+      const double h2f =
+        bytes / bench::ns_per_element(1, [&] { half::half_to_float_n(x, f); });
+      const double add =
+        bytes / bench::ns_per_element(1, [&] { half::half_add_n(x, y, h); });
+      half::set_executor(nullptr);
+      std::printf("%10zu %8u %10.2f %10.2f %10.2f\n", n, threads, f2h, h2f,
+                  add);
+      if (threads == cores)
+        break;
+    }
+  }
+}
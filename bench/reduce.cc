@@ -0,0 +1,42 @@
+// Summing halves: float16_t::operator+= against numeric::sum with each
+// summation, and numeric::dot, from L1-sized spans out to main memory. The
+// last column is the bandwidth of pairwise sum.
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+#include "half-private/float16_t_reduce.hh"
+#include "bench.hh"
+
+int main() {
+  using numeric::summation;
+  std::printf("%10s %12s %12s %12s %12s %12s %10s\n", "elements", "operator+=",
+              "sum fast", "sum pairw.", "sum kahan", "dot", "GB/s");
+  for (std::size_t n : {std::size_t{1} << 12, std::size_t{1} << 16,
+                        std::size_t{1} << 20, std::size_t{1} << 26}) {
+    std::vector<numeric::float16_t> x(n), y(n);
+    std::uint32_t r = 12345;
+    for (std::size_t i = 0; i < n; ++i) {
+      r = r * 1664525u + 1013904223u;
+      x[i] = numeric::float16_t{float(r >> 8) * 0x1p-23f - 1.0f};
+      y[i] = numeric::float16_t{float(r & 0xff) * 0x1p-8f};
+    }
+    volatile float sink = 0.0f;
+    const double naive = bench::ns_per_element(n, [&] {
+      numeric::float16_t total{0.0f};
+      for (const numeric::float16_t &v : x)
+        total += v;
+      sink = float(total);
+    });
+    const double fast = bench::ns_per_element(
+      n, [&] { sink = numeric::sum(x, summation::fast); });
+    const double pairwise =
+      bench::ns_per_element(n, [&] { sink = numeric::sum(x); });
+    const double kahan = bench::ns_per_element(
+      n, [&] { sink = numeric::sum(x, summation::kahan); });
+    const double dot =
+      bench::ns_per_element(n, [&] { sink = numeric::dot(x, y); });
+    std::printf("%10zu %12.3f %12.3f %12.3f %12.3f %12.3f %10.2f  ns/element\n",
+                n, naive, fast, pairwise, kahan, dot, 2.0 / pairwise);
+  }
+}
@@ -0,0 +1,54 @@
+// Picking from logits: argmax against std::max_element over the
+// floats, and topk against std::partial_sort of the indices by float value,
+// which is what converting first and sorting does. The float conversion is
+// not included in the std:: columns.
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <numeric>
+#include <vector>
+
+#include "half-private/float16_t_select.hh"
+#include "bench.hh"
+
+int main() {
+  const std::size_t k = 50;
+  std::printf("k: %zu\n", k);
+  std::printf("%10s %14s %12s %14s %12s\n", "elements", "max_element",
+              "argmax", "partial_sort", "topk");
+  for (std::size_t n : {std::size_t{1} << 12, std::size_t{1} << 15,
+                        std::size_t{1} << 17, std::size_t{1} << 20}) {
+    std::vector<numeric::float16_t> x(n);
+    std::vector<float> f(n);
+    // Logit-like: the sum of four uniforms, about normal with deviation 2.3.
+    std::uint32_t r = 12345;
+    for (std::size_t i = 0; i < n; ++i) {
+      float sum = 0.0f;
+      for (int j = 0; j < 4; ++j) {
+        r = r * 1664525u + 1013904223u;
+        sum += float(r >> 8) * 0x1p-24f;
+      }
+      x[i] = numeric::float16_t{(sum - 2.0f) * 4.0f};
+      f[i] = float(x[i]);
+    }
+    std::vector<std::uint32_t> indices(n);
+    std::vector<numeric::float16_t> values(k);
+    volatile std::size_t sink = 0;
+    const double max_element = bench::ns_per_element(n, [&] {
+      sink = std::size_t(std::max_element(f.begin(), f.end()) - f.begin());
+    });
+    const double argmax =
+      bench::ns_per_element(n, [&] { sink = numeric::argmax(x); });
+    const double partial_sort = bench::ns_per_element(n, [&] {
+      std::iota(indices.begin(), indices.end(), 0u);
+      std::partial_sort(indices.begin(), indices.begin() + std::ptrdiff_t(k),
+                        indices.end(), [&](std::uint32_t a, std::uint32_t b) {
+                          return f[a] > f[b];
+                        });
+    });
+    const double topk = bench::ns_per_element(
+      n, [&] { sink = numeric::topk(x, k, indices, values); });
+    std::printf("%10zu %14.3f %12.3f %14.3f %12.3f  ns/element\n", n,
+                max_element, argmax, partial_sort, topk);
+  }
+}
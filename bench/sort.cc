@@ -0,0 +1,48 @@
+// Sorting random halves: std::sort with operator<, numeric::sort, argsort and
+// the parallel versions. Each sort first copies the unsorted input, which is
+// included in its column. The input has no NaNs, which operator< does not
+// order.
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "half-private/float16_t_sort.hh"
+#include "bench.hh"
+
+int main() {
+  const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  std::printf("threads: %u\n", threads);
+  std::printf("%10s %12s %12s %12s %12s %12s\n", "elements", "std::sort",
+              "sort", "argsort", "par_sort", "par_argsort");
+  for (std::size_t n : {std::size_t{1} << 10, std::size_t{1} << 14,
+                        std::size_t{1} << 20, std::size_t{1} << 24}) {
+    std::vector<numeric::float16_t> x(n);
+    std::uint32_t r = 12345;
+    for (auto &v : x) {
+      r = r * 1664525u + 1013904223u;
+      v = numeric::float16_t{static_cast<std::uint16_t>((r >> 16) & 0xbfff)};
+    }
+    std::vector<numeric::float16_t> y(n);
+    std::vector<std::uint32_t> indices(n);
+    const double std_sort = bench::ns_per_element(n, [&] {
+      y = x;
+      std::sort(y.begin(), y.end());
+    });
+    const double sort = bench::ns_per_element(n, [&] {
+      y = x;
+      numeric::sort(y);
+    });
+    const double argsort =
+      bench::ns_per_element(n, [&] { numeric::argsort(x, indices); });
+    const double par_sort = bench::ns_per_element(n, [&] {
+      y = x;
+      numeric::parallel_sort(y);
+    });
+    const double par_argsort =
+      bench::ns_per_element(n, [&] { numeric::parallel_argsort(x, indices); });
+    std::printf("%10zu %12.3f %12.3f %12.3f %12.3f %12.3f  ns/element\n", n,
+                std_sort, sort, argsort, par_sort, par_argsort);
+  }
+}
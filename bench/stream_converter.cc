@@ -0,0 +1,101 @@
+// Exporting 128 MiB of fp32 weights as fp16 and importing them back, file
+// to file (through the page cache): reading everything, converting and
+// writing everything against fps::stream_converter, in MB/s of input.
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "fps/stream_converter.hh"
+#include "bench.hh"
+
+namespace {
+
+// Reads all of fd, from the start.
+std::vector<std::byte> read_all(int fd) {
+  std::vector<std::byte> bytes(std::size_t(::lseek(fd, 0, SEEK_END)));
+  ::lseek(fd, 0, SEEK_SET);
+  for (std::size_t done = 0; done < bytes.size();) {
+    const ssize_t n = ::read(fd, bytes.data() + done, bytes.size() - done);
+    if (n <= 0)
+      break;
+    done += std::size_t(n);
+  }
+  return bytes;
+}
+
+} // namespace
+
+int main() {
+  using namespace fps;
+  constexpr std::size_t elements = std::size_t{1} << 25;
+  const auto dir = std::filesystem::temp_directory_path();
+  const std::string f32_path = (dir / "bench_stream_f32.bin").string();
+  const std::string f16_path = (dir / "bench_stream_f16.bin").string();
+  const std::string back_path = (dir / "bench_stream_back.bin").string();
+  {
+    std::vector<float> values(elements);
+    for (std::size_t i = 0; i < elements; ++i)
+      values[i] = float(i % 4093) * 0x1p-6f;
+    std::FILE *out = std::fopen(f32_path.c_str(), "wb");
+    std::fwrite(values.data(), 4, elements, out);
+    std::fclose(out);
+  }
+  const auto open_in = [](const std::string &path) {
+    return ::open(path.c_str(), O_RDONLY);
+  };
+  const auto open_out = [](const std::string &path) {
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  };
+  // Whole files: peak memory of the input and the output.
+  const auto whole = [&](const std::string &in_path,
+                         const std::string &out_path, bool to_half) {
+    const int in = open_in(in_path), out = open_out(out_path);
+    const std::vector<std::byte> bytes = read_all(in);
+    const std::size_t n = bytes.size() / (to_half ? 4 : 2);
+    std::vector<std::byte> converted(n * (to_half ? 2 : 4));
+    if (to_half)
+      convert_f2h({reinterpret_cast<const fp32_storage_t *>(bytes.data()), n},
+                  {reinterpret_cast<fp16_storage_t *>(converted.data()), n});
+    else
+      convert_h2f({reinterpret_cast<const fp16_storage_t *>(bytes.data()), n},
+                  {reinterpret_cast<fp32_storage_t *>(converted.data()), n});
+    (void)fd_sink(out)(converted);
+    ::close(in);
+    ::close(out);
+  };
+  const auto streamed = [&](const std::string &in_path,
+                            const std::string &out_path, bool to_half) {
+    const int in = open_in(in_path), out = open_out(out_path);
+    stream_converter(to_half ? stream_conversion::f32_to_f16
+                             : stream_conversion::f16_to_f32)
+      .run(fd_source(in), fd_sink(out));
+    ::close(in);
+    ::close(out);
+  };
+  const double mb = 1e-6 * double(elements);
+  const double whole_export =
+    4 * mb /
+    (1e-9 * bench::ns_per_element(1, [&] { whole(f32_path, f16_path, true); }));
+  const double stream_export =
+    4 * mb / (1e-9 * bench::ns_per_element(
+                       1, [&] { streamed(f32_path, f16_path, true); }));
+  const double whole_import =
+    2 * mb / (1e-9 * bench::ns_per_element(
+                       1, [&] { whole(f16_path, back_path, false); }));
+  const double stream_import =
+    2 * mb / (1e-9 * bench::ns_per_element(
+                       1, [&] { streamed(f16_path, back_path, false); }));
+  for (const std::string &path : {f32_path, f16_path, back_path})
+    std::filesystem::remove(path);
+  std::printf("backend: %s, threads: %u\n",
+              half::backend_name(half::active_backend()),
+              std::thread::hardware_concurrency());
+  std::printf("%8s %12s %12s  MB/s of input\n", "", "whole file", "streamed");
+  std::printf("%8s %12.0f %12.0f\n", "export", whole_export, stream_export);
+  std::printf("%8s %12.0f %12.0f\n", "import", whole_import, stream_import);
+}
@@ -0,0 +1,256 @@
+// Throughput of the conversions, arithmetic, comparisons and numeric:: math
+// functions, with working sets sized for L1, L2, the last level cache and
+// main memory. Prints a line per result to stderr and the results as JSON to
+// stdout, or to the file named by the first argument.
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#include "half-private/arith_n.hh"
+#include "half-private/compare_n.hh"
+#include "half-private/float16_t_reduce.hh"
+#include "half-private/float16_t_table.hh"
+#include "half-private/fp_convert_n.hh"
+#include "bench.hh"
+
+namespace {
+
+struct level_t {
+  const char *name;
+  std::size_t bytes;
+};
+
+#if defined(_SC_LEVEL1_DCACHE_SIZE)
+std::size_t cache_bytes(int name, std::size_t fallback) {
+  const long bytes = sysconf(name);
+  return bytes > 0 ? static_cast<std::size_t>(bytes) : fallback;
+}
+#endif
+
+// Half of each cache, so that the buffers stay in it, and four times the
+// last level (at least 256 MiB) for main memory. Where sysconf does not know
+// the sizes, common ones are assumed.
+std::vector<level_t> levels() {
+  std::size_t l1 = 32 << 10;
+  std::size_t l2 = 1 << 20;
+  std::size_t llc = 16 << 20;
+#if defined(_SC_LEVEL1_DCACHE_SIZE)
+  l1 = cache_bytes(_SC_LEVEL1_DCACHE_SIZE, l1);
+  l2 = cache_bytes(_SC_LEVEL2_CACHE_SIZE, l2);
+  llc = cache_bytes(_SC_LEVEL3_CACHE_SIZE, llc);
+#endif
+  const std::size_t dram = std::max<std::size_t>(4 * llc, 256 << 20);
+  return {{"L1", l1 / 2}, {"L2", l2 / 2}, {"LLC", llc / 2}, {"DRAM", dram}};
+}
+
+template <typename Ty_>
+std::vector<Ty_> random_bits(std::size_t n, std::uint32_t seed) {
+  std::vector<Ty_> v(n);
+  for (auto &x : v) {
+    seed = seed * 1664525u + 1013904223u;
+    x = static_cast<Ty_>(sizeof(Ty_) == 2 ? seed >> 16 : seed);
+  }
+  return v;
+}
+
+std::vector<numeric::float16_t> random_halves(std::size_t n,
+                                              std::uint32_t seed) {
+  const std::vector<std::uint16_t> bits = random_bits<std::uint16_t>(n, seed);
+  std::vector<numeric::float16_t> v(n);
+  for (std::size_t i = 0; i < n; ++i)
+    v[i] = numeric::float16_t{bits[i]};
+  return v;
+}
+
+struct case_t {
+  const char *name;
+  std::size_t bytes_per_element; // read and written
+  std::function<double(std::size_t)> ns_per_element;
+};
+
+// Unary uint32 -> uint16, uint16 -> uint32 and binary uint16 cases.
+template <typename Fn_> double f2h(std::size_t n, Fn_ fn) {
+  const std::vector<std::uint32_t> f = random_bits<std::uint32_t>(n, 1);
+  std::vector<std::uint16_t> h(n);
+  return bench::ns_per_element(n, [&] { fn(f, h); });
+}
+
+template <typename Fn_> double h2f(std::size_t n, Fn_ fn) {
+  const std::vector<std::uint16_t> h = random_bits<std::uint16_t>(n, 2);
+  std::vector<std::uint32_t> f(n);
+  return bench::ns_per_element(n, [&] { fn(h, f); });
+}
+
+template <typename Fn_> double binary(std::size_t n, Fn_ fn) {
+  const std::vector<std::uint16_t> x = random_bits<std::uint16_t>(n, 3);
+  const std::vector<std::uint16_t> y = random_bits<std::uint16_t>(n, 4);
+  std::vector<std::uint16_t> out(n);
+  return bench::ns_per_element(n, [&] { fn(x, y, out); });
+}
+
+template <typename Fn_> double unary_math(std::size_t n, Fn_ fn) {
+  const std::vector<numeric::float16_t> x = random_halves(n, 5);
+  std::vector<numeric::float16_t> y(n);
+  return bench::ns_per_element(n, [&] { fn(x, y); });
+}
+
+std::vector<case_t> cases() {
+  using u16s = std::vector<std::uint16_t>;
+  using u32s = std::vector<std::uint32_t>;
+  using halves = std::vector<numeric::float16_t>;
+  return {
+    {"float_to_half", 6,
+     [](std::size_t n) {
+       return f2h(n, [](const u32s &f, u16s &h) {
+         for (std::size_t i = 0; i < f.size(); ++i)
+           h[i] = half::float_to_half(f[i]);
+       });
+     }},
+    {"float_to_half_n", 6,
+     [](std::size_t n) {
+       return f2h(n,
+                  [](const u32s &f, u16s &h) { half::float_to_half_n(f, h); });
+     }},
+    {"half_to_float", 6,
+     [](std::size_t n) {
+       return h2f(n, [](const u16s &h, u32s &f) {
+         for (std::size_t i = 0; i < h.size(); ++i)
+           f[i] = half::half_to_float(h[i]);
+       });
+     }},
+    {"half_to_float_n", 6,
+     [](std::size_t n) {
+       return h2f(n,
+                  [](const u16s &h, u32s &f) { half::half_to_float_n(h, f); });
+     }},
+    {"half_add", 6,
+     [](std::size_t n) {
+       return binary(n, [](const u16s &x, const u16s &y, u16s &out) {
+         for (std::size_t i = 0; i < x.size(); ++i)
+           out[i] = half::half_add(x[i], y[i]);
+       });
+     }},
+    {"half_mul", 6,
+     [](std::size_t n) {
+       return binary(n, [](const u16s &x, const u16s &y, u16s &out) {
+         for (std::size_t i = 0; i < x.size(); ++i)
+           out[i] = half::half_mul(x[i], y[i]);
+       });
+     }},
+    {"half_add_n", 6,
+     [](std::size_t n) {
+       return binary(n, [](const u16s &x, const u16s &y, u16s &out) {
+         half::half_add_n(x, y, out);
+       });
+     }},
+    {"half_mul_n", 6,
+     [](std::size_t n) {
+       return binary(n, [](const u16s &x, const u16s &y, u16s &out) {
+         half::half_mul_n(x, y, out);
+       });
+     }},
+    {"fma_n", 8,
+     [](std::size_t n) {
+       const u16s z = random_bits<std::uint16_t>(n, 6);
+       return binary(n, [&](const u16s &x, const u16s &y, u16s &out) {
+         half::fma_n(x, y, z, out);
+       });
+     }},
+    {"float16_t::operator<", 5,
+     [](std::size_t n) {
+       const halves x = random_halves(n, 7);
+       const halves y = random_halves(n, 8);
+       std::vector<unsigned char> less(n);
+       return bench::ns_per_element(n, [&] {
+         for (std::size_t i = 0; i < n; ++i)
+           less[i] = x[i] < y[i];
+       });
+     }},
+    {"less_n", 5,
+     [](std::size_t n) {
+       const u16s x = random_bits<std::uint16_t>(n, 7);
+       const u16s y = random_bits<std::uint16_t>(n, 8);
+       const std::unique_ptr<bool[]> less(new bool[n]);
+       return bench::ns_per_element(
+         n, [&] { half::less_n(x, y, std::span{less.get(), n}); });
+     }},
+    {"min_n", 6,
+     [](std::size_t n) {
+       return binary(n, [](const u16s &x, const u16s &y, u16s &out) {
+         half::min_n(x, y, out);
+       });
+     }},
+    {"numeric::sum", 2,
+     [](std::size_t n) {
+       const halves x = random_halves(n, 9);
+       volatile float sum = 0.0f;
+       return bench::ns_per_element(n, [&] { sum = numeric::sum(x); });
+     }},
+    {"numeric::dot", 4,
+     [](std::size_t n) {
+       const halves x = random_halves(n, 9);
+       const halves y = random_halves(n, 10);
+       volatile float dot = 0.0f;
+       return bench::ns_per_element(n, [&] { dot = numeric::dot(x, y); });
+     }},
+    {"numeric::exp", 4,
+     [](std::size_t n) {
+       return unary_math(n, [](const halves &x, halves &y) {
+         for (std::size_t i = 0; i < x.size(); ++i)
+           y[i] = numeric::exp(x[i]);
+       });
+     }},
+    {"numeric::tanh", 4,
+     [](std::size_t n) {
+       return unary_math(n, [](const halves &x, halves &y) {
+         for (std::size_t i = 0; i < x.size(); ++i)
+           y[i] = numeric::tanh(x[i]);
+       });
+     }},
+    {"numeric::table::tanh (span)", 4,
+     [](std::size_t n) {
+       return unary_math(
+         n, [](const halves &x, halves &y) { numeric::table::tanh(x, y); });
+     }},
+  };
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::FILE *out = stdout;
+  if (argc > 1 && !(out = std::fopen(argv[1], "w"))) {
+    std::perror(argv[1]);
+    return 1;
+  }
+  const char *backend = half::backend_name(half::active_backend());
+  std::fprintf(stderr, "backend: %s\n", backend);
+  std::fprintf(out, "{\n  \"backend\": \"%s\",\n  \"results\": [", backend);
+  const char *separator = "\n";
+  const std::vector<level_t> cache_levels = levels();
+  for (const case_t &c : cases()) {
+    for (const level_t &level : cache_levels) {
+      const std::size_t n = level.bytes / c.bytes_per_element;
+      const double ns = c.ns_per_element(n);
+      const double gb_per_s = double(c.bytes_per_element) / ns;
+      std::fprintf(stderr, "%-28s %-5s %12zu %10.3f ns/element %8.2f GB/s\n",
+                   c.name, level.name, n, ns, gb_per_s);
+      std::fprintf(out,
+                   "%s    {\"name\": \"%s\", \"level\": \"%s\", "
+                   "\"bytes\": %zu, \"elements\": %zu, "
+                   "\"ns_per_element\": %.4f, \"gb_per_s\": %.4f}",
+                   separator, c.name, level.name, n * c.bytes_per_element, n,
+                   ns, gb_per_s);
+      separator = ",\n";
+    }
+  }
+  std::fprintf(out, "\n  ]\n}\n");
+  return out == stdout || std::fclose(out) == 0 ? 0 : 1;
+}
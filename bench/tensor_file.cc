@@ -0,0 +1,78 @@
+// Loading a checkpoint of 64 fp16 tensors of 1 MiB (from the page cache):
+// reading the file into a buffer and copying the tensors out against
+// mapping it with fps::tensor_file and reading one tensor, or all of them,
+// in microseconds per load.
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "fps/tensor_file.hh"
+#include "bench.hh"
+
+int main() {
+  using namespace fps;
+  constexpr std::size_t count = 64, elements = std::size_t{1} << 19;
+  const std::string path =
+    (std::filesystem::temp_directory_path() / "bench_tensor_file.fpst")
+      .string();
+  std::vector<std::vector<fp16_storage_t>> data(count);
+  std::vector<std::string> names(count);
+  std::vector<tensor_source> tensors;
+  const std::size_t shape[] = {elements};
+  for (std::size_t t = 0; t < count; ++t) {
+    data[t].assign(elements, fp16_storage_t(t));
+    names[t] = "tensor" + std::to_string(t);
+    tensors.emplace_back(names[t], shape, data[t]);
+  }
+  if (!write_tensor_file(path.c_str(), tensors)) {
+    std::perror(path.c_str());
+    return 1;
+  }
+  volatile std::uint32_t sink = 0;
+  // Reads one element per page, as a kernel touching the tensor would.
+  const auto touch = [&](std::span<const fp16_storage_t> tensor) {
+    std::uint32_t sum = 0;
+    for (std::size_t i = 0; i < tensor.size(); i += 2048)
+      sum += std::uint32_t(tensor[i]);
+    sink = sink + sum;
+  };
+  const double copied = 1e-3 * bench::ns_per_element(1, [&] {
+                          std::ifstream in(path, std::ios::binary);
+                          std::vector<char> bytes(
+                            std::filesystem::file_size(path));
+                          in.read(bytes.data(), std::streamsize(bytes.size()));
+                          std::vector<std::vector<fp16_storage_t>> loaded(
+                            count, std::vector<fp16_storage_t>(elements));
+                          for (std::size_t t = 0; t < count; ++t)
+                            std::memcpy(loaded[t].data(),
+                                        bytes.data() + 64 + count * 128 +
+                                          t * elements * 2,
+                                        elements * 2);
+                          touch(loaded[count / 2]);
+                        });
+  const double mapped_one = 1e-3 * bench::ns_per_element(1, [&] {
+                              const auto file = tensor_file::open(path.c_str());
+                              touch(file->view<fp16_storage_t>(count / 2));
+                            });
+  const double mapped_all = 1e-3 * bench::ns_per_element(1, [&] {
+                              const auto file = tensor_file::open(path.c_str());
+                              for (std::size_t t = 0; t < count; ++t)
+                                touch(file->view<fp16_storage_t>(t));
+                            });
+  const double populated =
+    1e-3 * bench::ns_per_element(1, [&] {
+      const auto file =
+        tensor_file::open(path.c_str(), map_prefetch::populate);
+      for (std::size_t t = 0; t < count; ++t)
+        touch(file->view<fp16_storage_t>(t));
+    });
+  std::filesystem::remove(path);
+  std::printf("%14s %12s %12s %14s  us/load (64 MiB)\n", "read + copy",
+              "mmap, one", "mmap, all", "populate, all");
+  std::printf("%14.1f %12.1f %12.1f %14.1f\n", copied, mapped_one, mapped_all,
+              populated);
+}
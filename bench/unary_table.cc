@@ -0,0 +1,43 @@
+// numeric::tanh / numeric::exp through float and libm vs their 65536 entry
+// tables, per call and over spans.
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+#include "half-private/float16_t_table.hh"
+#include "bench.hh"
+
+namespace {
+
+template <typename Direct_, typename Table_>
+void run(const char *name, Direct_ direct, Table_ table) {
+  std::printf("%s\n%10s %12s %12s %12s\n", name, "elements", "direct",
+              "table", "table_span");
+  for (std::size_t n : {std::size_t{1} << 12, std::size_t{1} << 15,
+                        std::size_t{1} << 24}) {
+    std::vector<numeric::float16_t> x(n), y(n);
+    std::uint32_t r = 12345;
+    for (auto &v : x) {
+      r = r * 1664525u + 1013904223u;
+      v = numeric::float16_t{static_cast<std::uint16_t>(r >> 16)};
+    }
+    const double direct_ns = bench::ns_per_element(n, [&] {
+      for (std::size_t i = 0; i < n; ++i)
+        y[i] = direct(x[i]);
+    });
+    const double table_ns = bench::ns_per_element(n, [&] {
+      for (std::size_t i = 0; i < n; ++i)
+        y[i] = table(x[i]);
+    });
+    const double span_ns = bench::ns_per_element(n, [&] { table(x, y); });
+    std::printf("%10zu %12.3f %12.3f %12.3f  ns/element\n", n, direct_ns,
+                table_ns, span_ns);
+  }
+}
+
+} // namespace
+
+int main() {
+  run("tanh", numeric::tanh, numeric::table::tanh);
+  run("exp", numeric::exp, numeric::table::exp);
+}
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <algorithm>
+#include <bit>
 #include <compare>
 #include <cstddef>
 #include <initializer_list>
 #include <iterator>
 #include <numeric>
+#include <type_traits>
 
 namespace fps
 {
@@ -14,6 +16,11 @@ template <typename Ty_, std::size_t Sz_, std::size_t Algn_ = alignof(Ty_)>
    requires (Sz_ >0)
 struct alignas(Algn_) aligned_array;
 
+template <typename Ty_, std::size_t Algn_ = 64>
+   requires (std::has_single_bit(Algn_) && Algn_ >= alignof(Ty_) &&
+             std::is_trivially_copyable_v<Ty_>)
+struct aligned_buffer;
+
 template <typename Iter_>
 struct contig_iterator
 {
@@ -21,6 +28,11 @@ struct contig_iterator
      requires (Sz_ >0)
    friend struct aligned_array;
 
+   template <typename Ty_, std::size_t Algn_>
+     requires (std::has_single_bit(Algn_) && Algn_ >= alignof(Ty_) &&
+               std::is_trivially_copyable_v<Ty_>)
+   friend struct aligned_buffer;
+
    using iterator_concept = std::contiguous_iterator_tag;
 
    using value_type = typename std::iterator_traits<Iter_>::value_type;
@@ -41,10 +53,10 @@ public:
    template <typename ToTy_> requires std::is_convertible_v<ToTy_, iterator_type>
    constexpr contig_iterator(const contig_iterator<ToTy_> &other) noexcept: _it(other.base()) {}
 
-   [[nodiscard]] constexpr reference operator*() noexcept
+   [[nodiscard]] constexpr reference operator*() const noexcept
    { return *_it; }
 
-   [[nodiscard]] constexpr pointer operator->() noexcept
+   [[nodiscard]] constexpr pointer operator->() const noexcept
    { return std::to_address(_it); }
 
    constexpr contig_iterator & operator++() noexcept { ++_it; return *this; }
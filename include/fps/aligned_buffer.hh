@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "fps/aligned_array.hh"
+
+namespace fps
+{
+
+// The bytes of the widest vector the SIMD kernels load (AVX-512): an
+// aligned_buffer holds a whole number of them, so a kernel can run its last
+// vector over the padding instead of a scalar tail.
+inline constexpr std::size_t simd_padding = 64;
+
+// The transparent huge page size aligned_buffer asks for on Linux.
+inline constexpr std::size_t huge_page_size = std::size_t{1} << 21;
+
+enum struct page_hint
+{
+   normal,
+   // Allocations of at least huge_page_size bytes are aligned to it and
+   // marked MADV_HUGEPAGE, so that the kernel may back them with huge pages
+   // (fewer TLB misses when streaming large tensors). Elsewhere the same as
+   // normal.
+   huge,
+};
+
+// A runtime-sized companion of aligned_array: data() is aligned to Algn_
+// and the elements past size() up to padded_size() (a multiple of
+// simd_padding bytes) are readable and zero after construction, resize and
+// assignment. Copies are deep; moves steal the allocation.
+template <typename Ty_, std::size_t Algn_ /* = 64 */>
+   requires (std::has_single_bit(Algn_) && Algn_ >= alignof(Ty_) &&
+             std::is_trivially_copyable_v<Ty_>)
+struct aligned_buffer
+{
+   using value_type = Ty_;
+   using pointer = Ty_*;
+   using const_pointer = const Ty_*;
+   using reference = Ty_&;
+   using const_reference = const Ty_&;
+   using size_type = std::size_t;
+   using difference_type = std::ptrdiff_t;
+
+   using iterator = contig_iterator<pointer>;
+   using const_iterator = contig_iterator<const_pointer>;
+
+   using reverse_iterator = std::reverse_iterator<iterator>;
+   using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+   inline constexpr static std::size_t data_alignment = Algn_;
+
+   aligned_buffer() noexcept = default;
+
+   explicit aligned_buffer(size_type n, page_hint hint = page_hint::normal)
+   { _allocate(n, hint); }
+
+   aligned_buffer(size_type n, const_reference el,
+                  page_hint hint = page_hint::normal)
+   { _allocate(n, hint); fill(el); }
+
+   aligned_buffer(std::initializer_list<value_type> init)
+   { _allocate(init.size(), page_hint::normal);
+     std::copy(init.begin(), init.end(), _data); }
+
+   aligned_buffer(const aligned_buffer &other)
+   { _allocate(other._size, other._hint);
+     std::copy_n(other._data, other._size, _data); }
+
+   aligned_buffer(aligned_buffer &&other) noexcept
+   { swap(other); }
+
+   aligned_buffer & operator=(aligned_buffer other) noexcept
+   { swap(other); return *this; }
+
+   ~aligned_buffer()
+   { _deallocate(); }
+
+   auto begin() noexcept
+   { return iterator{data()}; }
+   auto end() noexcept
+   { return iterator{data() + _size}; }
+
+   auto begin() const noexcept
+   { return const_iterator{data()}; }
+   auto end() const noexcept
+   { return const_iterator{data() + _size}; }
+
+   auto cbegin() const noexcept
+   { return const_iterator{data()}; }
+   auto cend() const noexcept
+   { return const_iterator{data() + _size}; }
+
+   [[nodiscard]] auto rbegin() noexcept
+   { return reverse_iterator{end()}; }
+   [[nodiscard]] auto rend() noexcept
+   { return reverse_iterator{begin()}; }
+
+   [[nodiscard]] auto rbegin() const noexcept
+   { return const_reverse_iterator{end()}; }
+   [[nodiscard]] auto rend() const noexcept
+   { return const_reverse_iterator{begin()}; }
+
+   [[nodiscard]] auto crbegin() const noexcept
+   { return const_reverse_iterator{end()}; }
+   [[nodiscard]] auto crend() const noexcept
+   { return const_reverse_iterator{begin()}; }
+
+   [[nodiscard]] auto *data() noexcept
+   { return _data; }
+   [[nodiscard]] const auto *data() const noexcept
+   { return _data; }
+
+   [[nodiscard]] reference front() noexcept
+   { return _data[0]; }
+   [[nodiscard]] const_reference front() const noexcept
+   { return _data[0]; }
+
+   [[nodiscard]] reference back() noexcept
+   { return _data[_size - 1]; }
+   [[nodiscard]] const_reference back() const noexcept
+   { return _data[_size - 1]; }
+
+   [[nodiscard]] bool empty() const noexcept
+   { return _size == 0; }
+   [[nodiscard]] size_type size() const noexcept
+   { return _size; }
+   // size() rounded up to whole SIMD vectors (and huge pages, if hinted).
+   [[nodiscard]] size_type padded_size() const noexcept
+   { return _capacity; }
+
+   reference operator[](size_type n) noexcept
+   { return _data[n]; }
+   const_reference operator[](size_type n) const noexcept
+   { return _data[n]; }
+
+   void fill(const_reference el) noexcept
+   { std::fill_n(data(), _size, el); }
+
+   // Keeps the first min(n, size()) elements; the others and the padding
+   // are zero. Reallocates (with the same page hint) only beyond
+   // padded_size().
+   void resize(size_type n)
+   {
+      if (n > _capacity) {
+         aligned_buffer grown(n, _hint);
+         std::copy_n(_data, _size, grown._data);
+         swap(grown);
+         return;
+      }
+      std::fill(_data + std::min(n, _size), _data + _capacity, value_type{});
+      _size = n;
+   }
+
+   void swap(aligned_buffer &other) noexcept
+   {
+      std::swap(_data, other._data);
+      std::swap(_size, other._size);
+      std::swap(_capacity, other._capacity);
+      std::swap(_alignment, other._alignment);
+      std::swap(_hint, other._hint);
+   }
+
+private:
+   void _allocate(size_type n, page_hint hint)
+   {
+      constexpr std::size_t unit = std::max(Algn_, simd_padding);
+      // Rounding up to unit or to a huge page must not wrap.
+      constexpr std::size_t max_bytes =
+         std::numeric_limits<std::size_t>::max() -
+         std::max(unit, huge_page_size);
+      if (n > max_bytes / sizeof(value_type))
+         throw std::bad_array_new_length();
+      std::size_t bytes = (n * sizeof(value_type) + unit - 1) / unit * unit;
+      _hint = hint;
+      if (bytes == 0)
+         return;
+      _alignment = Algn_;
+      const bool huge = hint == page_hint::huge && bytes >= huge_page_size;
+      if (huge) {
+         _alignment = std::max(Algn_, huge_page_size);
+         bytes = (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+      }
+      _data = static_cast<pointer>(
+         ::operator new(bytes, std::align_val_t{_alignment}));
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+      // Advice only: without THP support the pages stay normal.
+      if (huge)
+         ::madvise(_data, bytes, MADV_HUGEPAGE);
+#endif
+      _size = n;
+      _capacity = bytes / sizeof(value_type);
+      std::fill_n(_data, _capacity, value_type{});
+   }
+
+   void _deallocate() noexcept
+   {
+      if (_data)
+         ::operator delete(_data, std::align_val_t{_alignment});
+   }
+
+   pointer _data = nullptr;
+   size_type _size = 0;
+   size_type _capacity = 0;
+   std::size_t _alignment = Algn_;
+   page_hint _hint = page_hint::normal;
+};
+
+template <typename Ty_, std::size_t Algn_>
+void swap(aligned_buffer<Ty_, Algn_> &b1, aligned_buffer<Ty_, Algn_> &b2)
+   noexcept
+{
+   b1.swap(b2);
+}
+
+} // namespace fps
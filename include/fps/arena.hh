@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "fps/aligned_buffer.hh"
+
+namespace fps
+{
+
+// Byte counts of an arena or a buffer_pool, for sizing them.
+struct allocator_stats
+{
+   // Bytes handed out and not given back, with the rounding to whole
+   // vectors (arena: and alignment gaps; buffer_pool: size classes).
+   std::size_t in_use = 0;
+   // The most in_use has been since construction or reset_high_water().
+   std::size_t high_water = 0;
+   // Bytes held from the system, in use or not.
+   std::size_t reserved = 0;
+   // Calls to allocate since construction.
+   std::size_t allocations = 0;
+};
+
+// A bump allocator for scratch buffers that die together, e.g. those of one
+// training step: allocate() hands out the next Algn_-aligned bytes of the
+// current block, taking a new block (of at least block_bytes) when it is
+// full, and rewind() (or the end of a scope) and reset() give back
+// everything allocated after a point at once. Nothing is freed one by one
+// and no destructors run, hence the trivially copyable elements. Every
+// allocation is rounded up to whole simd_padding bytes, like aligned_buffer,
+// but the padding is not zeroed. The blocks go back to the system in
+// release() and the destructor.
+class arena
+{
+public:
+   inline constexpr static std::size_t default_block_bytes =
+      std::size_t{1} << 20;
+
+   // A position in the arena.
+   struct marker
+   {
+      std::size_t block = 0;
+      std::size_t offset = 0;
+      std::size_t in_use = 0;
+   };
+
+   // Rewinds the arena to where it was when the scope began.
+   class scope
+   {
+   public:
+      explicit scope(arena &a) noexcept : _arena(a), _mark(a.mark()) {}
+      scope(const scope &) = delete;
+      scope & operator=(const scope &) = delete;
+      ~scope() { _arena.rewind(_mark); }
+
+   private:
+      arena &_arena;
+      marker _mark;
+   };
+
+   explicit arena(std::size_t block_bytes = default_block_bytes,
+                  page_hint hint = page_hint::normal) noexcept
+      : _block_bytes(block_bytes), _hint(hint) {}
+
+   arena(const arena &) = delete;
+   arena & operator=(const arena &) = delete;
+
+   // The source is left empty, as after release().
+   arena(arena &&other) noexcept
+      : _blocks(std::move(other._blocks)), _block(other._block),
+        _offset(other._offset), _block_bytes(other._block_bytes),
+        _hint(other._hint), _stats(other._stats)
+   { other.release(); }
+
+   arena & operator=(arena &&other) noexcept
+   {
+      if (this != &other) {
+         _blocks = std::move(other._blocks);
+         _block = other._block;
+         _offset = other._offset;
+         _block_bytes = other._block_bytes;
+         _hint = other._hint;
+         _stats = other._stats;
+         other.release();
+      }
+      return *this;
+   }
+
+   // Uninitialized storage for n elements, aligned to Algn_; empty for
+   // n = 0.
+   template <typename Ty_, std::size_t Algn_ = simd_padding>
+      requires (std::has_single_bit(Algn_) && Algn_ >= alignof(Ty_) &&
+                std::is_trivially_copyable_v<Ty_>)
+   [[nodiscard]] std::span<Ty_> allocate(std::size_t n)
+   {
+      if (n == 0)
+         return {};
+      if (n > _max_bytes / sizeof(Ty_))
+         throw std::bad_array_new_length();
+      return {static_cast<Ty_*>(_allocate(n * sizeof(Ty_), Algn_)), n};
+   }
+
+   [[nodiscard]] marker mark() const noexcept
+   { return {_block, _offset, _stats.in_use}; }
+
+   // Gives back everything allocated after m was taken.
+   void rewind(const marker &m) noexcept
+   {
+      _block = m.block;
+      _offset = m.offset;
+      _stats.in_use = m.in_use;
+   }
+
+   // Gives back everything. If the last round needed several blocks they
+   // are merged into one as large, so that the next round of the same size
+   // does not hop between blocks.
+   void reset()
+   {
+      rewind(marker{});
+      if (_blocks.size() > 1) {
+         _blocks.clear();
+         _blocks.emplace_back(_stats.reserved, _hint);
+         _stats.reserved = _blocks.back().padded_size();
+      }
+   }
+
+   // Gives back everything and returns the blocks to the system.
+   void release() noexcept
+   {
+      rewind(marker{});
+      _blocks.clear();
+      _stats.reserved = 0;
+   }
+
+   [[nodiscard]] const allocator_stats & stats() const noexcept
+   { return _stats; }
+
+   void reset_high_water() noexcept
+   { _stats.high_water = _stats.in_use; }
+
+private:
+   // Past it, the rounding and alignment room of _allocate could wrap.
+   inline constexpr static std::size_t _max_bytes =
+      std::numeric_limits<std::size_t>::max() / 2;
+
+   void *_allocate(std::size_t bytes, std::size_t alignment)
+   {
+      bytes = (bytes + simd_padding - 1) / simd_padding * simd_padding;
+      for (;; ++_block, _offset = 0) {
+         if (_block == _blocks.size()) {
+            // Room for bytes at any alignment past the block's own.
+            _blocks.emplace_back(
+               std::max(_block_bytes,
+                        bytes + std::max(alignment, simd_padding) -
+                           simd_padding),
+               _hint);
+            _stats.reserved += _blocks.back().padded_size();
+         }
+         aligned_buffer<std::byte, simd_padding> &block = _blocks[_block];
+         const auto base = reinterpret_cast<std::uintptr_t>(block.data());
+         const std::size_t start =
+            (base + _offset + alignment - 1) / alignment * alignment - base;
+         if (start + bytes <= block.size()) {
+            _stats.in_use += start + bytes - _offset;
+            _stats.high_water = std::max(_stats.high_water, _stats.in_use);
+            ++_stats.allocations;
+            _offset = start + bytes;
+            return block.data() + start;
+         }
+      }
+   }
+
+   std::vector<aligned_buffer<std::byte, simd_padding>> _blocks;
+   std::size_t _block = 0;
+   std::size_t _offset = 0;
+   std::size_t _block_bytes;
+   page_hint _hint;
+   allocator_stats _stats;
+};
+
+// Buffers in power of two size classes from simd_padding bytes:
+// deallocate() keeps a buffer on the free list of its class for the next
+// allocate() of that class instead of returning it to the system, so that
+// in a steady state allocation is a pop and freeing a push, without page
+// faults. Buffers are aligned to their class size, up to max_alignment.
+// They go back to the system in release() and the destructor, which must
+// come after every buffer has been deallocated.
+class buffer_pool
+{
+public:
+   inline constexpr static std::size_t max_alignment = 4096;
+
+   buffer_pool() noexcept = default;
+   buffer_pool(const buffer_pool &) = delete;
+   buffer_pool & operator=(const buffer_pool &) = delete;
+
+   ~buffer_pool()
+   { release(); }
+
+   // Uninitialized storage for n elements, aligned to Algn_; empty for
+   // n = 0.
+   template <typename Ty_, std::size_t Algn_ = simd_padding>
+      requires (std::has_single_bit(Algn_) && Algn_ >= alignof(Ty_) &&
+                Algn_ <= max_alignment && std::is_trivially_copyable_v<Ty_>)
+   [[nodiscard]] std::span<Ty_> allocate(std::size_t n)
+   {
+      if (n == 0)
+         return {};
+      if (n > _bytes(_classes - 1) / sizeof(Ty_))
+         throw std::bad_array_new_length();
+      return {static_cast<Ty_*>(_allocate(_class_of<Algn_>(n * sizeof(Ty_)))),
+              n};
+   }
+
+   // Takes back a span from allocate<Ty_, Algn_>, whole.
+   template <typename Ty_, std::size_t Algn_ = simd_padding>
+   void deallocate(std::span<Ty_> buffer)
+   {
+      if (!buffer.empty())
+         _deallocate(buffer.data(), _class_of<Algn_>(buffer.size_bytes()));
+   }
+
+   // Returns the free buffers to the system.
+   void release() noexcept
+   {
+      for (std::size_t c = 0; c < _classes; ++c) {
+         for (std::size_t i = 0; i < _free_count[c]; ++i)
+            ::operator delete(_free[c][i], std::align_val_t{_alignment(c)});
+         _stats.reserved -= _free_count[c] * _bytes(c);
+         _free[c].clear();
+         _free_count[c] = 0;
+      }
+   }
+
+   [[nodiscard]] const allocator_stats & stats() const noexcept
+   { return _stats; }
+
+   void reset_high_water() noexcept
+   { _stats.high_water = _stats.in_use; }
+
+private:
+   inline constexpr static std::size_t _classes =
+      std::numeric_limits<std::size_t>::digits -
+      std::bit_width(simd_padding) + 1;
+
+   [[nodiscard]] static std::size_t _bytes(std::size_t c) noexcept
+   { return simd_padding << c; }
+
+   [[nodiscard]] static std::size_t _alignment(std::size_t c) noexcept
+   { return std::min(_bytes(c), max_alignment); }
+
+   template <std::size_t Algn_>
+   [[nodiscard]] static std::size_t _class_of(std::size_t bytes) noexcept
+   {
+      const std::size_t size =
+         std::bit_ceil(std::max({bytes, Algn_, simd_padding}));
+      return std::bit_width(size) - std::bit_width(simd_padding);
+   }
+
+   void *_allocate(std::size_t c)
+   {
+      void *p;
+      if (_free_count[c] == 0) {
+         p = ::operator new(_bytes(c), std::align_val_t{_alignment(c)});
+         _stats.reserved += _bytes(c);
+      } else {
+         p = _free[c][--_free_count[c]];
+      }
+      _stats.in_use += _bytes(c);
+      _stats.high_water = std::max(_stats.high_water, _stats.in_use);
+      ++_stats.allocations;
+      return p;
+   }
+
+   void _deallocate(void *p, std::size_t c)
+   {
+      if (_free_count[c] == _free[c].size())
+         _free[c].push_back(p);
+      else
+         _free[c][_free_count[c]] = p;
+      ++_free_count[c];
+      _stats.in_use -= _bytes(c);
+   }
+
+   // The free buffers of class c are the first _free_count[c] of _free[c],
+   // which only shrinks in release(): popping the vector itself draws a
+   // -Warray-bounds false positive from GCC 12 once inlined.
+   std::array<std::vector<void*>, _classes> _free;
+   std::array<std::size_t, _classes> _free_count{};
+   allocator_stats _stats;
+};
+
+// The calling thread's arena and pool, which need no locking; what they
+// hand out must not outlive the thread.
+inline arena & thread_arena()
+{
+   thread_local arena instance;
+   return instance;
+}
+
+inline buffer_pool & thread_buffer_pool()
+{
+   thread_local buffer_pool instance;
+   return instance;
+}
+
+} // namespace fps
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <span>
+
+#include "fps/fp16_storage_t.hh"
+#include "half-private/execution.hh"
+
+namespace fps {
+
+// The bulk conversions under a standard execution policy, mapped as for
+// half::float_to_half_n (see half-private/execution.hh).
+template <half::half_private::_execution_policy Policy_>
+inline auto convert_h2f(Policy_ &&, std::span<const fp16_storage_t> src,
+                        std::span<fp32_storage_t> dst) noexcept -> void {
+  const half::half_private::_policy_scope<Policy_> scope;
+  convert_h2f(src, dst);
+}
+
+template <half::half_private::_execution_policy Policy_>
+inline auto convert_f2h(Policy_ &&, std::span<const fp32_storage_t> src,
+                        std::span<fp16_storage_t> dst) noexcept -> void {
+  const half::half_private::_policy_scope<Policy_> scope;
+  convert_f2h(src, dst);
+}
+
+} // namespace fps
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <cinttypes>
+#include <span>
 #include <type_traits>
 
 #include "half-private/fp_convert.hh"
+#include "half-private/fp_convert_n.hh"
+#include "half-private/fp_convert_table.hh"
 
 namespace fps {
 
@@ -25,9 +29,22 @@ constexpr inline auto from_underlying(std::underlying_type_t<E_> v) noexcept ->
 enum struct fp16_storage_t : std::uint16_t {};
 enum struct fp32_storage_t : std::uint32_t {};
 
+// Outside constant evaluation convert_h2f reads the half_to_float table with
+// FLOAT16_T_HALF_TO_FLOAT_TABLE, else uses F16C when the translation unit is
+// compiled for it. convert_f2h only does with FLOAT16_T_F16C_FLOAT_TO_HALF,
+// and then whenever the active backend has it, like the bulk version: the
+// hardware rounds differently (see half-private/fp_convert_f16c.hh).
 [[nodiscard]]
 constexpr inline auto convert_h2f(fp16_storage_t v) -> fp32_storage_t {
   auto uv = to_underlying(v);
+#if defined(FLOAT16_T_HALF_TO_FLOAT_TABLE)
+  if (!std::is_constant_evaluated())
+    return from_underlying<fp32_storage_t>(half::half_to_float_table(uv));
+#elif FLOAT16_T_HAS_X86_DISPATCH && defined(__F16C__)
+  if (!std::is_constant_evaluated())
+    return from_underlying<fp32_storage_t>(
+      half::half_private::_half_to_float_f16c(uv));
+#endif
   return from_underlying<fp32_storage_t>(half::half_to_float(uv));
 }
 
@@ -35,9 +52,47 @@ constexpr inline auto convert_h2f(fp16_storage_t v) -> fp32_storage_t {
 constexpr inline auto convert_f2h(fp32_storage_t v) -> fp16_storage_t
 {
   auto uv = to_underlying(v);
+#if FLOAT16_T_HAS_X86_DISPATCH && defined(FLOAT16_T_F16C_FLOAT_TO_HALF)
+  if (!std::is_constant_evaluated() &&
+      half::active_backend() >= half::backend::avx2)
+    return from_underlying<fp16_storage_t>(
+      half::half_private::_float_to_half_f16c(uv));
+#endif
   return from_underlying<fp16_storage_t>(half::float_to_half(uv));
 }
 
+// Bulk versions, converting min(src.size(), dst.size()) values, across
+// threads for large spans (see half::parallel_for).
+inline auto convert_h2f(std::span<const fp16_storage_t> src,
+                        std::span<fp32_storage_t> dst) noexcept -> void {
+#ifdef FLOAT16_T_HALF_TO_FLOAT_TABLE
+  constexpr auto convert = half::half_private::_half_to_float_n_table;
+#else
+  constexpr auto convert = half::half_private::_half_to_float_n;
+#endif
+  const auto *from = reinterpret_cast<const std::uint16_t *>(src.data());
+  auto *to = reinterpret_cast<std::uint32_t *>(dst.data());
+  half::parallel_for(dst.first(std::min(src.size(), dst.size())),
+                     [&](std::size_t i, std::size_t end) {
+                       convert(from + i, to + i, end - i);
+                     });
+}
+
+inline auto convert_f2h(std::span<const fp32_storage_t> src,
+                        std::span<fp16_storage_t> dst) noexcept -> void {
+#ifdef FLOAT16_T_F16C_FLOAT_TO_HALF
+  constexpr auto convert = half::half_private::_float_to_half_n_hw;
+#else
+  constexpr auto convert = half::half_private::_float_to_half_n;
+#endif
+  const auto *from = reinterpret_cast<const std::uint32_t *>(src.data());
+  auto *to = reinterpret_cast<std::uint16_t *>(dst.data());
+  half::parallel_for(dst.first(std::min(src.size(), dst.size())),
+                     [&](std::size_t i, std::size_t end) {
+                       convert(from + i, to + i, end - i);
+                     });
+}
+
 } // namespace fps
 
 namespace fps::literals {
@@ -0,0 +1,614 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "fps/aligned_array.hh"
+#include "fps/fp16_storage_t.hh"
+#include "half-private/dispatch.hh"
+#include "half-private/fp_convert_f16c.hh"
+#include "half-private/fp_convert_n.hh"
+#include "half-private/parallel.hh"
+#include "half-private/simd.hh"
+
+namespace fps {
+
+enum struct layout { row_major, col_major };
+
+// A rows x cols matrix: element (i, j) is at data[i * ld + j] in row_major
+// order and at data[i + j * ld] in col_major. ld = 0 means tightly packed
+// (cols for row_major, rows for col_major).
+template <typename Ty_> struct matrix_view {
+  Ty_ *data = nullptr;
+  std::size_t rows = 0;
+  std::size_t cols = 0;
+  std::size_t ld = 0;
+  layout order = layout::row_major;
+
+  [[nodiscard]] constexpr std::size_t row_stride() const noexcept {
+    if (order == layout::col_major)
+      return 1;
+    return ld != 0 ? ld : cols;
+  }
+
+  [[nodiscard]] constexpr std::size_t col_stride() const noexcept {
+    if (order == layout::row_major)
+      return 1;
+    return ld != 0 ? ld : rows;
+  }
+
+  // The same elements as a cols x rows matrix.
+  [[nodiscard]] constexpr matrix_view transposed() const noexcept {
+    const layout other = order == layout::row_major ? layout::col_major
+                                                    : layout::row_major;
+    return {data, cols, rows, ld, other};
+  }
+};
+
+} // namespace fps
+
+namespace fps::fps_private {
+
+using half::half_private::_kernel_table;
+
+// Blocking: gemm computes C in tiles of up to _gemm_tile_blocks blocks of
+// _gemm_mc rows by _gemm_nc columns, adding the products of _gemm_kc-wide
+// panels of A and B. A packed block of A (fp32, 120 KiB) and the panel of B
+// (fp16, 512 KiB) stay in L2, the strip of B a micro-kernel walks (16 KiB at
+// most) in L1; each panel of B serves the whole tile and each block of A
+// 1024 columns. _gemm_mc is a multiple of every micro-kernel's rows,
+// _gemm_nc of every micro-kernel's columns.
+inline constexpr std::size_t _gemm_mc = 120;
+inline constexpr std::size_t _gemm_nc = 1024;
+inline constexpr std::size_t _gemm_kc = 256;
+inline constexpr std::size_t _gemm_tile_blocks = 4;
+inline constexpr std::size_t _gemm_align = 64;
+inline constexpr std::size_t _gemm_lines = 16 * _gemm_kc;
+
+// Below this many multiply-adds per thread gemm uses fewer threads.
+inline constexpr std::size_t _gemm_parallel_min = 0x400000;
+
+// C (m x n) = alpha A (m x k) B (k x n) + beta C on the bits of A and B, C
+// row major; element (i, j) of A is at a[i * a_rs + j * a_cs]. Tiles of C
+// span tile_rows rows (a multiple of _gemm_mc) and _gemm_nc columns.
+template <typename C_> struct _gemm_problem {
+  const std::uint16_t *a;
+  std::size_t a_rs, a_cs;
+  const std::uint16_t *b;
+  std::size_t b_rs, b_cs;
+  C_ *c;
+  std::size_t c_rs;
+  std::size_t m, n, k;
+  float alpha, beta;
+  std::size_t tile_rows;
+};
+
+// Per thread: the packed panels of A (fp32) and B (Kernel_::element), the
+// fp32 accumulators of a tile of C and lines of converted elements (enough
+// for _gemm_kc columns of every micro-kernel's rows).
+template <typename B_> struct _gemm_buffers {
+  aligned_array<float, _gemm_mc * _gemm_kc, _gemm_align> a;
+  aligned_array<B_, _gemm_kc * _gemm_nc, _gemm_align> b;
+  aligned_array<float, _gemm_tile_blocks * _gemm_mc * _gemm_nc, _gemm_align>
+    c;
+  aligned_array<std::uint32_t, _gemm_lines, _gemm_align> lines;
+};
+
+// Packs the mc x kc block of A at a as fp32 strips of MR_ rows, each stored
+// column after column; the rows past mc up to a multiple of MR_ are zero.
+// The rows (or columns) of A are widened into lines first, MR_ rows (or one
+// column) at a time, so that the strips are written in order.
+template <std::size_t MR_>
+inline void _gemm_pack_a(const std::uint16_t *a, std::size_t rs,
+                         std::size_t cs, std::size_t mc, std::size_t kc,
+                         float *dst, std::uint32_t *lines) noexcept {
+  using half::half_private::_half_to_float_n;
+  const std::size_t mc_up = (mc + MR_ - 1) / MR_ * MR_;
+  if (cs == 1) {
+    for (std::size_t i = 0; i < mc_up; i += MR_, dst += MR_ * kc) {
+      for (std::size_t r = 0; r < MR_; ++r)
+        if (i + r < mc)
+          _half_to_float_n(a + (i + r) * rs, lines + r * kc, kc);
+        else
+          std::fill_n(lines + r * kc, kc, 0u);
+      for (std::size_t p = 0; p < kc; ++p)
+        for (std::size_t r = 0; r < MR_; ++r)
+          dst[p * MR_ + r] = std::bit_cast<float>(lines[r * kc + p]);
+    }
+    return;
+  }
+  for (std::size_t p = 0; p < kc; ++p) {
+    _half_to_float_n(a + p * cs, lines, mc);
+    std::fill(lines + mc, lines + mc_up, 0u);
+    for (std::size_t i = 0; i < mc_up; i += MR_)
+      std::memcpy(dst + i * kc + p * MR_, lines + i, MR_ * sizeof(float));
+  }
+}
+
+// Packs the kc x nc block of B at b as strips of NR_ columns, each stored
+// row after row; the columns past nc up to a multiple of NR_ are zero. The
+// strips stay fp16 (B_ = std::uint16_t) for micro-kernels that widen on
+// load and are widened here (fp32 bits) for those that cannot. The lines of
+// B are read in order, a row (or column) at a time.
+template <std::size_t NR_, typename B_>
+inline void _gemm_pack_b(const std::uint16_t *b, std::size_t rs,
+                         std::size_t cs, std::size_t kc, std::size_t nc,
+                         B_ *dst, std::uint32_t *lines) noexcept {
+  using half::half_private::_half_to_float_n;
+  const std::size_t nc_up = (nc + NR_ - 1) / NR_ * NR_;
+  if (cs == 1) {
+    for (std::size_t p = 0; p < kc; ++p) {
+      const B_ *line;
+      if constexpr (sizeof(B_) == sizeof(std::uint16_t)) {
+        line = b + p * rs;
+      } else {
+        _half_to_float_n(b + p * rs, lines, nc);
+        line = lines;
+      }
+      std::size_t j = 0;
+      for (; j + NR_ <= nc; j += NR_)
+        std::memcpy(dst + j * kc + p * NR_, line + j, NR_ * sizeof(B_));
+      if (j < nc) {
+        B_ *to = dst + j * kc + p * NR_;
+        std::memcpy(to, line + j, (nc - j) * sizeof(B_));
+        std::fill(to + (nc - j), to + NR_, B_(0));
+      }
+    }
+    return;
+  }
+  for (std::size_t j = 0; j < nc_up; ++j) {
+    B_ *to = dst + j / NR_ * NR_ * kc + j % NR_;
+    const B_ *line;
+    if constexpr (sizeof(B_) == sizeof(std::uint16_t)) {
+      line = b + j * cs;
+    } else {
+      if (j < nc)
+        _half_to_float_n(b + j * cs, lines, kc);
+      line = lines;
+    }
+    for (std::size_t p = 0; p < kc; ++p)
+      to[p * NR_] = j < nc ? line[p] : B_(0);
+  }
+}
+
+// The mr x nr accumulators at c (row stride ldc) += the kc columns of a
+// packed strip of A times the kc rows of a packed strip of B.
+struct _gemm_kernel_scalar {
+  static constexpr std::size_t mr = 4;
+  static constexpr std::size_t nr = 4;
+  using element = std::uint32_t;
+
+  static void run(std::size_t kc, const float *a, const element *b, float *c,
+                  std::size_t ldc) noexcept {
+    float acc[mr][nr];
+    for (std::size_t r = 0; r < mr; ++r)
+      std::memcpy(acc[r], c + r * ldc, sizeof(acc[r]));
+    for (std::size_t p = 0; p < kc; ++p) {
+      float b_p[nr];
+      std::memcpy(b_p, b + p * nr, sizeof(b_p));
+      for (std::size_t r = 0; r < mr; ++r)
+        for (std::size_t j = 0; j < nr; ++j)
+          acc[r][j] += a[p * mr + r] * b_p[j];
+    }
+    for (std::size_t r = 0; r < mr; ++r)
+      std::memcpy(c + r * ldc, acc[r], sizeof(acc[r]));
+  }
+};
+
+#if FLOAT16_T_HAS_VECTOR_EXT
+
+using half::half_private::_simd;
+
+// Ops_ loads Ops_::lanes elements of B as fp32 lanes, broadcasts elements of
+// A and multiply-adds them; the accumulators of an MR_ x NR_ tile live in
+// registers for the whole strip.
+template <std::size_t MR_, std::size_t NR_, typename Ops_>
+FLOAT16_T_SIMD_INLINE void
+_gemm_micro_kernel(std::size_t kc, const float *a,
+                   const typename Ops_::element *b, float *c,
+                   std::size_t ldc) noexcept {
+  constexpr std::size_t N_ = Ops_::lanes;
+  constexpr std::size_t V_ = NR_ / N_;
+  using vf = typename _simd<N_>::f32;
+  vf acc[MR_][V_];
+#pragma GCC unroll 16
+  for (std::size_t r = 0; r < MR_; ++r)
+#pragma GCC unroll 4
+    for (std::size_t v = 0; v < V_; ++v)
+      std::memcpy(&acc[r][v], c + r * ldc + v * N_, sizeof(vf));
+  for (std::size_t p = 0; p < kc; ++p) {
+    vf b_p[V_];
+#pragma GCC unroll 4
+    for (std::size_t v = 0; v < V_; ++v)
+      Ops_::load(b_p[v], b + p * NR_ + v * N_);
+#pragma GCC unroll 16
+    for (std::size_t r = 0; r < MR_; ++r) {
+      vf a_r;
+      Ops_::splat(a_r, a + p * MR_ + r);
+#pragma GCC unroll 4
+      for (std::size_t v = 0; v < V_; ++v)
+        Ops_::madd(acc[r][v], a_r, b_p[v]);
+    }
+  }
+#pragma GCC unroll 16
+  for (std::size_t r = 0; r < MR_; ++r)
+#pragma GCC unroll 4
+    for (std::size_t v = 0; v < V_; ++v)
+      std::memcpy(c + r * ldc + v * N_, &acc[r][v], sizeof(vf));
+}
+
+// B widened when packed; without FMA the multiply and add round separately.
+template <std::size_t N_> struct _gemm_ops_f32 {
+  static constexpr std::size_t lanes = N_;
+  using element = std::uint32_t;
+  using vf = typename _simd<N_>::f32;
+
+  FLOAT16_T_SIMD_INLINE static void load(vf &f,
+                                         const std::uint32_t *b) noexcept {
+    std::memcpy(&f, b, sizeof(f));
+  }
+
+  FLOAT16_T_SIMD_INLINE static void splat(vf &f, const float *a) noexcept {
+    f = vf{} + *a;
+  }
+
+  FLOAT16_T_SIMD_INLINE static void madd(vf &acc, const vf &a,
+                                         const vf &b) noexcept {
+    acc += a * b;
+  }
+};
+
+struct _gemm_kernel_simd128 {
+  static constexpr std::size_t mr = 6;
+  static constexpr std::size_t nr = 8;
+  using element = std::uint32_t;
+
+  static void run(std::size_t kc, const float *a, const element *b, float *c,
+                  std::size_t ldc) noexcept {
+    _gemm_micro_kernel<mr, nr, _gemm_ops_f32<4>>(kc, a, b, c, ldc);
+  }
+};
+
+#endif // FLOAT16_T_HAS_VECTOR_EXT
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+
+// B stays fp16 in the packed strips and is widened with vcvtph2ps as the
+// micro-kernel loads it: half the bytes of fp32 strips through L1 and L2.
+struct _gemm_ops_f16c : half::half_private::_half_widen_f16c {
+  using element = std::uint16_t;
+
+  FLOAT16_T_TARGET_AVX2 static inline void splat(_simd<8>::f32 &f,
+                                                 const float *a) noexcept {
+    f = (_simd<8>::f32)_mm256_broadcast_ss(a);
+  }
+
+  FLOAT16_T_TARGET_AVX2 static inline void
+  madd(_simd<8>::f32 &acc, const _simd<8>::f32 &a,
+       const _simd<8>::f32 &b) noexcept {
+    acc = (_simd<8>::f32)_mm256_fmadd_ps((__m256)a, (__m256)b, (__m256)acc);
+  }
+};
+
+struct _gemm_ops_avx512_f16c : half::half_private::_half_widen_avx512_f16c {
+  using element = std::uint16_t;
+
+  FLOAT16_T_TARGET_AVX512 static inline void splat(_simd<16>::f32 &f,
+                                                   const float *a) noexcept {
+    f = (_simd<16>::f32)_mm512_set1_ps(*a);
+  }
+
+  FLOAT16_T_TARGET_AVX512 static inline void
+  madd(_simd<16>::f32 &acc, const _simd<16>::f32 &a,
+       const _simd<16>::f32 &b) noexcept {
+    acc = (_simd<16>::f32)_mm512_fmadd_ps((__m512)a, (__m512)b, (__m512)acc);
+  }
+};
+
+// 12 (6 x 2) of the 16 ymm registers and 24 (12 x 2) of the 32 zmm
+// registers hold accumulators.
+struct _gemm_kernel_avx2 {
+  static constexpr std::size_t mr = 6;
+  static constexpr std::size_t nr = 16;
+  using element = std::uint16_t;
+
+  FLOAT16_T_TARGET_AVX2 static void run(std::size_t kc, const float *a,
+                                        const element *b, float *c,
+                                        std::size_t ldc) noexcept {
+    _gemm_micro_kernel<mr, nr, _gemm_ops_f16c>(kc, a, b, c, ldc);
+  }
+};
+
+struct _gemm_kernel_avx512 {
+  static constexpr std::size_t mr = 12;
+  static constexpr std::size_t nr = 32;
+  using element = std::uint16_t;
+
+  FLOAT16_T_TARGET_AVX512 static void run(std::size_t kc, const float *a,
+                                          const element *b, float *c,
+                                          std::size_t ldc) noexcept {
+    _gemm_micro_kernel<mr, nr, _gemm_ops_avx512_f16c>(kc, a, b, c, ldc);
+  }
+};
+
+#endif // FLOAT16_T_HAS_X86_DISPATCH
+
+// C = alpha * the accumulated tile + beta * C, not reading C when beta is 0
+// (so that NaNs in it do not propagate, like BLAS).
+inline void _gemm_store(const _gemm_problem<float> &pr, std::size_t i0,
+                        std::size_t j0, std::size_t mc, std::size_t nc,
+                        const float *tile, std::uint32_t *) noexcept {
+  for (std::size_t i = 0; i < mc; ++i) {
+    float *to = pr.c + (i0 + i) * pr.c_rs + j0;
+    const float *from = tile + i * _gemm_nc;
+    if (pr.beta == 0.0f)
+      for (std::size_t j = 0; j < nc; ++j)
+        to[j] = pr.alpha * from[j];
+    else
+      for (std::size_t j = 0; j < nc; ++j)
+        to[j] = pr.alpha * from[j] + pr.beta * to[j];
+  }
+}
+
+inline void _gemm_store(const _gemm_problem<std::uint16_t> &pr,
+                        std::size_t i0, std::size_t j0, std::size_t mc,
+                        std::size_t nc, const float *tile,
+                        std::uint32_t *line) noexcept {
+  for (std::size_t i = 0; i < mc; ++i) {
+    std::uint16_t *to = pr.c + (i0 + i) * pr.c_rs + j0;
+    const float *from = tile + i * _gemm_nc;
+    if (pr.beta == 0.0f) {
+      for (std::size_t j = 0; j < nc; ++j)
+        line[j] = std::bit_cast<std::uint32_t>(pr.alpha * from[j]);
+    } else {
+      half::half_private::_half_to_float_n(to, line, nc);
+      for (std::size_t j = 0; j < nc; ++j)
+        line[j] = std::bit_cast<std::uint32_t>(
+          pr.alpha * from[j] + pr.beta * std::bit_cast<float>(line[j]));
+    }
+    convert_f2h(std::span{reinterpret_cast<const fp32_storage_t *>(line), nc},
+                std::span{reinterpret_cast<fp16_storage_t *>(to), nc});
+  }
+}
+
+// One tile of C at (i0, j0): the accumulators start at zero, take the
+// products of every panel pair along k and are stored once, so fp16 C is
+// rounded once. Each panel of B is packed once for the whole tile.
+template <typename Kernel_, typename C_>
+inline void _gemm_tile(const _gemm_problem<C_> &pr, std::size_t i0,
+                       std::size_t j0,
+                       _gemm_buffers<typename Kernel_::element> &buffers) {
+  constexpr std::size_t mr = Kernel_::mr;
+  constexpr std::size_t nr = Kernel_::nr;
+  const std::size_t mt = std::min(pr.tile_rows, pr.m - i0);
+  const std::size_t nc = std::min(_gemm_nc, pr.n - j0);
+  const std::size_t mt_up = (mt + mr - 1) / mr * mr;
+  const std::size_t nc_up = (nc + nr - 1) / nr * nr;
+  float *tile = buffers.c.data();
+  for (std::size_t i = 0; i < mt_up; ++i)
+    std::fill_n(tile + i * _gemm_nc, nc_up, 0.0f);
+  for (std::size_t p0 = 0; p0 < pr.k; p0 += _gemm_kc) {
+    const std::size_t kc = std::min(_gemm_kc, pr.k - p0);
+    _gemm_pack_b<nr>(pr.b + p0 * pr.b_rs + j0 * pr.b_cs, pr.b_rs, pr.b_cs, kc,
+                     nc, buffers.b.data(), buffers.lines.data());
+    for (std::size_t i1 = 0; i1 < mt; i1 += _gemm_mc) {
+      const std::size_t mc = std::min(_gemm_mc, mt - i1);
+      const std::size_t mc_up = (mc + mr - 1) / mr * mr;
+      _gemm_pack_a<mr>(pr.a + (i0 + i1) * pr.a_rs + p0 * pr.a_cs, pr.a_rs,
+                       pr.a_cs, mc, kc, buffers.a.data(),
+                       buffers.lines.data());
+      for (std::size_t j = 0; j < nc_up; j += nr)
+        for (std::size_t i = 0; i < mc_up; i += mr)
+          Kernel_::run(kc, buffers.a.data() + i * kc,
+                       buffers.b.data() + j * kc,
+                       tile + (i1 + i) * _gemm_nc + j, _gemm_nc);
+    }
+  }
+  _gemm_store(pr, i0, j0, mt, nc, tile, buffers.lines.data());
+}
+
+[[nodiscard]] inline std::size_t _gemm_tiles(std::size_t m, std::size_t n,
+                                             std::size_t tile_rows) noexcept {
+  if (m == 0 || n == 0)
+    return 0;
+  return (m + tile_rows - 1) / tile_rows * ((n + _gemm_nc - 1) / _gemm_nc);
+}
+
+// The threads take tiles of C in turn, across the problems of a batch;
+// each packs its own panels, and a bad_alloc for them reaches the caller
+// through _on_threads.
+template <typename Kernel_, typename C_>
+inline void _gemm_run(std::span<const _gemm_problem<C_>> problems,
+                      unsigned threads) {
+  static_assert(_gemm_mc % Kernel_::mr == 0 && _gemm_nc % Kernel_::nr == 0);
+  static_assert(Kernel_::mr * _gemm_kc <= _gemm_lines &&
+                _gemm_nc <= _gemm_lines);
+  using buffers_t = _gemm_buffers<typename Kernel_::element>;
+  std::vector<std::size_t> first_tile(problems.size() + 1);
+  for (std::size_t i = 0; i < problems.size(); ++i)
+    first_tile[i + 1] =
+      first_tile[i] +
+      _gemm_tiles(problems[i].m, problems[i].n, problems[i].tile_rows);
+  std::atomic<std::size_t> next{0};
+  half::half_private::_on_threads(threads, [&](unsigned) {
+    const std::unique_ptr<buffers_t> buffers{new buffers_t};
+    std::size_t i = 0;
+    for (std::size_t t; (t = next.fetch_add(1, std::memory_order_relaxed)) <
+                        first_tile.back();) {
+      while (first_tile[i + 1] <= t)
+        ++i;
+      const _gemm_problem<C_> &pr = problems[i];
+      const std::size_t n_tiles = (pr.n + _gemm_nc - 1) / _gemm_nc;
+      const std::size_t tile = t - first_tile[i];
+      _gemm_tile<Kernel_>(pr, tile / n_tiles * pr.tile_rows,
+                          tile % n_tiles * _gemm_nc, *buffers);
+    }
+  });
+}
+
+template <typename C_>
+using _gemm_fn = void(std::span<const _gemm_problem<C_>>, unsigned);
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+
+template <typename C_>
+inline constexpr _kernel_table<_gemm_fn<C_>> _gemm_kernels{
+  {_gemm_run<_gemm_kernel_scalar, C_>, _gemm_run<_gemm_kernel_simd128, C_>,
+   _gemm_run<_gemm_kernel_avx2, C_>, _gemm_run<_gemm_kernel_avx512, C_>}};
+
+#elif FLOAT16_T_HAS_VECTOR_EXT
+
+template <typename C_>
+inline constexpr _kernel_table<_gemm_fn<C_>> _gemm_kernels{
+  {_gemm_run<_gemm_kernel_scalar, C_>, _gemm_run<_gemm_kernel_simd128, C_>,
+   _gemm_run<_gemm_kernel_simd128, C_>, _gemm_run<_gemm_kernel_simd128, C_>}};
+
+#else
+
+template <typename C_>
+inline constexpr _kernel_table<_gemm_fn<C_>> _gemm_kernels{
+  {_gemm_run<_gemm_kernel_scalar, C_>, _gemm_run<_gemm_kernel_scalar, C_>,
+   _gemm_run<_gemm_kernel_scalar, C_>, _gemm_run<_gemm_kernel_scalar, C_>}};
+
+#endif
+
+// Up to threads tasks (0: the executor's threads), each with at least
+// _gemm_parallel_min multiply-adds and a tile or block of C.
+[[nodiscard]] inline unsigned _gemm_threads(std::size_t work,
+                                            std::size_t tiles,
+                                            unsigned threads) noexcept {
+  threads = half::half_private::_threads_or_concurrency(threads);
+  const std::size_t useful =
+    std::max<std::size_t>(1, work / _gemm_parallel_min);
+  return unsigned(
+    std::max<std::size_t>(1, std::min({std::size_t(threads), tiles, useful})));
+}
+
+// As many blocks of rows per tile as leave a tile for every thread.
+[[nodiscard]] inline std::size_t _gemm_tile_rows(std::size_t m, std::size_t n,
+                                                 unsigned threads) noexcept {
+  const std::size_t m_blocks = (m + _gemm_mc - 1) / _gemm_mc;
+  const std::size_t n_tiles = (n + _gemm_nc - 1) / _gemm_nc;
+  const std::size_t per_tile = std::clamp<std::size_t>(
+    m_blocks * n_tiles / threads, 1, _gemm_tile_blocks);
+  return std::max<std::size_t>(1, std::min(per_tile, m_blocks)) * _gemm_mc;
+}
+
+// The problem over the leading blocks the shapes agree on, with C row
+// major: a column major C is transposed, C^T = B^T A^T. tile_rows is left
+// to the caller.
+template <typename C_, typename Ty_>
+[[nodiscard]] inline _gemm_problem<C_>
+_gemm_problem_of(float alpha, matrix_view<const fp16_storage_t> a,
+                 matrix_view<const fp16_storage_t> b, float beta,
+                 matrix_view<Ty_> c) noexcept {
+  if (c.order == layout::col_major) {
+    const matrix_view<const fp16_storage_t> b_t = a.transposed();
+    a = b.transposed();
+    b = b_t;
+    c = c.transposed();
+  }
+  return {reinterpret_cast<const std::uint16_t *>(a.data),
+          a.row_stride(),
+          a.col_stride(),
+          reinterpret_cast<const std::uint16_t *>(b.data),
+          b.row_stride(),
+          b.col_stride(),
+          reinterpret_cast<C_ *>(c.data),
+          c.row_stride(),
+          std::min(a.rows, c.rows),
+          std::min(b.cols, c.cols),
+          std::min(a.cols, b.rows),
+          alpha,
+          beta,
+          _gemm_mc};
+}
+
+template <typename C_, typename Ty_>
+inline void _gemm(float alpha, matrix_view<const fp16_storage_t> a,
+                  matrix_view<const fp16_storage_t> b, float beta,
+                  matrix_view<Ty_> c, unsigned threads) {
+  _gemm_problem<C_> pr = _gemm_problem_of<C_>(alpha, a, b, beta, c);
+  if (pr.m == 0 || pr.n == 0)
+    return;
+  threads = _gemm_threads(pr.m * pr.n * pr.k,
+                          _gemm_tiles(pr.m, pr.n, _gemm_mc), threads);
+  pr.tile_rows = _gemm_tile_rows(pr.m, pr.n, threads);
+  _gemm_kernels<C_>[half::active_backend()](std::span{&pr, 1}, threads);
+}
+
+// Every problem gets tiles as large as one thread would use, and the
+// threads share out the tiles of the whole batch.
+template <typename C_, typename Ty_>
+inline void
+_gemm_batched(float alpha, std::span<const matrix_view<const fp16_storage_t>> a,
+              std::span<const matrix_view<const fp16_storage_t>> b, float beta,
+              std::span<const matrix_view<Ty_>> c, unsigned threads) {
+  const std::size_t count = std::min({a.size(), b.size(), c.size()});
+  std::vector<_gemm_problem<C_>> problems;
+  problems.reserve(count);
+  std::size_t work = 0, tiles = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    _gemm_problem<C_> pr = _gemm_problem_of<C_>(alpha, a[i], b[i], beta, c[i]);
+    pr.tile_rows = _gemm_tile_rows(pr.m, pr.n, 1);
+    work += pr.m * pr.n * pr.k;
+    tiles += _gemm_tiles(pr.m, pr.n, pr.tile_rows);
+    problems.push_back(pr);
+  }
+  if (tiles == 0)
+    return;
+  _gemm_kernels<C_>[half::active_backend()](
+    problems, _gemm_threads(work, tiles, threads));
+}
+
+} // namespace fps::fps_private
+
+namespace fps {
+
+// C = alpha A B + beta C over the leading min(a.rows, c.rows) x
+// min(b.cols, c.cols) block of C and min(a.cols, b.rows) columns of A, in
+// any mix of layouts. The products accumulate in fp32 (with FMA on the avx2
+// and avx512 backends) and fp16 C is rounded once, at the end. C is not
+// read when beta is 0. Tiles of C are spread over up to `threads` tasks on
+// half::active_executor() (0: one per thread it has), each taking at least
+// 2^22 multiply-adds.
+inline void gemm(float alpha, matrix_view<const fp16_storage_t> a,
+                 matrix_view<const fp16_storage_t> b, float beta,
+                 matrix_view<fp32_storage_t> c, unsigned threads = 0) {
+  fps_private::_gemm<float>(alpha, a, b, beta, c, threads);
+}
+
+inline void gemm(float alpha, matrix_view<const fp16_storage_t> a,
+                 matrix_view<const fp16_storage_t> b, float beta,
+                 matrix_view<fp16_storage_t> c, unsigned threads = 0) {
+  fps_private::_gemm<std::uint16_t>(alpha, a, b, beta, c, threads);
+}
+
+// gemm on each of the first min(a.size(), b.size(), c.size()) triples, for
+// many small products (attention heads, per-sample layers): the problems
+// share one set of packing buffers per thread and their tiles are spread
+// over the threads together. The C matrices must not overlap.
+inline void
+gemm_batched(float alpha, std::span<const matrix_view<const fp16_storage_t>> a,
+             std::span<const matrix_view<const fp16_storage_t>> b, float beta,
+             std::span<const matrix_view<fp32_storage_t>> c,
+             unsigned threads = 0) {
+  fps_private::_gemm_batched<float>(alpha, a, b, beta, c, threads);
+}
+
+inline void
+gemm_batched(float alpha, std::span<const matrix_view<const fp16_storage_t>> a,
+             std::span<const matrix_view<const fp16_storage_t>> b, float beta,
+             std::span<const matrix_view<fp16_storage_t>> c,
+             unsigned threads = 0) {
+  fps_private::_gemm_batched<std::uint16_t>(alpha, a, b, beta, c, threads);
+}
+
+} // namespace fps
@@ -0,0 +1,344 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#include "fps/aligned_buffer.hh"
+#include "fps/fp16_storage_t.hh"
+#include "fps/gemm.hh"
+#include "half-private/dispatch.hh"
+#include "half-private/fp_convert_f16c.hh"
+#include "half-private/fp_convert_n.hh"
+#include "half-private/parallel.hh"
+#include "half-private/simd.hh"
+
+namespace fps::fps_private {
+
+// Rows of y computed per kernel call, and the rows each thread's share is
+// rounded to (a cache line of fp32 y and of each column of a column major
+// A).
+inline constexpr std::size_t _gemv_block = 0x400;
+inline constexpr std::size_t _gemv_grain = 0x40;
+
+// Halves per cache line, and how far ahead (1 KiB) the streams of A are
+// prefetched.
+inline constexpr std::size_t _gemv_line = 0x20;
+inline constexpr std::size_t _gemv_prefetch = 0x200;
+
+// Rows of a row major A that share each load of x, columns of a column major
+// A that share each load and store of y.
+inline constexpr std::size_t _gemv_streams = 4;
+
+// Below this many elements of A (2 MiB) per thread gemv uses fewer threads.
+inline constexpr std::size_t _gemv_parallel_min = 0x100000;
+
+[[nodiscard]] inline float _gemv_widen(std::uint16_t h) noexcept {
+  return std::bit_cast<float>(half::half_to_float(h));
+}
+
+// out[i] = the dot product of row i of A (row stride lda) and x[0, n), for
+// i < rows.
+inline void _gemv_rows_scalar(const std::uint16_t *a, std::size_t lda,
+                              const float *x, std::size_t n, std::size_t rows,
+                              float *out) noexcept {
+  for (std::size_t i = 0; i < rows; ++i) {
+    float sum = 0.0f;
+    for (std::size_t j = 0; j < n; ++j)
+      sum += _gemv_widen(a[i * lda + j]) * x[j];
+    out[i] = sum;
+  }
+}
+
+// out[i] = sum over j < n of x[j] times element i of column j of A (column
+// stride lda), for i < rows.
+inline void _gemv_cols_scalar(const std::uint16_t *a, std::size_t lda,
+                              const float *x, std::size_t n, std::size_t rows,
+                              float *out) noexcept {
+  std::fill_n(out, rows, 0.0f);
+  for (std::size_t j = 0; j < n; ++j)
+    for (std::size_t i = 0; i < rows; ++i)
+      out[i] += x[j] * _gemv_widen(a[j * lda + i]);
+}
+
+#if FLOAT16_T_HAS_VECTOR_EXT
+
+// Widen_ loads Widen_::lanes halves as fp32 lanes. Each step reads a cache
+// line from each of _gemv_streams rows and prefetches further along them.
+template <typename Widen_>
+FLOAT16_T_SIMD_INLINE void
+_gemv_rows_kernel(const std::uint16_t *a, std::size_t lda, const float *x,
+                  std::size_t n, std::size_t rows, float *out) noexcept {
+  constexpr std::size_t N_ = Widen_::lanes;
+  using vf = typename half::half_private::_simd<N_>::f32;
+  std::size_t i = 0;
+  for (; i + _gemv_streams <= rows; i += _gemv_streams) {
+    const std::uint16_t *row[_gemv_streams];
+    vf acc[_gemv_streams] = {};
+    for (std::size_t r = 0; r < _gemv_streams; ++r)
+      row[r] = a + (i + r) * lda;
+    std::size_t j = 0;
+    for (; j + N_ <= n; j += N_) {
+      if (j % _gemv_line == 0)
+        for (std::size_t r = 0; r < _gemv_streams; ++r)
+          __builtin_prefetch(row[r] + j + _gemv_prefetch);
+      vf x_v;
+      std::memcpy(&x_v, x + j, sizeof(x_v));
+      for (std::size_t r = 0; r < _gemv_streams; ++r) {
+        vf a_v;
+        Widen_::load(a_v, row[r] + j);
+        acc[r] += a_v * x_v;
+      }
+    }
+    for (std::size_t r = 0; r < _gemv_streams; ++r) {
+      float lanes[N_];
+      std::memcpy(lanes, &acc[r], sizeof(lanes));
+      float sum = 0.0f;
+      for (std::size_t lane = 0; lane < N_; ++lane)
+        sum += lanes[lane];
+      for (std::size_t tail = j; tail < n; ++tail)
+        sum += _gemv_widen(row[r][tail]) * x[tail];
+      out[i + r] = sum;
+    }
+  }
+  _gemv_rows_scalar(a + i * lda, lda, x, n, rows - i, out + i);
+}
+
+// Adds _gemv_streams columns at a time into out, prefetching the next
+// columns at the same rows.
+template <typename Widen_>
+FLOAT16_T_SIMD_INLINE void
+_gemv_cols_kernel(const std::uint16_t *a, std::size_t lda, const float *x,
+                  std::size_t n, std::size_t rows, float *out) noexcept {
+  constexpr std::size_t N_ = Widen_::lanes;
+  using vf = typename half::half_private::_simd<N_>::f32;
+  std::fill_n(out, rows, 0.0f);
+  std::size_t j = 0;
+  for (; j + _gemv_streams <= n; j += _gemv_streams) {
+    const std::uint16_t *col[_gemv_streams];
+    vf x_v[_gemv_streams];
+    for (std::size_t c = 0; c < _gemv_streams; ++c) {
+      col[c] = a + (j + c) * lda;
+      x_v[c] = vf{} + x[j + c];
+    }
+    std::size_t i = 0;
+    for (; i + N_ <= rows; i += N_) {
+      if (i % _gemv_line == 0)
+        for (std::size_t c = 0; c < _gemv_streams; ++c)
+          __builtin_prefetch(col[c] + _gemv_streams * lda + i);
+      vf sum;
+      std::memcpy(&sum, out + i, sizeof(sum));
+      for (std::size_t c = 0; c < _gemv_streams; ++c) {
+        vf a_v;
+        Widen_::load(a_v, col[c] + i);
+        sum += x_v[c] * a_v;
+      }
+      std::memcpy(out + i, &sum, sizeof(sum));
+    }
+    for (; i < rows; ++i)
+      for (std::size_t c = 0; c < _gemv_streams; ++c)
+        out[i] += x[j + c] * _gemv_widen(col[c][i]);
+  }
+  for (; j < n; ++j)
+    for (std::size_t i = 0; i < rows; ++i)
+      out[i] += x[j] * _gemv_widen(a[j * lda + i]);
+}
+
+inline void _gemv_rows_simd128(const std::uint16_t *a, std::size_t lda,
+                               const float *x, std::size_t n, std::size_t rows,
+                               float *out) noexcept {
+  _gemv_rows_kernel<half::half_private::_half_widen_emulated<4>>(a, lda, x, n,
+                                                                 rows, out);
+}
+
+inline void _gemv_cols_simd128(const std::uint16_t *a, std::size_t lda,
+                               const float *x, std::size_t n, std::size_t rows,
+                               float *out) noexcept {
+  _gemv_cols_kernel<half::half_private::_half_widen_emulated<4>>(a, lda, x, n,
+                                                                 rows, out);
+}
+
+#endif // FLOAT16_T_HAS_VECTOR_EXT
+
+using _gemv_fn = void(const std::uint16_t *, std::size_t, const float *,
+                      std::size_t, std::size_t, float *) noexcept;
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+
+FLOAT16_T_TARGET_AVX2 inline void
+_gemv_rows_avx2(const std::uint16_t *a, std::size_t lda, const float *x,
+                std::size_t n, std::size_t rows, float *out) noexcept {
+  _gemv_rows_kernel<half::half_private::_half_widen_f16c>(a, lda, x, n, rows,
+                                                          out);
+}
+
+FLOAT16_T_TARGET_AVX2 inline void
+_gemv_cols_avx2(const std::uint16_t *a, std::size_t lda, const float *x,
+                std::size_t n, std::size_t rows, float *out) noexcept {
+  _gemv_cols_kernel<half::half_private::_half_widen_f16c>(a, lda, x, n, rows,
+                                                          out);
+}
+
+FLOAT16_T_TARGET_AVX512 inline void
+_gemv_rows_avx512(const std::uint16_t *a, std::size_t lda, const float *x,
+                  std::size_t n, std::size_t rows, float *out) noexcept {
+  _gemv_rows_kernel<half::half_private::_half_widen_avx512_f16c>(a, lda, x, n,
+                                                                 rows, out);
+}
+
+FLOAT16_T_TARGET_AVX512 inline void
+_gemv_cols_avx512(const std::uint16_t *a, std::size_t lda, const float *x,
+                  std::size_t n, std::size_t rows, float *out) noexcept {
+  _gemv_cols_kernel<half::half_private::_half_widen_avx512_f16c>(a, lda, x, n,
+                                                                 rows, out);
+}
+
+inline constexpr _kernel_table<_gemv_fn> _gemv_rows_kernels{
+  {_gemv_rows_scalar, _gemv_rows_simd128, _gemv_rows_avx2,
+   _gemv_rows_avx512}};
+
+inline constexpr _kernel_table<_gemv_fn> _gemv_cols_kernels{
+  {_gemv_cols_scalar, _gemv_cols_simd128, _gemv_cols_avx2,
+   _gemv_cols_avx512}};
+
+#elif FLOAT16_T_HAS_VECTOR_EXT
+
+inline constexpr _kernel_table<_gemv_fn> _gemv_rows_kernels{
+  {_gemv_rows_scalar, _gemv_rows_simd128, _gemv_rows_simd128,
+   _gemv_rows_simd128}};
+
+inline constexpr _kernel_table<_gemv_fn> _gemv_cols_kernels{
+  {_gemv_cols_scalar, _gemv_cols_simd128, _gemv_cols_simd128,
+   _gemv_cols_simd128}};
+
+#else
+
+inline constexpr _kernel_table<_gemv_fn> _gemv_rows_kernels{
+  {_gemv_rows_scalar, _gemv_rows_scalar, _gemv_rows_scalar,
+   _gemv_rows_scalar}};
+
+inline constexpr _kernel_table<_gemv_fn> _gemv_cols_kernels{
+  {_gemv_cols_scalar, _gemv_cols_scalar, _gemv_cols_scalar,
+   _gemv_cols_scalar}};
+
+#endif
+
+// Up to threads tasks (0: the executor's threads), each with at least
+// _gemv_parallel_min elements of A and _gemv_grain rows of y.
+[[nodiscard]] inline unsigned _gemv_threads(std::size_t m, std::size_t n,
+                                            unsigned threads) noexcept {
+  threads = half::half_private::_threads_or_concurrency(threads);
+  const std::size_t useful = std::min(m * n / _gemv_parallel_min,
+                                      (m + _gemv_grain - 1) / _gemv_grain);
+  return unsigned(
+    std::max<std::size_t>(1, std::min(std::size_t(threads), useful)));
+}
+
+// y = alpha out + beta y, not reading y when beta is 0.
+inline void _gemv_store(float alpha, const float *out, float beta, float *y,
+                        std::size_t rows) noexcept {
+  if (beta == 0.0f)
+    for (std::size_t i = 0; i < rows; ++i)
+      y[i] = alpha * out[i];
+  else
+    for (std::size_t i = 0; i < rows; ++i)
+      y[i] = alpha * out[i] + beta * y[i];
+}
+
+inline void _gemv_store(float alpha, const float *out, float beta,
+                        std::uint16_t *y, std::size_t rows) noexcept {
+  std::uint32_t line[_gemv_block];
+  if (beta == 0.0f) {
+    for (std::size_t i = 0; i < rows; ++i)
+      line[i] = std::bit_cast<std::uint32_t>(alpha * out[i]);
+  } else {
+    half::half_private::_half_to_float_n(y, line, rows);
+    for (std::size_t i = 0; i < rows; ++i)
+      line[i] = std::bit_cast<std::uint32_t>(
+        alpha * out[i] + beta * std::bit_cast<float>(line[i]));
+  }
+  convert_f2h(std::span{reinterpret_cast<const fp32_storage_t *>(line), rows},
+              std::span{reinterpret_cast<fp16_storage_t *>(y), rows});
+}
+
+// x is widened once; the threads take slices of y, in blocks of
+// _gemv_block rows, each streaming its rows of A once.
+template <typename X_, typename Y_>
+inline void _gemv(float alpha, matrix_view<const fp16_storage_t> a,
+                  std::span<const X_> x, float beta, std::span<Y_> y,
+                  unsigned threads) {
+  using y_bits = std::conditional_t<std::is_same_v<Y_, fp32_storage_t>, float,
+                                    std::uint16_t>;
+  const std::size_t m = std::min(a.rows, y.size());
+  const std::size_t n = std::min(a.cols, x.size());
+  if (m == 0)
+    return;
+  aligned_buffer<std::uint32_t> x_wide;
+  const float *x_f = reinterpret_cast<const float *>(x.data());
+  if constexpr (std::is_same_v<X_, fp16_storage_t>) {
+    x_wide.resize(n);
+    half::half_private::_half_to_float_n(
+      reinterpret_cast<const std::uint16_t *>(x.data()), x_wide.data(), n);
+    x_f = reinterpret_cast<const float *>(x_wide.data());
+  }
+  const bool rows = a.order == layout::row_major;
+  const std::size_t lda = rows ? a.row_stride() : a.col_stride();
+  _gemv_fn *const kernel =
+    (rows ? _gemv_rows_kernels : _gemv_cols_kernels)[half::active_backend()];
+  threads = _gemv_threads(m, n, threads);
+  const std::size_t grains = (m + _gemv_grain - 1) / _gemv_grain;
+  const std::size_t share = (grains + threads - 1) / threads * _gemv_grain;
+  const auto *a_bits = reinterpret_cast<const std::uint16_t *>(a.data);
+  auto *y_out = reinterpret_cast<y_bits *>(y.data());
+  half::half_private::_on_threads(threads, [&](unsigned t) {
+    alignas(_gemm_align) float out[_gemv_block];
+    const std::size_t end = t + 1 == threads ? m : std::min(m, (t + 1) * share);
+    for (std::size_t i = std::min(m, t * share); i < end; i += _gemv_block) {
+      const std::size_t block = std::min(_gemv_block, end - i);
+      kernel(a_bits + (rows ? i * lda : i), lda, x_f, n, block, out);
+      _gemv_store(alpha, out, beta, y_out + i, block);
+    }
+  });
+}
+
+} // namespace fps::fps_private
+
+namespace fps {
+
+// y = alpha A x + beta y over the first min(a.rows, y.size()) elements of y
+// and min(a.cols, x.size()) columns of A, in either layout: the memory bound
+// matrix-vector product of batch-1 inference. A is read once, as fp16, and
+// widened in registers (F16C on the avx2 and avx512 backends); the products
+// accumulate in fp32 and fp16 y is rounded once. y is not read when beta is
+// 0. The rows of y are spread over up to `threads` tasks on
+// half::active_executor() (0: one per thread it has), each reading at least
+// 2^20 elements of A.
+inline void gemv(float alpha, matrix_view<const fp16_storage_t> a,
+                 std::span<const fp32_storage_t> x, float beta,
+                 std::span<fp32_storage_t> y, unsigned threads = 0) {
+  fps_private::_gemv(alpha, a, x, beta, y, threads);
+}
+
+inline void gemv(float alpha, matrix_view<const fp16_storage_t> a,
+                 std::span<const fp16_storage_t> x, float beta,
+                 std::span<fp32_storage_t> y, unsigned threads = 0) {
+  fps_private::_gemv(alpha, a, x, beta, y, threads);
+}
+
+inline void gemv(float alpha, matrix_view<const fp16_storage_t> a,
+                 std::span<const fp32_storage_t> x, float beta,
+                 std::span<fp16_storage_t> y, unsigned threads = 0) {
+  fps_private::_gemv(alpha, a, x, beta, y, threads);
+}
+
+inline void gemv(float alpha, matrix_view<const fp16_storage_t> a,
+                 std::span<const fp16_storage_t> x, float beta,
+                 std::span<fp16_storage_t> y, unsigned threads = 0) {
+  fps_private::_gemv(alpha, a, x, beta, y, threads);
+}
+
+} // namespace fps
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <thread>
+#include <vector>
+
+// fd_source and fd_sink need read and write from <unistd.h>; without it, as
+// with MSVC, only the iostream sources and sinks are declared.
+#if __has_include(<unistd.h>)
+#define FPS_HAS_FD_STREAMS 1
+#include <unistd.h>
+#else
+#define FPS_HAS_FD_STREAMS 0
+#endif
+
+#include "fps/aligned_buffer.hh"
+#include "fps/fp16_storage_t.hh"
+
+namespace fps {
+
+// Reads up to the span's size in bytes; the count read, 0 at the end and
+// negative on errors.
+using stream_source = std::function<std::ptrdiff_t(std::span<std::byte>)>;
+// Writes all of the span; false on errors.
+using stream_sink = std::function<bool(std::span<const std::byte>)>;
+
+// Sources and sinks over a file descriptor (retrying EINTR and short
+// writes) and over iostreams. They keep references: fd and the stream
+// must outlive the conversion.
+#if FPS_HAS_FD_STREAMS
+[[nodiscard]] inline stream_source fd_source(int fd) {
+  return [fd](std::span<std::byte> bytes) -> std::ptrdiff_t {
+    for (;;) {
+      const ssize_t n = ::read(fd, bytes.data(), bytes.size());
+      if (n >= 0 || errno != EINTR)
+        return n;
+    }
+  };
+}
+
+[[nodiscard]] inline stream_sink fd_sink(int fd) {
+  return [fd](std::span<const std::byte> bytes) {
+    while (!bytes.empty()) {
+      const ssize_t n = ::write(fd, bytes.data(), bytes.size());
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      bytes = bytes.subspan(std::size_t(n));
+    }
+    return true;
+  };
+}
+#endif // FPS_HAS_FD_STREAMS
+
+[[nodiscard]] inline stream_source istream_source(std::istream &in) {
+  return [&in](std::span<std::byte> bytes) -> std::ptrdiff_t {
+    in.read(reinterpret_cast<char *>(bytes.data()),
+            std::streamsize(bytes.size()));
+    return in.bad() ? -1 : std::ptrdiff_t(in.gcount());
+  };
+}
+
+[[nodiscard]] inline stream_sink ostream_sink(std::ostream &out) {
+  return [&out](std::span<const std::byte> bytes) {
+    out.write(reinterpret_cast<const char *>(bytes.data()),
+              std::streamsize(bytes.size()));
+    return bool(out);
+  };
+}
+
+enum struct stream_conversion { f32_to_f16, f16_to_f32 };
+
+struct stream_result {
+  // Elements converted and written.
+  std::size_t elements = 0;
+  // False if the source or the sink failed, or the input ended inside an
+  // element (its bytes are dropped).
+  bool ok = true;
+};
+
+} // namespace fps
+
+namespace fps::fps_private {
+
+// A queue of chunk indices between two pipeline stages; closing it wakes
+// the consumer once the queue has drained.
+class _chunk_queue {
+public:
+  void push(std::size_t chunk) {
+    {
+      const std::lock_guard lock(_mutex);
+      _chunks.push_back(chunk);
+    }
+    _ready.notify_one();
+  }
+
+  void close() {
+    {
+      const std::lock_guard lock(_mutex);
+      _closed = true;
+    }
+    _ready.notify_one();
+  }
+
+  // False once the queue is closed and empty.
+  [[nodiscard]] bool pop(std::size_t &chunk) {
+    std::unique_lock lock(_mutex);
+    _ready.wait(lock, [this] { return !_chunks.empty() || _closed; });
+    if (_chunks.empty())
+      return false;
+    chunk = _chunks.front();
+    _chunks.pop_front();
+    return true;
+  }
+
+private:
+  std::mutex _mutex;
+  std::condition_variable _ready;
+  std::deque<std::size_t> _chunks;
+  bool _closed = false;
+};
+
+} // namespace fps::fps_private
+
+namespace fps {
+
+// Converts a stream of fp32 values to fp16 or back in chunks of
+// chunk_elements, with `buffers` chunks in flight: while the calling thread
+// reads chunk i + 2, a worker converts chunk i + 1 and another writes
+// chunk i, so a large file takes about as long as its slowest stage and
+// memory stays at buffers * chunk_elements * 6 bytes, whatever the size.
+// Values are in the machine's byte order. An exception from source or sink
+// stops the conversion and is rethrown by run once both workers have
+// returned (the source's first if both throw).
+class stream_converter {
+public:
+  explicit stream_converter(stream_conversion conversion,
+                            std::size_t chunk_elements = std::size_t{1} << 20,
+                            std::size_t buffers = 3)
+      : _conversion(conversion),
+        _chunk_elements(std::max<std::size_t>(1, chunk_elements)),
+        _buffers(std::max<std::size_t>(2, buffers)) {}
+
+  stream_result run(const stream_source &source, const stream_sink &sink) {
+    const bool to_half = _conversion == stream_conversion::f32_to_f16;
+    const std::size_t in_size = to_half ? 4 : 2, out_size = to_half ? 2 : 4;
+    struct chunk {
+      aligned_buffer<std::byte> in, out;
+      std::size_t elements = 0;
+    };
+    std::vector<chunk> chunks(_buffers);
+    for (chunk &c : chunks) {
+      c.in = aligned_buffer<std::byte>(_chunk_elements * in_size);
+      c.out = aligned_buffer<std::byte>(_chunk_elements * out_size);
+    }
+    fps_private::_chunk_queue empty, read, converted;
+    for (std::size_t i = 0; i < _buffers; ++i)
+      empty.push(i);
+    stream_result result;
+    std::mutex result_mutex;
+    bool sink_failed = false;
+    std::exception_ptr source_error, sink_error;
+
+    std::thread converter([&] {
+      for (std::size_t i; read.pop(i);) {
+        chunk &c = chunks[i];
+        if (to_half)
+          convert_f2h(
+            {reinterpret_cast<const fp32_storage_t *>(c.in.data()), c.elements},
+            {reinterpret_cast<fp16_storage_t *>(c.out.data()), c.elements});
+        else
+          convert_h2f(
+            {reinterpret_cast<const fp16_storage_t *>(c.in.data()), c.elements},
+            {reinterpret_cast<fp32_storage_t *>(c.out.data()), c.elements});
+        converted.push(i);
+      }
+      converted.close();
+    });
+    std::thread writer([&] {
+      for (std::size_t i; converted.pop(i);) {
+        const chunk &c = chunks[i];
+        const bool failed = [&] {
+          const std::lock_guard lock(result_mutex);
+          return sink_failed;
+        }();
+        if (!failed) {
+          bool written = false;
+          try {
+            written = sink({c.out.data(), c.elements * out_size});
+          } catch (...) {
+            sink_error = std::current_exception();
+          }
+          const std::lock_guard lock(result_mutex);
+          sink_failed = !written;
+          if (written)
+            result.elements += c.elements;
+        }
+        empty.push(i);
+      }
+    });
+
+    // Fills whole chunks, so that only the last one is short.
+    bool source_ok = true, partial = false;
+    try {
+      for (std::size_t i; source_ok && empty.pop(i);) {
+        {
+          const std::lock_guard lock(result_mutex);
+          if (sink_failed)
+            break;
+        }
+        chunk &c = chunks[i];
+        std::size_t filled = 0;
+        const std::size_t capacity = _chunk_elements * in_size;
+        while (filled < capacity) {
+          const std::ptrdiff_t n =
+            source({c.in.data() + filled, capacity - filled});
+          if (n <= 0) {
+            source_ok = n == 0;
+            break;
+          }
+          filled += std::size_t(n);
+        }
+        partial = filled % in_size != 0;
+        c.elements = filled / in_size;
+        if (c.elements != 0)
+          read.push(i);
+        if (filled < capacity)
+          break;
+      }
+    } catch (...) {
+      source_error = std::current_exception();
+    }
+    read.close();
+    converter.join();
+    writer.join();
+    if (source_error)
+      std::rethrow_exception(source_error);
+    if (sink_error)
+      std::rethrow_exception(sink_error);
+    result.ok = source_ok && !partial && !sink_failed;
+    return result;
+  }
+
+private:
+  stream_conversion _conversion;
+  std::size_t _chunk_elements;
+  std::size_t _buffers;
+};
+
+} // namespace fps
@@ -0,0 +1,421 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// The file is written with write and read through mmap, so the header is
+// empty where there is no <sys/mman.h>, as with MSVC; FPS_HAS_TENSOR_FILE
+// tells which.
+#if __has_include(<sys/mman.h>) && __has_include(<unistd.h>)
+#define FPS_HAS_TENSOR_FILE 1
+#else
+#define FPS_HAS_TENSOR_FILE 0
+#endif
+
+#if FPS_HAS_TENSOR_FILE
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fps/fp16_storage_t.hh"
+
+// A file of named fp16 and fp32 tensors, read through mmap without copies.
+// All fields are little endian:
+//
+//   header (64 bytes): "FPSTNSR\0", version (u32), alignment (u32), tensor
+//     count (u64), then zeros
+//   entries (128 bytes each): name (48 bytes, zero padded), dtype (u32),
+//     rank (u32), payload offset from the start of the file (u64), payload
+//     bytes (u64), dims (6 x u64, unused ones 0), then zeros
+//   payloads, each at a multiple of alignment (64), zero padded between
+//
+// so that every payload can be viewed in place with the alignment SIMD
+// kernels want.
+
+namespace fps
+{
+
+enum struct tensor_dtype : std::uint32_t
+{
+   fp16 = 1,
+   fp32 = 2,
+};
+
+inline constexpr std::size_t tensor_file_version = 1;
+inline constexpr std::size_t tensor_file_alignment = 64;
+inline constexpr std::size_t tensor_max_rank = 6;
+inline constexpr std::size_t tensor_max_name = 48;
+
+// What a tensor_file asks of the kernel when mapping a file.
+enum struct map_prefetch
+{
+   // Pages are read as they are first touched: opening costs the same for
+   // any file size.
+   none,
+   // madvise(MADV_WILLNEED): read ahead in the background.
+   willneed,
+   // MAP_POPULATE where available (Linux): read everything before open
+   // returns, so that no access faults later.
+   populate,
+};
+
+// A tensor to write: its payload is data, shape.size() <= tensor_max_rank
+// dims whose product is the element count (1 for rank 0).
+struct tensor_source
+{
+   std::string_view name;
+   tensor_dtype dtype = tensor_dtype::fp16;
+   std::span<const std::size_t> shape;
+   std::span<const std::byte> data;
+
+   tensor_source(std::string_view n, std::span<const std::size_t> s,
+                 std::span<const fp16_storage_t> d) noexcept
+      : name(n), dtype(tensor_dtype::fp16), shape(s), data(std::as_bytes(d))
+   {}
+
+   tensor_source(std::string_view n, std::span<const std::size_t> s,
+                 std::span<const fp32_storage_t> d) noexcept
+      : name(n), dtype(tensor_dtype::fp32), shape(s), data(std::as_bytes(d))
+   {}
+};
+
+// A tensor of an open tensor_file.
+struct tensor_info
+{
+   std::string_view name;
+   tensor_dtype dtype = tensor_dtype::fp16;
+   // The first rank dims of shape are used.
+   std::array<std::size_t, tensor_max_rank> shape{};
+   std::size_t rank = 0;
+   std::size_t elements = 0;
+};
+
+} // namespace fps
+
+namespace fps::fps_private {
+
+inline constexpr char _tensor_magic[8] = {'F', 'P', 'S', 'T',
+                                          'N', 'S', 'R', '\0'};
+inline constexpr std::size_t _tensor_header_bytes = 64;
+inline constexpr std::size_t _tensor_entry_bytes = 128;
+
+struct _tensor_header
+{
+   char magic[8];
+   std::uint32_t version;
+   std::uint32_t alignment;
+   std::uint64_t count;
+   std::uint8_t zeros[40];
+};
+
+struct _tensor_entry
+{
+   char name[tensor_max_name];
+   std::uint32_t dtype;
+   std::uint32_t rank;
+   std::uint64_t offset;
+   std::uint64_t bytes;
+   std::uint64_t dims[tensor_max_rank];
+   std::uint8_t zeros[8];
+};
+
+static_assert(sizeof(_tensor_header) == _tensor_header_bytes &&
+              sizeof(_tensor_entry) == _tensor_entry_bytes);
+
+[[nodiscard]] inline std::size_t _tensor_element_bytes(std::uint32_t dtype)
+   noexcept
+{
+   return dtype == std::uint32_t(tensor_dtype::fp16) ? 2
+        : dtype == std::uint32_t(tensor_dtype::fp32) ? 4
+                                                     : 0;
+}
+
+[[nodiscard]] inline std::size_t _tensor_align(std::size_t offset) noexcept
+{
+   return (offset + tensor_file_alignment - 1) / tensor_file_alignment *
+          tensor_file_alignment;
+}
+
+// Writes all of bytes, retrying short writes and EINTR.
+[[nodiscard]] inline bool _write_all(int fd, const void *bytes,
+                                     std::size_t n) noexcept
+{
+   const auto *p = static_cast<const std::byte *>(bytes);
+   while (n != 0) {
+      const ssize_t written = ::write(fd, p, n);
+      if (written < 0 && errno == EINTR)
+         continue;
+      if (written <= 0)
+         return false;
+      p += written;
+      n -= std::size_t(written);
+   }
+   return true;
+}
+
+} // namespace fps::fps_private
+
+namespace fps
+{
+
+// Writes tensors to path (replacing it). False, with errno set, if a
+// tensor is malformed (EINVAL: a name longer than tensor_max_name, too
+// many dims, or data not of the shape's size) or the file cannot be
+// written.
+[[nodiscard]] inline bool
+write_tensor_file(const char *path, std::span<const tensor_source> tensors)
+{
+   using namespace fps_private;
+   std::vector<_tensor_entry> entries(tensors.size());
+   std::size_t offset = _tensor_align(_tensor_header_bytes +
+                                      tensors.size() * _tensor_entry_bytes);
+   for (std::size_t i = 0; i < tensors.size(); ++i) {
+      const tensor_source &t = tensors[i];
+      _tensor_entry &e = entries[i];
+      std::memset(&e, 0, sizeof(e));
+      std::size_t elements = 1;
+      for (const std::size_t d : t.shape)
+         elements *= d;
+      const std::size_t bytes =
+         elements * _tensor_element_bytes(std::uint32_t(t.dtype));
+      if (t.name.size() > tensor_max_name || t.shape.size() > tensor_max_rank ||
+          bytes != t.data.size()) {
+         errno = EINVAL;
+         return false;
+      }
+      std::copy(t.name.begin(), t.name.end(), e.name);
+      e.dtype = std::uint32_t(t.dtype);
+      e.rank = std::uint32_t(t.shape.size());
+      e.offset = offset;
+      e.bytes = bytes;
+      std::copy(t.shape.begin(), t.shape.end(), e.dims);
+      offset = _tensor_align(offset + bytes);
+   }
+   _tensor_header header;
+   std::memset(&header, 0, sizeof(header));
+   std::memcpy(header.magic, _tensor_magic, sizeof(header.magic));
+   header.version = tensor_file_version;
+   header.alignment = tensor_file_alignment;
+   header.count = tensors.size();
+
+   const int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0)
+      return false;
+   constexpr std::byte zeros[tensor_file_alignment] = {};
+   bool ok = _write_all(fd, &header, sizeof(header)) &&
+             _write_all(fd, entries.data(),
+                        entries.size() * sizeof(entries[0]));
+   std::size_t written =
+      _tensor_header_bytes + tensors.size() * _tensor_entry_bytes;
+   for (std::size_t i = 0; ok && i < tensors.size(); ++i) {
+      ok = _write_all(fd, zeros, entries[i].offset - written) &&
+           _write_all(fd, tensors[i].data.data(), tensors[i].data.size());
+      written = entries[i].offset + entries[i].bytes;
+   }
+   // Pads the last payload too, so that views of it may read whole vectors.
+   ok = ok && _write_all(fd, zeros, _tensor_align(written) - written);
+   const int saved = errno;
+   if (::close(fd) != 0 && ok)
+      return false;
+   errno = saved;
+   return ok;
+}
+
+// A tensor file mapped read-only: the views point into the mapping, valid
+// while the tensor_file lives. Move-only.
+class tensor_file
+{
+public:
+   // nullopt, with errno set, if path cannot be opened or mapped, or is not
+   // a valid tensor file (EINVAL; also on big endian hosts).
+   [[nodiscard]] static std::optional<tensor_file>
+   open(const char *path, map_prefetch prefetch = map_prefetch::none)
+   {
+      const int fd = ::open(path, O_RDONLY);
+      if (fd < 0)
+         return std::nullopt;
+      struct stat st;
+      if (::fstat(fd, &st) != 0) {
+         const int saved = errno;
+         ::close(fd);
+         errno = saved;
+         return std::nullopt;
+      }
+      tensor_file file;
+      file._bytes = std::size_t(st.st_size);
+      int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+      if (prefetch == map_prefetch::populate)
+         flags |= MAP_POPULATE;
+#endif
+      void *map = file._bytes == 0
+                     ? MAP_FAILED
+                     : ::mmap(nullptr, file._bytes, PROT_READ, flags, fd, 0);
+      const int saved = file._bytes == 0 ? EINVAL : errno;
+      ::close(fd);
+      if (map == MAP_FAILED) {
+         errno = saved;
+         return std::nullopt;
+      }
+      file._map = static_cast<const std::byte *>(map);
+      if (prefetch == map_prefetch::willneed)
+         ::madvise(map, file._bytes, MADV_WILLNEED);
+      if (!file._valid()) {
+         errno = EINVAL;
+         return std::nullopt;
+      }
+      return file;
+   }
+
+   tensor_file(tensor_file &&other) noexcept
+      : _map(std::exchange(other._map, nullptr)),
+        _bytes(std::exchange(other._bytes, 0))
+   {}
+
+   tensor_file & operator=(tensor_file &&other) noexcept
+   {
+      std::swap(_map, other._map);
+      std::swap(_bytes, other._bytes);
+      return *this;
+   }
+
+   ~tensor_file()
+   {
+      if (_map)
+         ::munmap(const_cast<std::byte *>(_map), _bytes);
+   }
+
+   [[nodiscard]] std::size_t size() const noexcept
+   { return _header().count; }
+
+   [[nodiscard]] tensor_info info(std::size_t i) const noexcept
+   {
+      const fps_private::_tensor_entry e = _entry(i);
+      tensor_info t;
+      const std::string_view name{_entry_name(i), tensor_max_name};
+      t.name = name.substr(0, name.find('\0'));
+      t.dtype = tensor_dtype(e.dtype);
+      t.rank = e.rank;
+      std::copy_n(e.dims, e.rank, t.shape.begin());
+      t.elements = e.bytes / fps_private::_tensor_element_bytes(e.dtype);
+      return t;
+   }
+
+   // The index of the first tensor called name.
+   [[nodiscard]] std::optional<std::size_t> find(std::string_view name) const
+      noexcept
+   {
+      for (std::size_t i = 0; i < size(); ++i)
+         if (info(i).name == name)
+            return i;
+      return std::nullopt;
+   }
+
+   // The payload of tensor i in place; empty unless its dtype is Ty_'s.
+   template <typename Ty_>
+      requires (std::is_same_v<Ty_, fp16_storage_t> ||
+                std::is_same_v<Ty_, fp32_storage_t>)
+   [[nodiscard]] std::span<const Ty_> view(std::size_t i) const noexcept
+   {
+      const fps_private::_tensor_entry e = _entry(i);
+      if (e.dtype != std::uint32_t(std::is_same_v<Ty_, fp16_storage_t>
+                                      ? tensor_dtype::fp16
+                                      : tensor_dtype::fp32))
+         return {};
+      return {reinterpret_cast<const Ty_ *>(_map + e.offset),
+              e.bytes / sizeof(Ty_)};
+   }
+
+   // Asks the kernel to read tensor i ahead (MADV_WILLNEED), e.g. for the
+   // next layer while this one computes.
+   void prefetch(std::size_t i) const noexcept
+   {
+      const fps_private::_tensor_entry e = _entry(i);
+      const std::size_t page = std::size_t(::sysconf(_SC_PAGESIZE));
+      const std::size_t begin = e.offset / page * page;
+      ::madvise(const_cast<std::byte *>(_map) + begin,
+                e.offset + e.bytes - begin, MADV_WILLNEED);
+   }
+
+private:
+   tensor_file() noexcept = default;
+
+   [[nodiscard]] fps_private::_tensor_header _header() const noexcept
+   {
+      fps_private::_tensor_header h;
+      std::memcpy(&h, _map, sizeof(h));
+      return h;
+   }
+
+   [[nodiscard]] const char *_entry_name(std::size_t i) const noexcept
+   {
+      return reinterpret_cast<const char *>(
+         _map + fps_private::_tensor_header_bytes +
+         i * fps_private::_tensor_entry_bytes);
+   }
+
+   [[nodiscard]] fps_private::_tensor_entry _entry(std::size_t i) const
+      noexcept
+   {
+      fps_private::_tensor_entry e;
+      std::memcpy(&e, _entry_name(i), sizeof(e));
+      return e;
+   }
+
+   // The header, the entries and the payloads fit in the file, and each
+   // payload is aligned and a whole number of elements of a known dtype
+   // and of its shape's size.
+   [[nodiscard]] bool _valid() const noexcept
+   {
+      using namespace fps_private;
+      if constexpr (std::endian::native != std::endian::little)
+         return false;
+      if (_bytes < _tensor_header_bytes)
+         return false;
+      const _tensor_header h = _header();
+      if (std::memcmp(h.magic, _tensor_magic, sizeof(h.magic)) != 0 ||
+          h.version != tensor_file_version ||
+          h.alignment != tensor_file_alignment ||
+          h.count > (_bytes - _tensor_header_bytes) / _tensor_entry_bytes)
+         return false;
+      for (std::size_t i = 0; i < h.count; ++i) {
+         const _tensor_entry e = _entry(i);
+         const std::size_t element = _tensor_element_bytes(e.dtype);
+         if (element == 0 || e.rank > tensor_max_rank ||
+             e.offset % tensor_file_alignment != 0 || e.offset > _bytes ||
+             e.bytes > _bytes - e.offset)
+            return false;
+         using limits = std::numeric_limits<std::uint64_t>;
+         std::uint64_t elements = 1;
+         for (std::size_t d = 0; d < e.rank; ++d)
+         {
+            if (e.dims[d] != 0 && elements > limits::max() / e.dims[d])
+               return false;
+            elements *= e.dims[d];
+         }
+         if (elements > e.bytes / element || elements * element != e.bytes)
+            return false;
+      }
+      return true;
+   }
+
+   const std::byte *_map = nullptr;
+   std::size_t _bytes = 0;
+};
+
+} // namespace fps
+
+#endif // FPS_HAS_TENSOR_FILE
@@ -0,0 +1,710 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+#include "dispatch.hh"
+#include "float16_t.hpp"
+#include "parallel.hh"
+#include "simd.hh"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4146) // we use this as a bit trick, so no warning pz
+#endif
+
+namespace half::half_private {
+
+inline void _half_fma_n_scalar(const std::uint16_t *x, const std::uint16_t *y,
+                               const std::uint16_t *z, std::uint16_t *dst,
+                               std::size_t n) noexcept {
+  for (std::size_t i = 0; i < n; ++i)
+    dst[i] = half_fma(x[i], y[i], z[i]);
+}
+
+#if FLOAT16_T_HAS_VECTOR_EXT
+
+// Lane-wise copy of half::half_fma, bit-identical like the conversions in
+// fp_convert_n.hh.
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_vec_half_fma(typename _simd<N_>::u32 &c_result,
+              const typename _simd<N_>::u32 &x,
+              const typename _simd<N_>::u32 &y,
+              const typename _simd<N_>::u32 &z) noexcept {
+  using vu = typename _simd<N_>::u32;
+  using vs = typename _simd<N_>::s32;
+  const std::uint32_t one = (0x00000001);
+  const std::uint32_t h_s_mask = (0x00008000);
+  const std::uint32_t h_em_mask = (0x00007fff);
+  const std::uint32_t h_e_mask = (0x00007c00);
+  const std::uint32_t h_m_mask = (0x000003ff);
+  const std::uint32_t h_m_hidden = (0x00000400);
+  const std::uint32_t h_e_pos = (0x0000000a);
+  const std::uint32_t h_e_max_normal = (0x0000001e);
+  const std::uint32_t h_nan = (0x00007e00);
+  const std::uint32_t h_s_to_msb_sa = (0x00000010);
+  const std::uint32_t p_m_bits = (0x00000016);
+  const std::uint32_t z_m_bits = (0x0000000b);
+  const std::uint32_t z_e_offset = (0x00000019);
+  const std::uint32_t p_window_pos = (0x00000009);
+  const std::uint32_t z_window_pos = (0x00000014);
+  const std::uint32_t window_msb = (0x0000001f);
+  const std::uint32_t window_e_offset = (0x00000042);
+  const std::uint32_t c_m_grs_msb = (0x0000000d);
+  const std::uint32_t c_grs_size = (0x00000003);
+  const std::uint32_t c_grs_mask = (0x00000007);
+  const std::uint32_t c_grs_round_bias = (0x00000003);
+  const vu x_s = (x & h_s_mask);
+  const vu y_s = (y & h_s_mask);
+  const vu p_s = (x_s ^ y_s);
+  const vu z_s = (z & h_s_mask);
+  const vu x_em = (x & h_em_mask);
+  const vu y_em = (y & h_em_mask);
+  const vu z_em = (z & h_em_mask);
+  const vu x_e = (x_em >> h_e_pos);
+  const vu y_e = (y_em >> h_e_pos);
+  const vu z_e = (z_em >> h_e_pos);
+  const vu is_x_e_eqz_msb = (x_e - 1);
+  const vu is_y_e_eqz_msb = (y_e - 1);
+  const vu is_z_e_eqz_msb = (z_e - 1);
+  const vu x_m_hidden_bit = ((vs)is_x_e_eqz_msb < 0) ? vu{} : vu{} + h_m_hidden;
+  const vu y_m_hidden_bit = ((vs)is_y_e_eqz_msb < 0) ? vu{} : vu{} + h_m_hidden;
+  const vu z_m_hidden_bit = ((vs)is_z_e_eqz_msb < 0) ? vu{} : vu{} + h_m_hidden;
+  const vu x_m = ((x & h_m_mask) | x_m_hidden_bit);
+  const vu y_m = ((y & h_m_mask) | y_m_hidden_bit);
+  const vu z_m = ((z & h_m_mask) | z_m_hidden_bit);
+  const vu x_e_unpacked = (x_e | (is_x_e_eqz_msb >> 31));
+  const vu y_e_unpacked = (y_e | (is_y_e_eqz_msb >> 31));
+  const vu z_e_unpacked = (z_e | (is_z_e_eqz_msb >> 31));
+  const vu p_m = (x_m * y_m);
+  const vu p_top = (x_e_unpacked + y_e_unpacked + p_m_bits);
+  const vu z_top = (z_e_unpacked + z_e_offset + z_m_bits);
+  const vu is_z_top_larger_msb = (p_top - z_top);
+  const vu top = ((vs)is_z_top_larger_msb < 0) ? z_top : p_top;
+  const vu p_d = (top - p_top);
+  const vu z_d = (top - z_top);
+  const vu p_sa = (p_window_pos - p_d);
+  const vu z_sa = (z_window_pos - z_d);
+  const vu p_rsa_unclamped = (p_d - p_window_pos);
+  const vu z_rsa_unclamped = (z_d - z_window_pos);
+  const vu p_rsa_clamp_msb = (window_msb - p_rsa_unclamped);
+  const vu z_rsa_clamp_msb = (window_msb - z_rsa_unclamped);
+  const vu p_rsa_clamped =
+    ((vs)p_rsa_clamp_msb < 0) ? vu{} + window_msb : p_rsa_unclamped;
+  const vu z_rsa_clamped =
+    ((vs)z_rsa_clamp_msb < 0) ? vu{} + window_msb : z_rsa_unclamped;
+  const vu p_lsa = ((vs)p_sa < 0) ? vu{} : p_sa;
+  const vu z_lsa = ((vs)z_sa < 0) ? vu{} : z_sa;
+  const vu p_rsa = ((vs)p_sa < 0) ? p_rsa_clamped : vu{};
+  const vu z_rsa = ((vs)z_sa < 0) ? z_rsa_clamped : vu{};
+  const vu p_lost = (p_m & ((one << p_rsa) - 1));
+  const vu z_lost = (z_m & ((one << z_rsa) - 1));
+  const vu p_sticky = ((-p_lost) >> 31);
+  const vu z_sticky = ((-z_lost) >> 31);
+  const vu p_window = (((p_m << p_lsa) >> p_rsa) | p_sticky);
+  const vu z_window = (((z_m << z_lsa) >> z_rsa) | z_sticky);
+  const vu is_sub_msb = ((p_s ^ z_s) << h_s_to_msb_sa);
+  const vu is_z_larger_msb = (p_window - z_window);
+  const vu c_sum = (p_window + z_window);
+  const vu c_diff_pz = (p_window - z_window);
+  const vu c_diff_zp = (z_window - p_window);
+  const vu c_diff = ((vs)is_z_larger_msb < 0) ? c_diff_zp : c_diff_pz;
+  const vu is_c_s_z_msb = (is_sub_msb & is_z_larger_msb);
+  const vu c_window = ((vs)is_sub_msb < 0) ? c_diff : c_sum;
+  const vu c_s = ((vs)is_c_s_z_msb < 0) ? z_s : p_s;
+  vu c_nlz;
+  _vec_uint32_cntlz<N_>(c_nlz, c_window);
+  const vu c_msb = (window_msb - c_nlz);
+  const vu c_e = (c_msb + top - window_e_offset);
+  const vu is_c_denorm_msb = (c_e - 1);
+  const vu c_denorm_sa = (one - c_e);
+  const vu c_e_packed = ((vs)is_c_denorm_msb < 0) ? vu{} + one : c_e;
+  const vu c_norm_sa = (c_msb - c_m_grs_msb);
+  const vu c_extra_sa = ((vs)is_c_denorm_msb < 0) ? c_denorm_sa : vu{};
+  const vu c_sa = (c_norm_sa + c_extra_sa);
+  const vu c_lsa_unclamped = (-c_sa);
+  const vu c_rsa_clamp_msb = (window_msb - c_sa);
+  const vu c_rsa_clamped = ((vs)c_rsa_clamp_msb < 0) ? vu{} + window_msb : c_sa;
+  const vu c_lsa = ((vs)c_sa < 0) ? c_lsa_unclamped : vu{};
+  const vu c_rsa = ((vs)c_sa < 0) ? vu{} : c_rsa_clamped;
+  const vu c_lost = (c_window & ((one << c_rsa) - 1));
+  const vu c_sticky = ((-c_lost) >> 31);
+  const vu c_m_grs = (((c_window << c_lsa) >> c_rsa) | c_sticky);
+  const vu c_m = (c_m_grs >> c_grs_size);
+  const vu c_m_lsb = (c_m & one);
+  const vu c_grs = (c_m_grs & c_grs_mask);
+  const vu c_grs_biased = (c_grs + c_grs_round_bias);
+  const vu c_round = ((c_grs_biased + c_m_lsb) >> c_grs_size);
+  const vu c_e_inplace = ((c_e_packed - 1) << h_e_pos);
+  const vu c_em_unrounded = (c_e_inplace + c_m);
+  const vu c_em_norm = (c_em_unrounded + c_round);
+  const vu is_c_overflow_msb = (h_e_max_normal - c_e);
+  const vu is_c_zero_msb = (~c_window & (c_window - 1));
+  const vu c_s_zero = (p_s & z_s);
+  const vu is_x_nan_msb = (h_e_mask - x_em);
+  const vu is_y_nan_msb = (h_e_mask - y_em);
+  const vu is_z_nan_msb = (h_e_mask - z_em);
+  const vu is_x_inf_msb = ((x_em ^ h_e_mask) - 1);
+  const vu is_y_inf_msb = ((y_em ^ h_e_mask) - 1);
+  const vu is_z_inf_msb = ((z_em ^ h_e_mask) - 1);
+  const vu is_x_zero_msb = (x_em - 1);
+  const vu is_y_zero_msb = (y_em - 1);
+  const vu is_p_inf_msb = (is_x_inf_msb | is_y_inf_msb);
+  const vu is_p_inf_zero_msb =
+    ((is_x_inf_msb & is_y_zero_msb) | (is_y_inf_msb & is_x_zero_msb));
+  const vu is_inf_sub_msb = (is_p_inf_msb & is_z_inf_msb & is_sub_msb);
+  const vu is_nan_operand_msb = (is_x_nan_msb | is_y_nan_msb | is_z_nan_msb);
+  const vu is_c_nan_msb =
+    (is_nan_operand_msb | is_p_inf_zero_msb | is_inf_sub_msb);
+  const vu c_em_overflow_result =
+    ((vs)is_c_overflow_msb < 0) ? vu{} + h_e_mask : c_em_norm;
+  const vu c_common_result = (c_s | c_em_overflow_result);
+  const vu c_zero_result = ((vs)is_c_zero_msb < 0) ? c_s_zero : c_common_result;
+  const vu c_z_inf_result = ((vs)is_z_inf_msb < 0) ? z : c_zero_result;
+  const vu c_p_inf_result =
+    ((vs)is_p_inf_msb < 0) ? p_s | h_e_mask : c_z_inf_result;
+  c_result = ((vs)is_c_nan_msb < 0) ? vu{} + h_nan : c_p_inf_result;
+}
+
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_half_fma_n_kernel(const std::uint16_t *x, const std::uint16_t *y,
+                   const std::uint16_t *z, std::uint16_t *dst,
+                   std::size_t n) noexcept {
+  using vu = typename _simd<N_>::u32;
+  using vh = typename _simd<N_>::u16;
+  std::size_t i = 0;
+  for (; i + N_ <= n; i += N_) {
+    vh x_narrow, y_narrow, z_narrow;
+    std::memcpy(&x_narrow, x + i, sizeof(x_narrow));
+    std::memcpy(&y_narrow, y + i, sizeof(y_narrow));
+    std::memcpy(&z_narrow, z + i, sizeof(z_narrow));
+    const vu x_wide = __builtin_convertvector(x_narrow, vu);
+    const vu y_wide = __builtin_convertvector(y_narrow, vu);
+    const vu z_wide = __builtin_convertvector(z_narrow, vu);
+    vu c;
+    _vec_half_fma<N_>(c, x_wide, y_wide, z_wide);
+    const vh c_narrow = __builtin_convertvector(c, vh);
+    std::memcpy(dst + i, &c_narrow, sizeof(c_narrow));
+  }
+  _half_fma_n_scalar(x + i, y + i, z + i, dst + i, n - i);
+}
+
+inline void _half_fma_n_simd128(const std::uint16_t *x, const std::uint16_t *y,
+                                const std::uint16_t *z, std::uint16_t *dst,
+                                std::size_t n) noexcept {
+  _half_fma_n_kernel<4>(x, y, z, dst, n);
+}
+
+#endif // FLOAT16_T_HAS_VECTOR_EXT
+
+using _half_fma_n_fn = void(const std::uint16_t *, const std::uint16_t *,
+                            const std::uint16_t *, std::uint16_t *,
+                            std::size_t) noexcept;
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+
+FLOAT16_T_TARGET_AVX2 inline void
+_half_fma_n_avx2(const std::uint16_t *x, const std::uint16_t *y,
+                 const std::uint16_t *z, std::uint16_t *dst,
+                 std::size_t n) noexcept {
+  _half_fma_n_kernel<8>(x, y, z, dst, n);
+}
+
+FLOAT16_T_TARGET_AVX512 inline void
+_half_fma_n_avx512(const std::uint16_t *x, const std::uint16_t *y,
+                   const std::uint16_t *z, std::uint16_t *dst,
+                   std::size_t n) noexcept {
+  _half_fma_n_kernel<16>(x, y, z, dst, n);
+}
+
+inline constexpr _kernel_table<_half_fma_n_fn> _half_fma_n_kernels{
+  {_half_fma_n_scalar, _half_fma_n_simd128, _half_fma_n_avx2,
+   _half_fma_n_avx512}};
+
+#elif FLOAT16_T_HAS_VECTOR_EXT
+
+inline constexpr _kernel_table<_half_fma_n_fn> _half_fma_n_kernels{
+  {_half_fma_n_scalar, _half_fma_n_simd128, _half_fma_n_simd128,
+   _half_fma_n_simd128}};
+
+#else
+
+inline constexpr _kernel_table<_half_fma_n_fn> _half_fma_n_kernels{
+  {_half_fma_n_scalar, _half_fma_n_scalar, _half_fma_n_scalar,
+   _half_fma_n_scalar}};
+
+#endif
+
+inline void _half_fma_n(const std::uint16_t *x, const std::uint16_t *y,
+                        const std::uint16_t *z, std::uint16_t *dst,
+                        std::size_t n) noexcept {
+  _half_fma_n_kernels[active_backend()](x, y, z, dst, n);
+}
+
+enum struct _half_op { add, sub, mul };
+
+template <_half_op Op_>
+[[nodiscard]] constexpr inline std::uint16_t
+_half_op_scalar(std::uint16_t x, std::uint16_t y) noexcept {
+  if constexpr (Op_ == _half_op::add)
+    return half_add(x, y);
+  else if constexpr (Op_ == _half_op::sub)
+    return half_sub(x, y);
+  else
+    return half_mul(x, y);
+}
+
+// With Broadcast_, y points to a single value used for every element.
+template <_half_op Op_, bool Broadcast_>
+inline void _half_op_n_scalar(const std::uint16_t *x, const std::uint16_t *y,
+                              std::uint16_t *dst, std::size_t n) noexcept {
+  for (std::size_t i = 0; i < n; ++i)
+    dst[i] = _half_op_scalar<Op_>(x[i], y[Broadcast_ ? 0 : i]);
+}
+
+#if FLOAT16_T_HAS_VECTOR_EXT
+
+// Lane-wise copy of half::half_add in 16 bit lanes. The variable shifts go
+// through _vec_uint16_shl/_shr, which also match the scalar code for shift
+// counts of 16 or more. The nested selects of the scalar sign and exponent
+// are merged into one, which GCC otherwise splits into single lanes.
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_vec_half_add(typename _simd<N_>::u16 &c_result,
+              const typename _simd<N_>::u16 &x,
+              const typename _simd<N_>::u16 &y) noexcept {
+  using vh = typename _simd<N_>::u16;
+  using vs = typename _simd<N_>::s16;
+  const std::uint16_t one = (0x0001);
+  const std::uint16_t msb_to_lsb_sa = (0x000f);
+  const std::uint16_t h_s_mask = (0x8000);
+  const std::uint16_t h_e_mask = (0x7c00);
+  const std::uint16_t h_m_mask = (0x03ff);
+  const std::uint16_t h_m_msb_mask = (0x2000);
+  const std::uint16_t h_m_msb_sa = (0x000d);
+  const std::uint16_t h_m_hidden = (0x0400);
+  const std::uint16_t h_e_pos = (0x000a);
+  const std::uint16_t h_e_bias_minus_one = (0x000e);
+  const std::uint16_t h_m_grs_carry = (0x4000);
+  const std::uint16_t h_m_grs_carry_pos = (0x000e);
+  const std::uint16_t h_grs_size = (0x0003);
+  const std::uint16_t h_snan = (0xfe00);
+  const std::uint16_t h_e_mask_minus_one = (0x7bff);
+  const std::uint16_t h_grs_round_carry = (one << h_grs_size);
+  const std::uint16_t h_grs_round_mask = (h_grs_round_carry - one);
+  const vh x_e = (x & h_e_mask);
+  const vh y_e = (y & h_e_mask);
+  const vh is_y_e_larger_msb = (x_e - y_e);
+  const vh a = ((vs)is_y_e_larger_msb < 0) ? y : x;
+  const vh a_s = (a & h_s_mask);
+  const vh a_e = (a & h_e_mask);
+  const vh a_m_no_hidden_bit = (a & h_m_mask);
+  const vh a_em_no_hidden_bit = (a_e | a_m_no_hidden_bit);
+  const vh b = ((vs)is_y_e_larger_msb < 0) ? x : y;
+  const vh b_s = (b & h_s_mask);
+  const vh b_e = (b & h_e_mask);
+  const vh b_m_no_hidden_bit = (b & h_m_mask);
+  const vh b_em_no_hidden_bit = (b_e | b_m_no_hidden_bit);
+  const vh is_diff_sign_msb = (a_s ^ b_s);
+  const vh is_a_inf_msb = (h_e_mask_minus_one - a_em_no_hidden_bit);
+  const vh is_b_inf_msb = (h_e_mask_minus_one - b_em_no_hidden_bit);
+  const vh is_undenorm_msb = (a_e - 1);
+  const vh is_undenorm = (vh)((vs)is_undenorm_msb >> 15);
+  const vh is_both_inf_msb = (is_a_inf_msb & is_b_inf_msb);
+  const vh is_invalid_inf_op_msb = (is_both_inf_msb & b_s);
+  const vh is_a_e_nez_msb = (-a_e);
+  const vh is_b_e_nez_msb = (-b_e);
+  const vh is_a_e_nez = (vh)((vs)is_a_e_nez_msb >> 15);
+  const vh is_b_e_nez = (vh)((vs)is_b_e_nez_msb >> 15);
+  const vh a_m_hidden_bit = (is_a_e_nez & h_m_hidden);
+  const vh b_m_hidden_bit = (is_b_e_nez & h_m_hidden);
+  const vh a_m_no_grs = (a_m_no_hidden_bit | a_m_hidden_bit);
+  const vh b_m_no_grs = (b_m_no_hidden_bit | b_m_hidden_bit);
+  const vh diff_e = (a_e - b_e);
+  const vh a_e_unbias = (a_e - h_e_bias_minus_one);
+  const vh a_m = (a_m_no_grs << h_grs_size);
+  const vh a_e_biased = (a_e >> h_e_pos);
+  const vh m_sa_unbias = (a_e_unbias >> h_e_pos);
+  const vh m_sa_default = (diff_e >> h_e_pos);
+  const vh m_sa_unbias_mask = (is_a_e_nez_msb & ~is_b_e_nez_msb);
+  const vh m_sa = ((vs)m_sa_unbias_mask < 0) ? m_sa_unbias : m_sa_default;
+  const vh b_m_no_sticky = (b_m_no_grs << h_grs_size);
+  const vh one_v = vh{} + one;
+  vh sh_m, sticky_overflow;
+  _vec_uint16_shr<N_>(sh_m, b_m_no_sticky, m_sa);
+  _vec_uint16_shl<N_>(sticky_overflow, one_v, m_sa);
+  const vh sticky_mask = (sticky_overflow - 1);
+  const vh sticky_collect = (b_m_no_sticky & sticky_mask);
+  const vh is_sticky_set_msb = (-sticky_collect);
+  const vh sticky = (is_sticky_set_msb >> msb_to_lsb_sa);
+  const vh b_m = (sh_m | sticky);
+  const vh is_c_m_ab_pos_msb = (b_m - a_m);
+  const vh c_inf = (a_s | h_e_mask);
+  const vh c_m_sum = (a_m + b_m);
+  const vh c_m_diff_ab = (a_m - b_m);
+  const vh c_m_diff_ba = (b_m - a_m);
+  const vh c_m_smag_diff =
+    ((vs)is_c_m_ab_pos_msb < 0) ? c_m_diff_ab : c_m_diff_ba;
+  const vh is_c_s_b_msb = (is_diff_sign_msb & ~is_c_m_ab_pos_msb);
+  const vh c_s = ((vs)is_c_s_b_msb < 0) ? b_s : a_s;
+  vh c_m_smag_diff_nlz;
+  _vec_uint16_cntlz<N_>(c_m_smag_diff_nlz, c_m_smag_diff);
+  const vh diff_norm_sa = (c_m_smag_diff_nlz - one);
+  const vh is_diff_denorm_msb = (a_e_biased - diff_norm_sa);
+  const vh is_diff_denorm = (vh)((vs)is_diff_denorm_msb >> 15);
+  const vh is_a_or_b_norm_msb = (-a_e_biased);
+  const vh diff_denorm_sa = (a_e_biased - 1);
+  vh c_m_diff_denorm, c_m_diff_norm;
+  _vec_uint16_shl<N_>(c_m_diff_denorm, c_m_smag_diff, diff_denorm_sa);
+  _vec_uint16_shl<N_>(c_m_diff_norm, c_m_smag_diff, diff_norm_sa);
+  const vh c_e_diff_norm = (a_e_biased - diff_norm_sa);
+  const vh c_m_diff_ab_norm =
+    ((vs)is_diff_denorm_msb < 0) ? c_m_diff_denorm : c_m_diff_norm;
+  const vh c_e_diff_ab_norm = (c_e_diff_norm & ~is_diff_denorm);
+  const vh c_m_diff =
+    ((vs)is_a_or_b_norm_msb < 0) ? c_m_diff_ab_norm : c_m_smag_diff;
+  const vh is_c_e_diff_norm_msb = (is_diff_sign_msb & is_a_or_b_norm_msb);
+  const vh is_diff_eqz_msb = (c_m_diff - 1);
+  const vh is_diff_exactly_zero_msb = (is_diff_sign_msb & is_diff_eqz_msb);
+  const vh is_diff_exactly_zero = (vh)((vs)is_diff_exactly_zero_msb >> 15);
+  const vh c_m_added = ((vs)is_diff_sign_msb < 0) ? c_m_diff : c_m_sum;
+  const vh c_e_added =
+    ((vs)is_c_e_diff_norm_msb < 0) ? c_e_diff_ab_norm : a_e_biased;
+  const vh c_m_carry = (c_m_added & h_m_grs_carry);
+  const vh is_c_m_carry_msb = (-c_m_carry);
+  const vh c_e_hidden_offset =
+    ((c_m_added & h_m_grs_carry) >> h_m_grs_carry_pos);
+  const vh c_m_sub_hidden = (c_m_added >> one);
+  const vh c_m_no_hidden =
+    ((vs)is_c_m_carry_msb < 0) ? c_m_sub_hidden : c_m_added;
+  const vh c_e_no_hidden = (c_e_added + c_e_hidden_offset);
+  const vh c_m_no_hidden_msb = (c_m_no_hidden & h_m_msb_mask);
+  const vh undenorm_m_msb_odd = (c_m_no_hidden_msb >> h_m_msb_sa);
+  const vh undenorm_fix_e = (is_undenorm & undenorm_m_msb_odd);
+  const vh c_e_fixed = (c_e_no_hidden + undenorm_fix_e);
+  const vh c_m_round_amount = (c_m_no_hidden & h_grs_round_mask);
+  const vh c_m_rounded = (c_m_no_hidden + c_m_round_amount);
+  const vh c_m_round_overflow =
+    ((c_m_rounded & h_m_grs_carry) >> h_m_grs_carry_pos);
+  const vh c_e_rounded = (c_e_fixed + c_m_round_overflow);
+  const vh c_m_no_grs = ((c_m_rounded >> h_grs_size) & h_m_mask);
+  const vh c_e = (c_e_rounded << h_e_pos);
+  const vh c_em = (c_e | c_m_no_grs);
+  const vh c_normal = (c_s | c_em);
+  const vh c_inf_result = ((vs)is_a_inf_msb < 0) ? c_inf : c_normal;
+  const vh c_zero_result = (c_inf_result & ~is_diff_exactly_zero);
+  c_result = ((vs)is_invalid_inf_op_msb < 0) ? vh{} + h_snan : c_zero_result;
+}
+
+// Lane-wise copy of half::half_mul; the 22 bit mantissa products need 32 bit
+// lanes.
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_vec_half_mul(typename _simd<N_>::u32 &c_result,
+              const typename _simd<N_>::u32 &x,
+              const typename _simd<N_>::u32 &y) noexcept {
+  using vu = typename _simd<N_>::u32;
+  using vs = typename _simd<N_>::s32;
+  const std::uint32_t one = (0x00000001);
+  const std::uint32_t h_s_mask = (0x00008000);
+  const std::uint32_t h_e_mask = (0x00007c00);
+  const std::uint32_t h_m_mask = (0x000003ff);
+  const std::uint32_t h_m_hidden = (0x00000400);
+  const std::uint32_t h_e_pos = (0x0000000a);
+  const std::uint32_t h_e_bias = (0x0000000f);
+  const std::uint32_t h_m_bit_count = (0x0000000a);
+  const std::uint32_t h_m_bit_half_count = (0x00000005);
+  const std::uint32_t h_nan_min = (0x00007c01);
+  const std::uint32_t h_e_mask_minus_one = (0x00007bff);
+  const std::uint32_t h_snan = (0x0000fe00);
+  const std::uint32_t m_round_overflow_bit = (0x00000020);
+  const std::uint32_t h_lo_mask = (0x0000ffff);
+  const std::uint32_t h_bit_count = (0x00000010);
+  const std::uint32_t m_hidden_bit = (0x00100000);
+  const vu a_s = (x & h_s_mask);
+  const vu b_s = (y & h_s_mask);
+  const vu c_s = (a_s ^ b_s);
+  const vu x_e = (x & h_e_mask);
+  const vu x_e_eqz_msb = (x_e - 1);
+  const vu a = ((vs)x_e_eqz_msb < 0) ? y : x;
+  const vu b = ((vs)x_e_eqz_msb < 0) ? x : y;
+  const vu a_e = (a & h_e_mask);
+  const vu b_e = (b & h_e_mask);
+  const vu a_m = (a & h_m_mask);
+  const vu b_m = (b & h_m_mask);
+  const vu a_e_amount = (a_e >> h_e_pos);
+  const vu b_e_amount = (b_e >> h_e_pos);
+  const vu a_m_with_hidden = (a_m | h_m_hidden);
+  const vu b_m_with_hidden = (b_m | h_m_hidden);
+  const vu c_m_normal = (a_m_with_hidden * b_m_with_hidden);
+  const vu c_m_denorm_biased = (a_m_with_hidden * b_m);
+  const vu c_e_denorm_unbias_e = (h_e_bias - a_e_amount);
+  const vu c_m_denorm_round_amount = (c_m_denorm_biased & h_m_mask);
+  const vu c_m_denorm_rounded = (c_m_denorm_biased + c_m_denorm_round_amount);
+  const vu c_m_denorm_inplace = (c_m_denorm_rounded >> h_m_bit_count);
+  const vu c_m_denorm_unbiased = (c_m_denorm_inplace >> c_e_denorm_unbias_e);
+  const vu c_m_denorm = (c_m_denorm_unbiased & h_m_mask);
+  const vu c_e_amount_biased = (a_e_amount + b_e_amount);
+  const vu c_e_amount_unbiased = (c_e_amount_biased - h_e_bias);
+  const vu is_c_e_unbiased_underflow = (vu)((vs)c_e_amount_unbiased >> 31);
+  const vu c_e_underflow_half_sa = (-c_e_amount_unbiased);
+  const vu c_e_underflow_sa = (c_e_underflow_half_sa << one);
+  const vu c_m_underflow = (c_m_normal >> c_e_underflow_sa);
+  const vu c_e_underflow_added =
+    (c_e_amount_unbiased & ~is_c_e_unbiased_underflow);
+  const vu c_m_underflow_added = ((is_c_e_unbiased_underflow & c_m_underflow) |
+                                  (~is_c_e_unbiased_underflow & c_m_normal));
+  const vu is_mul_overflow_test = (c_e_underflow_added & m_round_overflow_bit);
+  const vu is_mul_overflow_msb = (-is_mul_overflow_test);
+  const vu c_e_norm_radix_corrected = (c_e_underflow_added + 1);
+  const vu c_m_norm_radix_corrected = (c_m_underflow_added >> one);
+  const vu c_m_norm_hidden_bit = (c_m_norm_radix_corrected & m_hidden_bit);
+  const vu is_c_m_norm_no_hidden_msb = (c_m_norm_hidden_bit - 1);
+  const vu c_m_norm_lo = (c_m_norm_radix_corrected >> h_m_bit_half_count);
+  const vu c_m_norm_lo_16 = (c_m_norm_lo & h_lo_mask);
+  vu c_m_norm_lo_nlz_32;
+  _vec_uint32_cntlz_small<N_>(c_m_norm_lo_nlz_32, c_m_norm_lo_16);
+  const vu c_m_norm_lo_nlz = (c_m_norm_lo_nlz_32 - h_bit_count);
+  const vu is_c_m_hidden_nunderflow_msb =
+    (c_m_norm_lo_nlz - c_e_norm_radix_corrected);
+  const vu is_c_m_hidden_underflow_msb = (~is_c_m_hidden_nunderflow_msb);
+  const vu is_c_m_hidden_underflow =
+    (vu)((vs)is_c_m_hidden_underflow_msb >> 31);
+  const vu c_m_hidden_underflow_normalized_sa = (c_m_norm_lo_nlz >> one);
+  const vu c_m_hidden_underflow_normalized =
+    (c_m_norm_radix_corrected << c_m_hidden_underflow_normalized_sa);
+  const vu c_m_hidden_normalized =
+    (c_m_norm_radix_corrected << c_m_norm_lo_nlz);
+  const vu c_e_hidden_normalized = (c_e_norm_radix_corrected - c_m_norm_lo_nlz);
+  const vu c_e_hidden = (c_e_hidden_normalized & ~is_c_m_hidden_underflow);
+  const vu c_m_hidden = ((vs)is_c_m_hidden_underflow_msb < 0)
+                          ? c_m_hidden_underflow_normalized
+                          : c_m_hidden_normalized;
+  const vu c_m_normalized =
+    ((vs)is_c_m_norm_no_hidden_msb < 0) ? c_m_hidden : c_m_norm_radix_corrected;
+  const vu c_e_normalized =
+    ((vs)is_c_m_norm_no_hidden_msb < 0) ? c_e_hidden : c_e_norm_radix_corrected;
+  const vu c_m_norm_round_amount = (c_m_normalized & h_m_mask);
+  const vu c_m_norm_rounded = (c_m_normalized + c_m_norm_round_amount);
+  const vu is_round_overflow_test = (c_e_normalized & m_round_overflow_bit);
+  const vu is_round_overflow_msb = (-is_round_overflow_test);
+  const vu c_m_norm_inplace = (c_m_norm_rounded >> h_m_bit_count);
+  const vu c_m = (c_m_norm_inplace & h_m_mask);
+  const vu c_e_norm_inplace = (c_e_normalized << h_e_pos);
+  const vu c_e = (c_e_norm_inplace & h_e_mask);
+  const vu c_em_nan = (h_e_mask | a_m);
+  const vu c_nan = (a_s | c_em_nan);
+  const vu c_denorm = (c_s | c_m_denorm);
+  const vu c_inf = (c_s | h_e_mask);
+  const vu c_em_norm = (c_e | c_m);
+  const vu is_a_e_flagged_msb = (h_e_mask_minus_one - a_e);
+  const vu is_b_e_flagged_msb = (h_e_mask_minus_one - b_e);
+  const vu is_a_e_eqz_msb = (a_e - 1);
+  const vu is_a_m_eqz_msb = (a_m - 1);
+  const vu is_b_e_eqz_msb = (b_e - 1);
+  const vu is_b_m_eqz_msb = (b_m - 1);
+  const vu is_b_eqz_msb = (is_b_e_eqz_msb & is_b_m_eqz_msb);
+  const vu is_a_eqz_msb = (is_a_e_eqz_msb & is_a_m_eqz_msb);
+  const vu is_c_nan_via_a_msb = (is_a_e_flagged_msb & ~is_b_e_flagged_msb);
+  const vu is_c_nan_via_b_msb = (is_b_e_flagged_msb & ~is_b_m_eqz_msb);
+  const vu is_c_nan_msb = (is_c_nan_via_a_msb | is_c_nan_via_b_msb);
+  const vu is_c_denorm_msb = (is_b_e_eqz_msb & ~is_a_e_flagged_msb);
+  const vu is_a_inf_msb = (is_a_e_flagged_msb & is_a_m_eqz_msb);
+  const vu is_c_snan_msb = (is_a_inf_msb & is_b_eqz_msb);
+  const vu is_c_nan_min_via_a_msb = (is_a_e_flagged_msb & is_b_eqz_msb);
+  const vu is_c_nan_min_via_b_msb = (is_b_e_flagged_msb & is_a_eqz_msb);
+  const vu is_c_nan_min_msb = (is_c_nan_min_via_a_msb | is_c_nan_min_via_b_msb);
+  const vu is_c_inf_msb = (is_a_e_flagged_msb | is_b_e_flagged_msb);
+  const vu is_overflow_msb = (is_round_overflow_msb | is_mul_overflow_msb);
+  const vu c_em_overflow_result =
+    ((vs)is_overflow_msb < 0) ? vu{} + h_e_mask : c_em_norm;
+  const vu c_common_result = (c_s | c_em_overflow_result);
+  const vu c_zero_result = ((vs)is_b_eqz_msb < 0) ? c_s : c_common_result;
+  const vu c_nan_result = ((vs)is_c_nan_msb < 0) ? c_nan : c_zero_result;
+  const vu c_nan_min_result =
+    ((vs)is_c_nan_min_msb < 0) ? vu{} + h_nan_min : c_nan_result;
+  const vu c_inf_result = ((vs)is_c_inf_msb < 0) ? c_inf : c_nan_min_result;
+  const vu c_denorm_result =
+    ((vs)is_c_denorm_msb < 0) ? c_denorm : c_inf_result;
+  c_result = ((vs)is_c_snan_msb < 0) ? vu{} + h_snan : c_denorm_result;
+}
+
+// Lanes per vector of Bytes_: add and sub work on the 16 bit values as they
+// are, mul widens them to 32 bits.
+template <_half_op Op_, std::size_t Bytes_>
+inline constexpr std::size_t _half_op_lanes =
+  Bytes_ / (Op_ == _half_op::mul ? 4 : 2);
+
+template <_half_op Op_, bool Broadcast_, std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_half_op_n_kernel(const std::uint16_t *x, const std::uint16_t *y,
+                  std::uint16_t *dst, std::size_t n) noexcept {
+  using vu = typename _simd<N_>::u32;
+  using vh = typename _simd<N_>::u16;
+  const std::uint16_t h_s_mask = (0x8000);
+  const std::uint16_t y_s_flip = (Op_ == _half_op::sub) ? h_s_mask : 0;
+  vh y_broadcast{};
+  if constexpr (Broadcast_)
+    y_broadcast = vh{} + y[0];
+  std::size_t i = 0;
+  for (; i + N_ <= n; i += N_) {
+    vh x_narrow, y_narrow;
+    std::memcpy(&x_narrow, x + i, sizeof(x_narrow));
+    if constexpr (Broadcast_)
+      y_narrow = y_broadcast;
+    else
+      std::memcpy(&y_narrow, y + i, sizeof(y_narrow));
+    vh c_narrow;
+    if constexpr (Op_ == _half_op::mul) {
+      const vu x_wide = __builtin_convertvector(x_narrow, vu);
+      const vu y_wide = __builtin_convertvector(y_narrow, vu);
+      vu c;
+      _vec_half_mul<N_>(c, x_wide, y_wide);
+      c_narrow = __builtin_convertvector(c, vh);
+    } else {
+      const vh y_signed = (y_narrow ^ y_s_flip);
+      _vec_half_add<N_>(c_narrow, x_narrow, y_signed);
+    }
+    std::memcpy(dst + i, &c_narrow, sizeof(c_narrow));
+  }
+  _half_op_n_scalar<Op_, Broadcast_>(x + i, Broadcast_ ? y : y + i, dst + i,
+                                     n - i);
+}
+
+template <_half_op Op_, bool Broadcast_>
+inline void _half_op_n_simd128(const std::uint16_t *x, const std::uint16_t *y,
+                               std::uint16_t *dst, std::size_t n) noexcept {
+  _half_op_n_kernel<Op_, Broadcast_, _half_op_lanes<Op_, 16>>(x, y, dst, n);
+}
+
+#endif // FLOAT16_T_HAS_VECTOR_EXT
+
+using _half_op_n_fn = void(const std::uint16_t *, const std::uint16_t *,
+                           std::uint16_t *, std::size_t) noexcept;
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+
+template <_half_op Op_, bool Broadcast_>
+FLOAT16_T_TARGET_AVX2 inline void
+_half_op_n_avx2(const std::uint16_t *x, const std::uint16_t *y,
+                std::uint16_t *dst, std::size_t n) noexcept {
+  _half_op_n_kernel<Op_, Broadcast_, _half_op_lanes<Op_, 32>>(x, y, dst, n);
+}
+
+template <_half_op Op_, bool Broadcast_>
+FLOAT16_T_TARGET_AVX512 inline void
+_half_op_n_avx512(const std::uint16_t *x, const std::uint16_t *y,
+                  std::uint16_t *dst, std::size_t n) noexcept {
+  _half_op_n_kernel<Op_, Broadcast_, _half_op_lanes<Op_, 64>>(x, y, dst, n);
+}
+
+template <_half_op Op_, bool Broadcast_>
+inline constexpr _kernel_table<_half_op_n_fn> _half_op_n_kernels{
+  {_half_op_n_scalar<Op_, Broadcast_>, _half_op_n_simd128<Op_, Broadcast_>,
+   _half_op_n_avx2<Op_, Broadcast_>, _half_op_n_avx512<Op_, Broadcast_>}};
+
+#elif FLOAT16_T_HAS_VECTOR_EXT
+
+template <_half_op Op_, bool Broadcast_>
+inline constexpr _kernel_table<_half_op_n_fn> _half_op_n_kernels{
+  {_half_op_n_scalar<Op_, Broadcast_>, _half_op_n_simd128<Op_, Broadcast_>,
+   _half_op_n_simd128<Op_, Broadcast_>, _half_op_n_simd128<Op_, Broadcast_>}};
+
+#else
+
+template <_half_op Op_, bool Broadcast_>
+inline constexpr _kernel_table<_half_op_n_fn> _half_op_n_kernels{
+  {_half_op_n_scalar<Op_, Broadcast_>, _half_op_n_scalar<Op_, Broadcast_>,
+   _half_op_n_scalar<Op_, Broadcast_>, _half_op_n_scalar<Op_, Broadcast_>}};
+
+#endif
+
+template <_half_op Op_, bool Broadcast_>
+inline void _half_op_n(const std::uint16_t *x, const std::uint16_t *y,
+                       std::uint16_t *dst, std::size_t n) noexcept {
+  _half_op_n_kernels<Op_, Broadcast_>[active_backend()](x, y, dst, n);
+}
+
+template <_half_op Op_>
+inline void _half_op_n(std::span<const std::uint16_t> x,
+                       std::span<const std::uint16_t> y,
+                       std::span<std::uint16_t> dst) noexcept {
+  const std::size_t n = std::min({x.size(), y.size(), dst.size()});
+  parallel_for(dst.first(n), [&](std::size_t i, std::size_t end) {
+    _half_op_n<Op_, false>(x.data() + i, y.data() + i, dst.data() + i,
+                           end - i);
+  });
+}
+
+template <_half_op Op_>
+inline void _half_op_n(std::span<const std::uint16_t> x, std::uint16_t y,
+                       std::span<std::uint16_t> dst) noexcept {
+  const std::size_t n = std::min(x.size(), dst.size());
+  parallel_for(dst.first(n), [&](std::size_t i, std::size_t end) {
+    _half_op_n<Op_, true>(x.data() + i, &y, dst.data() + i, end - i);
+  });
+}
+
+} // namespace half::half_private
+
+namespace half {
+
+// dst[i] = half_fma(x[i], y[i], z[i]) for the shortest of the four spans.
+inline void fma_n(std::span<const std::uint16_t> x,
+                  std::span<const std::uint16_t> y,
+                  std::span<const std::uint16_t> z,
+                  std::span<std::uint16_t> dst) noexcept {
+  const std::size_t n =
+    std::min({x.size(), y.size(), z.size(), dst.size()});
+  parallel_for(dst.first(n), [&](std::size_t i, std::size_t end) {
+    half_private::_half_fma_n(x.data() + i, y.data() + i, z.data() + i,
+                              dst.data() + i, end - i);
+  });
+}
+
+// dst[i] = half_add(x[i], y[i]) for the shortest of the spans, or
+// half_add(x[i], y) with a single y; the same for half_sub and half_mul. The
+// results are bit-identical to the scalar functions on every backend.
+inline void half_add_n(std::span<const std::uint16_t> x,
+                       std::span<const std::uint16_t> y,
+                       std::span<std::uint16_t> dst) noexcept {
+  half_private::_half_op_n<half_private::_half_op::add>(x, y, dst);
+}
+
+inline void half_add_n(std::span<const std::uint16_t> x, std::uint16_t y,
+                       std::span<std::uint16_t> dst) noexcept {
+  half_private::_half_op_n<half_private::_half_op::add>(x, y, dst);
+}
+
+inline void half_sub_n(std::span<const std::uint16_t> x,
+                       std::span<const std::uint16_t> y,
+                       std::span<std::uint16_t> dst) noexcept {
+  half_private::_half_op_n<half_private::_half_op::sub>(x, y, dst);
+}
+
+inline void half_sub_n(std::span<const std::uint16_t> x, std::uint16_t y,
+                       std::span<std::uint16_t> dst) noexcept {
+  half_private::_half_op_n<half_private::_half_op::sub>(x, y, dst);
+}
+
+inline void half_mul_n(std::span<const std::uint16_t> x,
+                       std::span<const std::uint16_t> y,
+                       std::span<std::uint16_t> dst) noexcept {
+  half_private::_half_op_n<half_private::_half_op::mul>(x, y, dst);
+}
+
+inline void half_mul_n(std::span<const std::uint16_t> x, std::uint16_t y,
+                       std::span<std::uint16_t> dst) noexcept {
+  half_private::_half_op_n<half_private::_half_op::mul>(x, y, dst);
+}
+
+} // namespace half
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
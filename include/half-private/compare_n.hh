@@ -0,0 +1,313 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+#include "dispatch.hh"
+#include "float16_t.hpp"
+#include "parallel.hh"
+#include "simd.hh"
+
+namespace half::half_private {
+
+inline void _half_less_n_scalar(const std::uint16_t *x, const std::uint16_t *y,
+                                bool *dst, std::size_t n) noexcept {
+  for (std::size_t i = 0; i < n; ++i)
+    dst[i] = half_less(x[i], y[i]);
+}
+
+template <bool Max_>
+inline void _half_minmax_n_scalar(const std::uint16_t *x,
+                                  const std::uint16_t *y, std::uint16_t *dst,
+                                  std::size_t n) noexcept {
+  for (std::size_t i = 0; i < n; ++i)
+    dst[i] = Max_ ? half_max(x[i], y[i]) : half_min(x[i], y[i]);
+}
+
+inline void _half_clamp_n_scalar(const std::uint16_t *x, std::uint16_t lo,
+                                 std::uint16_t hi, std::uint16_t *dst,
+                                 std::size_t n) noexcept {
+  for (std::size_t i = 0; i < n; ++i)
+    dst[i] = half_clamp(x[i], lo, hi);
+}
+
+#if FLOAT16_T_HAS_VECTOR_EXT
+
+// The keys of half_private::_half_order_key and _half_total_order_key fit in
+// 16 bit lanes; their differences do not, so the lanes compare them as
+// signed values instead of testing the msb of the difference. The selects
+// are bitwise on the comparison masks.
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_vec_half_order_keys(typename _simd<N_>::u16 &order_key,
+                     typename _simd<N_>::u16 &total_order_key,
+                     typename _simd<N_>::u16 &is_nan,
+                     const typename _simd<N_>::u16 &h) noexcept {
+  using vh = typename _simd<N_>::u16;
+  using vs = typename _simd<N_>::s16;
+  const std::uint16_t h_em_mask = (0x7fff);
+  const std::int16_t h_e_mask = (0x7c00);
+  const std::uint16_t msb_to_lsb_sa = (0x000f);
+  const vh em = (h & h_em_mask);
+  const vh s_mask = (vh)((vs)h >> msb_to_lsb_sa);
+  total_order_key = (em ^ s_mask);
+  order_key = (total_order_key - s_mask);
+  is_nan = (vh)((vs)em > h_e_mask);
+}
+
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_vec_half_less(typename _simd<N_>::u16 &is_less,
+               const typename _simd<N_>::u16 &x,
+               const typename _simd<N_>::u16 &y) noexcept {
+  using vh = typename _simd<N_>::u16;
+  using vs = typename _simd<N_>::s16;
+  vh x_key, x_total_key, is_x_nan, y_key, y_total_key, is_y_nan;
+  _vec_half_order_keys<N_>(x_key, x_total_key, is_x_nan, x);
+  _vec_half_order_keys<N_>(y_key, y_total_key, is_y_nan, y);
+  const vh is_key_less = (vh)((vs)x_key < (vs)y_key);
+  is_less = (is_key_less & ~is_x_nan & ~is_y_nan);
+}
+
+template <bool Max_, std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_vec_half_minmax(typename _simd<N_>::u16 &c_result,
+                 const typename _simd<N_>::u16 &x,
+                 const typename _simd<N_>::u16 &y) noexcept {
+  using vh = typename _simd<N_>::u16;
+  using vs = typename _simd<N_>::s16;
+  vh x_key, x_total_key, is_x_nan, y_key, y_total_key, is_y_nan;
+  _vec_half_order_keys<N_>(x_key, x_total_key, is_x_nan, x);
+  _vec_half_order_keys<N_>(y_key, y_total_key, is_y_nan, y);
+  const vh is_y_better = Max_ ? (vh)((vs)y_total_key > (vs)x_total_key)
+                              : (vh)((vs)y_total_key < (vs)x_total_key);
+  const vh is_c_y = (is_x_nan | (is_y_better & ~is_y_nan));
+  c_result = ((y & is_c_y) | (x & ~is_c_y));
+}
+
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_half_less_n_kernel(const std::uint16_t *x, const std::uint16_t *y, bool *dst,
+                    std::size_t n) noexcept {
+  using vh = typename _simd<N_>::u16;
+  using vb = typename _simd<N_>::u8;
+  const std::uint16_t one = (0x0001);
+  std::size_t i = 0;
+  for (; i + N_ <= n; i += N_) {
+    vh x_lanes, y_lanes;
+    std::memcpy(&x_lanes, x + i, sizeof(x_lanes));
+    std::memcpy(&y_lanes, y + i, sizeof(y_lanes));
+    vh is_less;
+    _vec_half_less<N_>(is_less, x_lanes, y_lanes);
+    const vh c = (is_less & one);
+    const vb c_bytes = __builtin_convertvector(c, vb);
+    std::memcpy(dst + i, &c_bytes, sizeof(c_bytes));
+  }
+  _half_less_n_scalar(x + i, y + i, dst + i, n - i);
+}
+
+template <bool Max_, std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_half_minmax_n_kernel(const std::uint16_t *x, const std::uint16_t *y,
+                      std::uint16_t *dst, std::size_t n) noexcept {
+  using vh = typename _simd<N_>::u16;
+  std::size_t i = 0;
+  for (; i + N_ <= n; i += N_) {
+    vh x_lanes, y_lanes;
+    std::memcpy(&x_lanes, x + i, sizeof(x_lanes));
+    std::memcpy(&y_lanes, y + i, sizeof(y_lanes));
+    vh c;
+    _vec_half_minmax<Max_, N_>(c, x_lanes, y_lanes);
+    std::memcpy(dst + i, &c, sizeof(c));
+  }
+  _half_minmax_n_scalar<Max_>(x + i, y + i, dst + i, n - i);
+}
+
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_half_clamp_n_kernel(const std::uint16_t *x, std::uint16_t lo,
+                     std::uint16_t hi, std::uint16_t *dst,
+                     std::size_t n) noexcept {
+  using vh = typename _simd<N_>::u16;
+  const vh lo_lanes = vh{} + lo;
+  const vh hi_lanes = vh{} + hi;
+  std::size_t i = 0;
+  for (; i + N_ <= n; i += N_) {
+    vh x_lanes;
+    std::memcpy(&x_lanes, x + i, sizeof(x_lanes));
+    vh x_key, x_total_key, is_x_nan;
+    _vec_half_order_keys<N_>(x_key, x_total_key, is_x_nan, x_lanes);
+    vh c_lo, c_clamped;
+    _vec_half_minmax<true, N_>(c_lo, x_lanes, lo_lanes);
+    _vec_half_minmax<false, N_>(c_clamped, c_lo, hi_lanes);
+    const vh c = ((x_lanes & is_x_nan) | (c_clamped & ~is_x_nan));
+    std::memcpy(dst + i, &c, sizeof(c));
+  }
+  _half_clamp_n_scalar(x + i, lo, hi, dst + i, n - i);
+}
+
+inline void _half_less_n_simd128(const std::uint16_t *x, const std::uint16_t *y,
+                                 bool *dst, std::size_t n) noexcept {
+  _half_less_n_kernel<8>(x, y, dst, n);
+}
+
+template <bool Max_>
+inline void _half_minmax_n_simd128(const std::uint16_t *x,
+                                   const std::uint16_t *y, std::uint16_t *dst,
+                                   std::size_t n) noexcept {
+  _half_minmax_n_kernel<Max_, 8>(x, y, dst, n);
+}
+
+inline void _half_clamp_n_simd128(const std::uint16_t *x, std::uint16_t lo,
+                                  std::uint16_t hi, std::uint16_t *dst,
+                                  std::size_t n) noexcept {
+  _half_clamp_n_kernel<8>(x, lo, hi, dst, n);
+}
+
+#endif // FLOAT16_T_HAS_VECTOR_EXT
+
+using _half_less_n_fn = void(const std::uint16_t *, const std::uint16_t *,
+                             bool *, std::size_t) noexcept;
+using _half_minmax_n_fn = void(const std::uint16_t *, const std::uint16_t *,
+                               std::uint16_t *, std::size_t) noexcept;
+using _half_clamp_n_fn = void(const std::uint16_t *, std::uint16_t,
+                              std::uint16_t, std::uint16_t *,
+                              std::size_t) noexcept;
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+
+FLOAT16_T_TARGET_AVX2 inline void
+_half_less_n_avx2(const std::uint16_t *x, const std::uint16_t *y, bool *dst,
+                  std::size_t n) noexcept {
+  _half_less_n_kernel<16>(x, y, dst, n);
+}
+
+FLOAT16_T_TARGET_AVX512 inline void
+_half_less_n_avx512(const std::uint16_t *x, const std::uint16_t *y, bool *dst,
+                    std::size_t n) noexcept {
+  _half_less_n_kernel<32>(x, y, dst, n);
+}
+
+template <bool Max_>
+FLOAT16_T_TARGET_AVX2 inline void
+_half_minmax_n_avx2(const std::uint16_t *x, const std::uint16_t *y,
+                    std::uint16_t *dst, std::size_t n) noexcept {
+  _half_minmax_n_kernel<Max_, 16>(x, y, dst, n);
+}
+
+template <bool Max_>
+FLOAT16_T_TARGET_AVX512 inline void
+_half_minmax_n_avx512(const std::uint16_t *x, const std::uint16_t *y,
+                      std::uint16_t *dst, std::size_t n) noexcept {
+  _half_minmax_n_kernel<Max_, 32>(x, y, dst, n);
+}
+
+FLOAT16_T_TARGET_AVX2 inline void
+_half_clamp_n_avx2(const std::uint16_t *x, std::uint16_t lo, std::uint16_t hi,
+                   std::uint16_t *dst, std::size_t n) noexcept {
+  _half_clamp_n_kernel<16>(x, lo, hi, dst, n);
+}
+
+FLOAT16_T_TARGET_AVX512 inline void
+_half_clamp_n_avx512(const std::uint16_t *x, std::uint16_t lo,
+                     std::uint16_t hi, std::uint16_t *dst,
+                     std::size_t n) noexcept {
+  _half_clamp_n_kernel<32>(x, lo, hi, dst, n);
+}
+
+inline constexpr _kernel_table<_half_less_n_fn> _half_less_n_kernels{
+  {_half_less_n_scalar, _half_less_n_simd128, _half_less_n_avx2,
+   _half_less_n_avx512}};
+
+template <bool Max_>
+inline constexpr _kernel_table<_half_minmax_n_fn> _half_minmax_n_kernels{
+  {_half_minmax_n_scalar<Max_>, _half_minmax_n_simd128<Max_>,
+   _half_minmax_n_avx2<Max_>, _half_minmax_n_avx512<Max_>}};
+
+inline constexpr _kernel_table<_half_clamp_n_fn> _half_clamp_n_kernels{
+  {_half_clamp_n_scalar, _half_clamp_n_simd128, _half_clamp_n_avx2,
+   _half_clamp_n_avx512}};
+
+#elif FLOAT16_T_HAS_VECTOR_EXT
+
+inline constexpr _kernel_table<_half_less_n_fn> _half_less_n_kernels{
+  {_half_less_n_scalar, _half_less_n_simd128, _half_less_n_simd128,
+   _half_less_n_simd128}};
+
+template <bool Max_>
+inline constexpr _kernel_table<_half_minmax_n_fn> _half_minmax_n_kernels{
+  {_half_minmax_n_scalar<Max_>, _half_minmax_n_simd128<Max_>,
+   _half_minmax_n_simd128<Max_>, _half_minmax_n_simd128<Max_>}};
+
+inline constexpr _kernel_table<_half_clamp_n_fn> _half_clamp_n_kernels{
+  {_half_clamp_n_scalar, _half_clamp_n_simd128, _half_clamp_n_simd128,
+   _half_clamp_n_simd128}};
+
+#else
+
+inline constexpr _kernel_table<_half_less_n_fn> _half_less_n_kernels{
+  {_half_less_n_scalar, _half_less_n_scalar, _half_less_n_scalar,
+   _half_less_n_scalar}};
+
+template <bool Max_>
+inline constexpr _kernel_table<_half_minmax_n_fn> _half_minmax_n_kernels{
+  {_half_minmax_n_scalar<Max_>, _half_minmax_n_scalar<Max_>,
+   _half_minmax_n_scalar<Max_>, _half_minmax_n_scalar<Max_>}};
+
+inline constexpr _kernel_table<_half_clamp_n_fn> _half_clamp_n_kernels{
+  {_half_clamp_n_scalar, _half_clamp_n_scalar, _half_clamp_n_scalar,
+   _half_clamp_n_scalar}};
+
+#endif
+
+} // namespace half::half_private
+
+namespace half {
+
+// dst[i] = half_less(x[i], y[i]) for the shortest of the spans.
+inline void less_n(std::span<const std::uint16_t> x,
+                   std::span<const std::uint16_t> y,
+                   std::span<bool> dst) noexcept {
+  const std::size_t n = std::min({x.size(), y.size(), dst.size()});
+  parallel_for(dst.first(n), [&](std::size_t i, std::size_t end) {
+    half_private::_half_less_n_kernels[active_backend()](
+      x.data() + i, y.data() + i, dst.data() + i, end - i);
+  });
+}
+
+// dst[i] = half_min(x[i], y[i]) and half_max(x[i], y[i]) for the shortest
+// of the spans.
+inline void min_n(std::span<const std::uint16_t> x,
+                  std::span<const std::uint16_t> y,
+                  std::span<std::uint16_t> dst) noexcept {
+  const std::size_t n = std::min({x.size(), y.size(), dst.size()});
+  parallel_for(dst.first(n), [&](std::size_t i, std::size_t end) {
+    half_private::_half_minmax_n_kernels<false>[active_backend()](
+      x.data() + i, y.data() + i, dst.data() + i, end - i);
+  });
+}
+
+inline void max_n(std::span<const std::uint16_t> x,
+                  std::span<const std::uint16_t> y,
+                  std::span<std::uint16_t> dst) noexcept {
+  const std::size_t n = std::min({x.size(), y.size(), dst.size()});
+  parallel_for(dst.first(n), [&](std::size_t i, std::size_t end) {
+    half_private::_half_minmax_n_kernels<true>[active_backend()](
+      x.data() + i, y.data() + i, dst.data() + i, end - i);
+  });
+}
+
+// dst[i] = half_clamp(x[i], lo, hi) for the shorter of the spans.
+inline void clamp_n(std::span<const std::uint16_t> x, std::uint16_t lo,
+                    std::uint16_t hi, std::span<std::uint16_t> dst) noexcept {
+  const std::size_t n = std::min(x.size(), dst.size());
+  parallel_for(dst.first(n), [&](std::size_t i, std::size_t end) {
+    half_private::_half_clamp_n_kernels[active_backend()](
+      x.data() + i, lo, hi, dst.data() + i, end - i);
+  });
+}
+
+} // namespace half
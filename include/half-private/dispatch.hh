@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#include "simd.hh"
+
+#if FLOAT16_T_HAS_VECTOR_EXT && (defined(__x86_64__) || defined(__i386__))
+#define FLOAT16_T_HAS_X86_DISPATCH 1
+#define FLOAT16_T_TARGET_AVX2 [[gnu::target("avx2,f16c,fma")]]
+#define FLOAT16_T_TARGET_AVX512                                                \
+  [[gnu::target("avx512f,avx512bw,avx512vl,avx2,f16c,fma")]]
+#else
+#define FLOAT16_T_HAS_X86_DISPATCH 0
+#define FLOAT16_T_TARGET_AVX2
+#define FLOAT16_T_TARGET_AVX512
+#endif
+
+namespace half {
+
+// Implementations of the bulk kernels, from slowest to fastest. simd128 is
+// SSE2 on x86 and whatever 128 bit vectors the target has elsewhere; avx2
+// also requires F16C and FMA, avx512 requires AVX-512 F, BW and VL.
+enum struct backend : int { scalar = 0, simd128 = 1, avx2 = 2, avx512 = 3 };
+
+inline constexpr int backend_count = 4;
+
+[[nodiscard]] constexpr inline const char *backend_name(backend b) noexcept {
+  switch (b) {
+  case backend::scalar:
+    return "scalar";
+  case backend::simd128:
+    return "simd128";
+  case backend::avx2:
+    return "avx2";
+  case backend::avx512:
+    return "avx512";
+  }
+  return "unknown";
+}
+
+} // namespace half
+
+namespace half::half_private {
+
+[[nodiscard]] inline backend _detect_backend() noexcept {
+#if FLOAT16_T_HAS_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+      __builtin_cpu_supports("avx512vl"))
+    return backend::avx512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c") &&
+      __builtin_cpu_supports("fma"))
+    return backend::avx2;
+  return backend::simd128;
+#elif FLOAT16_T_HAS_VECTOR_EXT
+  return backend::simd128;
+#else
+  return backend::scalar;
+#endif
+}
+
+[[nodiscard]] inline backend _supported_backend() noexcept {
+  static const backend supported = _detect_backend();
+  return supported;
+}
+
+// FLOAT16_T_BACKEND=scalar|simd128|avx2|avx512 caps the backend picked at
+// startup; asking for more than the CPU has gives the best it does have.
+[[nodiscard]] inline backend _initial_backend() noexcept {
+  const backend supported = _supported_backend();
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4996) // getenv
+#endif
+  const char *requested = std::getenv("FLOAT16_T_BACKEND");
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+  if (requested == nullptr)
+    return supported;
+  for (int i = 0; i < backend_count; ++i) {
+    const auto b = static_cast<backend>(i);
+    if (std::strcmp(requested, backend_name(b)) == 0)
+      return b < supported ? b : supported;
+  }
+  return supported;
+}
+
+[[nodiscard]] inline std::atomic<backend> &_backend_state() noexcept {
+  static std::atomic<backend> state{_initial_backend()};
+  return state;
+}
+
+// One entry per backend; entries for backends this build cannot produce
+// fall back to the next slower one.
+template <typename Fn_> struct _kernel_table {
+  Fn_ *impl[backend_count];
+
+  Fn_ *operator[](backend b) const noexcept {
+    return impl[static_cast<int>(b)];
+  }
+};
+
+} // namespace half::half_private
+
+namespace half {
+
+// The backend the bulk kernels currently run on.
+[[nodiscard]] inline backend active_backend() noexcept {
+  return half_private::_backend_state().load(std::memory_order_relaxed);
+}
+
+// The fastest backend this CPU (and build) supports.
+[[nodiscard]] inline backend supported_backend() noexcept {
+  return half_private::_supported_backend();
+}
+
+// Forces a backend, e.g. for A/B benchmarking; clamped to what is supported.
+// Returns the backend actually selected.
+inline backend set_backend(backend b) noexcept {
+  const backend supported = half_private::_supported_backend();
+  const backend selected = b < supported ? b : supported;
+  half_private::_backend_state().store(selected, std::memory_order_relaxed);
+  return selected;
+}
+
+} // namespace half
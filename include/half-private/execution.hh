@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <execution>
+#include <span>
+#include <type_traits>
+
+#include "arith_n.hh"
+#include "compare_n.hh"
+#include "dispatch.hh"
+#include "float16_t_finite.hh"
+#include "float16_t_reduce.hh"
+#include "float16_t_table.hh"
+#include "fp_convert_n.hh"
+#include "fp_convert_stats.hh"
+#include "parallel.hh"
+
+namespace half::half_private {
+
+template <typename Policy_>
+concept _execution_policy =
+  std::is_execution_policy_v<std::remove_cvref_t<Policy_>>;
+
+template <typename Policy_>
+inline constexpr bool _policy_parallel =
+  std::is_same_v<std::remove_cvref_t<Policy_>,
+                 std::execution::parallel_policy> ||
+  std::is_same_v<std::remove_cvref_t<Policy_>,
+                 std::execution::parallel_unsequenced_policy>;
+
+// For the length of a call: seq and unseq keep the work on the calling
+// thread. Other policies count as seq.
+template <typename Policy_> class _policy_scope {
+public:
+  _policy_scope() noexcept = default;
+  _policy_scope(const _policy_scope &) = delete;
+  _policy_scope &operator=(const _policy_scope &) = delete;
+
+private:
+  _serial_scope _serial{_policy_parallel<Policy_> ? _run_serially : true};
+};
+
+} // namespace half::half_private
+
+namespace half {
+
+// The bulk functions under a standard execution policy: par and par_unseq
+// spread them over active_executor() like the plain overloads, seq and
+// unseq keep them on the calling thread. Every policy runs the dispatched
+// kernels, so the results are the same bits as without one.
+template <half_private::_execution_policy Policy_>
+inline void float_to_half_n(Policy_ &&, std::span<const std::uint32_t> src,
+                            std::span<std::uint16_t> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  float_to_half_n(src, dst);
+}
+
+template <half_private::_execution_policy Policy_>
+[[nodiscard]] inline conversion_stats
+float_to_half_n_stats(Policy_ &&, std::span<const std::uint32_t> src,
+                      std::span<std::uint16_t> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  return float_to_half_n_stats(src, dst);
+}
+
+template <half_private::_execution_policy Policy_>
+inline void half_to_float_n(Policy_ &&, std::span<const std::uint16_t> src,
+                            std::span<std::uint32_t> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  half_to_float_n(src, dst);
+}
+
+template <half_private::_execution_policy Policy_>
+inline void fma_n(Policy_ &&, std::span<const std::uint16_t> x,
+                  std::span<const std::uint16_t> y,
+                  std::span<const std::uint16_t> z,
+                  std::span<std::uint16_t> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  fma_n(x, y, z, dst);
+}
+
+template <half_private::_execution_policy Policy_>
+inline void half_add_n(Policy_ &&, std::span<const std::uint16_t> x,
+                       std::span<const std::uint16_t> y,
+                       std::span<std::uint16_t> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  half_add_n(x, y, dst);
+}
+
+template <half_private::_execution_policy Policy_>
+inline void half_add_n(Policy_ &&, std::span<const std::uint16_t> x,
+                       std::uint16_t y, std::span<std::uint16_t> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  half_add_n(x, y, dst);
+}
+
+template <half_private::_execution_policy Policy_>
+inline void half_sub_n(Policy_ &&, std::span<const std::uint16_t> x,
+                       std::span<const std::uint16_t> y,
+                       std::span<std::uint16_t> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  half_sub_n(x, y, dst);
+}
+
+template <half_private::_execution_policy Policy_>
+inline void half_sub_n(Policy_ &&, std::span<const std::uint16_t> x,
+                       std::uint16_t y, std::span<std::uint16_t> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  half_sub_n(x, y, dst);
+}
+
+template <half_private::_execution_policy Policy_>
+inline void half_mul_n(Policy_ &&, std::span<const std::uint16_t> x,
+                       std::span<const std::uint16_t> y,
+                       std::span<std::uint16_t> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  half_mul_n(x, y, dst);
+}
+
+template <half_private::_execution_policy Policy_>
+inline void half_mul_n(Policy_ &&, std::span<const std::uint16_t> x,
+                       std::uint16_t y, std::span<std::uint16_t> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  half_mul_n(x, y, dst);
+}
+
+template <half_private::_execution_policy Policy_>
+inline void less_n(Policy_ &&, std::span<const std::uint16_t> x,
+                   std::span<const std::uint16_t> y,
+                   std::span<bool> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  less_n(x, y, dst);
+}
+
+template <half_private::_execution_policy Policy_>
+inline void min_n(Policy_ &&, std::span<const std::uint16_t> x,
+                  std::span<const std::uint16_t> y,
+                  std::span<std::uint16_t> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  min_n(x, y, dst);
+}
+
+template <half_private::_execution_policy Policy_>
+inline void max_n(Policy_ &&, std::span<const std::uint16_t> x,
+                  std::span<const std::uint16_t> y,
+                  std::span<std::uint16_t> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  max_n(x, y, dst);
+}
+
+template <half_private::_execution_policy Policy_>
+inline void clamp_n(Policy_ &&, std::span<const std::uint16_t> x,
+                    std::uint16_t lo, std::uint16_t hi,
+                    std::span<std::uint16_t> dst) noexcept {
+  const half_private::_policy_scope<Policy_> scope;
+  clamp_n(x, lo, hi, dst);
+}
+
+} // namespace half
+
+namespace numeric {
+
+// The reductions under a standard execution policy, mapped as for the bulk
+// functions of namespace half. Pairwise sums come out the same under every
+// policy; fast and kahan add per-chunk sums under par and par_unseq, as
+// the plain overloads do.
+template <half::half_private::_execution_policy Policy_>
+[[nodiscard]] inline float sum(Policy_ &&, std::span<const float16_t> x,
+                               summation method = summation::pairwise) {
+  const half::half_private::_policy_scope<Policy_> scope;
+  return sum(x, method);
+}
+
+template <half::half_private::_execution_policy Policy_>
+[[nodiscard]] inline float dot(Policy_ &&, std::span<const float16_t> x,
+                               std::span<const float16_t> y,
+                               summation method = summation::pairwise) {
+  const half::half_private::_policy_scope<Policy_> scope;
+  return dot(x, y, method);
+}
+
+template <half::half_private::_execution_policy Policy_>
+[[nodiscard]] inline float sum_sq(Policy_ &&, std::span<const float16_t> x,
+                                  summation method = summation::pairwise) {
+  const half::half_private::_policy_scope<Policy_> scope;
+  return sum_sq(x, method);
+}
+
+template <half::half_private::_execution_policy Policy_>
+[[nodiscard]] inline float norm2(Policy_ &&policy,
+                                 std::span<const float16_t> x,
+                                 summation method = summation::pairwise) {
+  return std::sqrt(sum_sq(policy, x, method));
+}
+
+template <half::half_private::_execution_policy Policy_>
+[[nodiscard]] inline float mean(Policy_ &&policy, std::span<const float16_t> x,
+                                summation method = summation::pairwise) {
+  return sum(policy, x, method) / float(x.size());
+}
+
+template <half::half_private::_execution_policy Policy_>
+[[nodiscard]] inline float variance(Policy_ &&,
+                                    std::span<const float16_t> x,
+                                    summation method = summation::pairwise) {
+  const half::half_private::_policy_scope<Policy_> scope;
+  return variance(x, method);
+}
+
+template <half::half_private::_execution_policy Policy_>
+[[nodiscard]] inline bool all_finite(Policy_ &&,
+                                     std::span<const float16_t> x) noexcept {
+  const half::half_private::_policy_scope<Policy_> scope;
+  return all_finite(x);
+}
+
+} // namespace numeric
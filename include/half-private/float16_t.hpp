@@ -2,6 +2,9 @@
 #define FLOAT16_T_HPP_INCLUDED_OSDIJSALKJS8OU4LKJAFSOIUASFD98U3LJKASFOIJFFDDDDDF
 
 #include "half-private/fp_convert.hh"
+#ifdef FLOAT16_T_HALF_TO_FLOAT_TABLE
+#include "half-private/fp_convert_table.hh"
+#endif
 
 //
 // inspired by:
@@ -319,6 +322,332 @@ constexpr inline std::uint16_t half_mul(std::uint16_t x,
   return std::uint16_t(c_result);
 }
 
+// Correctly rounded (to nearest even). NaN results are 0x7e00.
+constexpr inline std::uint16_t half_div(std::uint16_t x,
+                                        std::uint16_t y) noexcept {
+  const std::uint32_t one = (0x00000001);
+  const std::uint32_t h_s_mask = (0x00008000);
+  const std::uint32_t h_em_mask = (0x00007fff);
+  const std::uint32_t h_e_mask = (0x00007c00);
+  const std::uint32_t h_m_mask = (0x000003ff);
+  const std::uint32_t h_m_hidden = (0x00000400);
+  const std::uint32_t h_e_pos = (0x0000000a);
+  const std::uint32_t h_e_bias = (0x0000000f);
+  const std::uint32_t h_e_max_normal = (0x0000001e);
+  const std::uint32_t h_nan = (0x00007e00);
+  const std::uint32_t h_m_hidden_nlz = (0x00000015);
+  const std::uint32_t q_pos = (0x0000000e);
+  constexpr std::uint32_t q_bit_count = (0x0000000f);
+  const std::uint32_t q_grs_size = (0x00000004);
+  const std::uint32_t q_grs_mask = (0x0000000f);
+  const std::uint32_t q_grs_round_bias = (0x00000007);
+  const std::uint32_t c_s = ((x ^ y) & h_s_mask);
+  const std::uint32_t x_em = (x & h_em_mask);
+  const std::uint32_t y_em = (y & h_em_mask);
+  const std::uint32_t x_e = (x_em >> h_e_pos);
+  const std::uint32_t y_e = (y_em >> h_e_pos);
+  const std::uint32_t x_m = (x & h_m_mask);
+  const std::uint32_t y_m = (y & h_m_mask);
+  const std::uint32_t is_x_e_eqz_msb = (x_e - 1);
+  const std::uint32_t is_y_e_eqz_msb = (y_e - 1);
+  const std::uint32_t x_m_hidden_bit =
+    half_private::_uint32_sels(is_x_e_eqz_msb, 0, h_m_hidden);
+  const std::uint32_t y_m_hidden_bit =
+    half_private::_uint32_sels(is_y_e_eqz_msb, 0, h_m_hidden);
+  const std::uint32_t x_m_with_hidden = (x_m | x_m_hidden_bit);
+  const std::uint32_t y_m_with_hidden = (y_m | y_m_hidden_bit);
+  const std::uint32_t x_e_denorm = (is_x_e_eqz_msb >> 31);
+  const std::uint32_t y_e_denorm = (is_y_e_eqz_msb >> 31);
+  const std::uint32_t x_e_unpacked = (x_e | x_e_denorm);
+  const std::uint32_t y_e_unpacked = (y_e | y_e_denorm);
+  const std::uint32_t x_m_nlz = half_private::_uint32_cntlz(x_m_with_hidden);
+  const std::uint32_t y_m_nlz = half_private::_uint32_cntlz(y_m_with_hidden);
+  const std::uint32_t x_m_sa = (x_m_nlz - h_m_hidden_nlz);
+  const std::uint32_t y_m_sa = (y_m_nlz - h_m_hidden_nlz);
+  const std::uint32_t x_m_norm = (x_m_with_hidden << x_m_sa);
+  const std::uint32_t y_m_norm = (y_m_with_hidden << y_m_sa);
+  const std::uint32_t x_e_norm = (x_e_unpacked - x_m_sa);
+  const std::uint32_t y_e_norm = (y_e_unpacked - y_m_sa);
+  const std::uint32_t is_x_zero_msb = (x_em - 1);
+  const std::uint32_t is_y_zero_msb = (y_em - 1);
+  const std::uint32_t q_divisor =
+    half_private::_uint32_sels(is_y_zero_msb, h_m_hidden, y_m_norm);
+  const std::uint32_t q_dividend = (x_m_norm << q_pos);
+  std::uint32_t q_rem = 0;
+  const std::uint32_t q = half_private::_uint32_div_small<q_bit_count>(
+    q_dividend, q_divisor, q_rem);
+  const std::uint32_t q_sticky = ((-q_rem) >> 31);
+  const std::uint32_t q_hi = (q >> q_pos);
+  const std::uint32_t q_lo = (q_hi ^ one);
+  const std::uint32_t q_shifted = (q << q_lo);
+  const std::uint32_t c_m_unrounded = (q_shifted | q_sticky);
+  const std::uint32_t c_e_diff = (x_e_norm - y_e_norm);
+  const std::uint32_t c_e_biased = (c_e_diff + h_e_bias);
+  const std::uint32_t c_e = (c_e_biased - q_lo);
+  const std::uint32_t is_c_denorm_msb = (c_e - 1);
+  const std::uint32_t c_denorm_sa_unclamped = (one - c_e);
+  const std::uint32_t c_denorm_sa =
+    half_private::_uint32_sels(is_c_denorm_msb, c_denorm_sa_unclamped, 0);
+  const std::uint32_t c_denorm_lost_mask = ((one << c_denorm_sa) - 1);
+  const std::uint32_t c_denorm_lost = (c_m_unrounded & c_denorm_lost_mask);
+  const std::uint32_t c_denorm_sticky = ((-c_denorm_lost) >> 31);
+  const std::uint32_t c_m_denorm = (c_m_unrounded >> c_denorm_sa);
+  const std::uint32_t c_m_grs = (c_m_denorm | c_denorm_sticky);
+  const std::uint32_t c_e_packed =
+    half_private::_uint32_sels(is_c_denorm_msb, one, c_e);
+  const std::uint32_t c_m = (c_m_grs >> q_grs_size);
+  const std::uint32_t c_m_lsb = (c_m & one);
+  const std::uint32_t c_grs = (c_m_grs & q_grs_mask);
+  const std::uint32_t c_grs_biased = (c_grs + q_grs_round_bias);
+  const std::uint32_t c_round = ((c_grs_biased + c_m_lsb) >> q_grs_size);
+  const std::uint32_t c_e_inplace = ((c_e_packed - 1) << h_e_pos);
+  const std::uint32_t c_em_unrounded = (c_e_inplace + c_m);
+  const std::uint32_t c_em_norm = (c_em_unrounded + c_round);
+  const std::uint32_t is_c_overflow_msb = (h_e_max_normal - c_e);
+  const std::uint32_t is_x_nan_msb = (h_e_mask - x_em);
+  const std::uint32_t is_y_nan_msb = (h_e_mask - y_em);
+  const std::uint32_t is_x_inf_msb = ((x_em ^ h_e_mask) - 1);
+  const std::uint32_t is_y_inf_msb = ((y_em ^ h_e_mask) - 1);
+  const std::uint32_t is_both_inf_msb = (is_x_inf_msb & is_y_inf_msb);
+  const std::uint32_t is_both_zero_msb = (is_x_zero_msb & is_y_zero_msb);
+  const std::uint32_t is_nan_operand_msb = (is_x_nan_msb | is_y_nan_msb);
+  const std::uint32_t is_invalid_msb = (is_both_inf_msb | is_both_zero_msb);
+  const std::uint32_t is_c_nan_msb = (is_nan_operand_msb | is_invalid_msb);
+  const std::uint32_t is_c_inf_msb = (is_x_inf_msb | is_y_zero_msb);
+  const std::uint32_t is_c_zero_msb = (is_x_zero_msb | is_y_inf_msb);
+  const std::uint32_t c_em_overflow_result =
+    half_private::_uint32_sels(is_c_overflow_msb, h_e_mask, c_em_norm);
+  const std::uint32_t c_em_zero_result =
+    half_private::_uint32_sels(is_c_zero_msb, 0, c_em_overflow_result);
+  const std::uint32_t c_em_inf_result =
+    half_private::_uint32_sels(is_c_inf_msb, h_e_mask, c_em_zero_result);
+  const std::uint32_t c_common_result = (c_s | c_em_inf_result);
+  const std::uint32_t c_result =
+    half_private::_uint32_sels(is_c_nan_msb, h_nan, c_common_result);
+  return std::uint16_t(c_result);
+}
+
+// Correctly rounded (to nearest even). sqrt(-0) is -0, other negative
+// inputs and NaNs give 0x7e00.
+constexpr inline std::uint16_t half_sqrt(std::uint16_t x) noexcept {
+  const std::uint32_t one = (0x00000001);
+  const std::uint32_t h_em_mask = (0x00007fff);
+  const std::uint32_t h_e_mask = (0x00007c00);
+  const std::uint32_t h_m_mask = (0x000003ff);
+  const std::uint32_t h_m_hidden = (0x00000400);
+  const std::uint32_t h_e_pos = (0x0000000a);
+  const std::uint32_t h_e_bias = (0x0000000f);
+  const std::uint32_t h_nan = (0x00007e00);
+  const std::uint32_t h_s_to_msb_sa = (0x00000010);
+  const std::uint32_t h_m_hidden_nlz = (0x00000015);
+  const std::uint32_t r_radicand_pos = (0x00000012);
+  const std::uint32_t r_grs_size = (0x00000004);
+  const std::uint32_t r_grs_mask = (0x0000000f);
+  const std::uint32_t r_grs_round_bias = (0x00000007);
+  const std::uint32_t x_em = (x & h_em_mask);
+  const std::uint32_t x_e = (x_em >> h_e_pos);
+  const std::uint32_t x_m = (x & h_m_mask);
+  const std::uint32_t is_x_e_eqz_msb = (x_e - 1);
+  const std::uint32_t x_m_hidden_bit =
+    half_private::_uint32_sels(is_x_e_eqz_msb, 0, h_m_hidden);
+  const std::uint32_t x_m_with_hidden = (x_m | x_m_hidden_bit);
+  const std::uint32_t x_e_denorm = (is_x_e_eqz_msb >> 31);
+  const std::uint32_t x_e_unpacked = (x_e | x_e_denorm);
+  const std::uint32_t x_m_nlz = half_private::_uint32_cntlz(x_m_with_hidden);
+  const std::uint32_t x_m_sa = (x_m_nlz - h_m_hidden_nlz);
+  const std::uint32_t x_m_norm = (x_m_with_hidden << x_m_sa);
+  const std::uint32_t x_e_norm = (x_e_unpacked - x_m_sa);
+  const std::uint32_t x_e_odd = ((x_e_norm + one) & one);
+  const std::uint32_t r_radicand_sa = (r_radicand_pos + x_e_odd);
+  const std::uint32_t r_radicand = (x_m_norm << r_radicand_sa);
+  const std::uint32_t r = half_private::_uint32_isqrt(r_radicand);
+  const std::uint32_t r_rem = (r_radicand - r * r);
+  const std::uint32_t r_sticky = ((-r_rem) >> 31);
+  const std::uint32_t c_m_grs = (r | r_sticky);
+  const std::uint32_t c_e_twice = (x_e_norm + h_e_bias - x_e_odd);
+  const std::uint32_t c_e = (c_e_twice >> one);
+  const std::uint32_t c_m = (c_m_grs >> r_grs_size);
+  const std::uint32_t c_m_lsb = (c_m & one);
+  const std::uint32_t c_grs = (c_m_grs & r_grs_mask);
+  const std::uint32_t c_grs_biased = (c_grs + r_grs_round_bias);
+  const std::uint32_t c_round = ((c_grs_biased + c_m_lsb) >> r_grs_size);
+  const std::uint32_t c_e_inplace = ((c_e - 1) << h_e_pos);
+  const std::uint32_t c_em_unrounded = (c_e_inplace + c_m);
+  const std::uint32_t c_em_norm = (c_em_unrounded + c_round);
+  const std::uint32_t x_s_msb = (x << h_s_to_msb_sa);
+  const std::uint32_t is_x_nez_msb = (-x_em);
+  const std::uint32_t is_x_zero_msb = (x_em - 1);
+  const std::uint32_t is_x_inf_msb = ((x_em ^ h_e_mask) - 1);
+  const std::uint32_t is_x_nan_msb = (h_e_mask - x_em);
+  const std::uint32_t is_x_negative_msb = (x_s_msb & is_x_nez_msb);
+  const std::uint32_t is_c_nan_msb = (is_x_nan_msb | is_x_negative_msb);
+  const std::uint32_t c_zero_result =
+    half_private::_uint32_sels(is_x_zero_msb, x, c_em_norm);
+  const std::uint32_t c_inf_result =
+    half_private::_uint32_sels(is_x_inf_msb, h_e_mask, c_zero_result);
+  const std::uint32_t c_result =
+    half_private::_uint32_sels(is_c_nan_msb, h_nan, c_inf_result);
+  return std::uint16_t(c_result);
+}
+
+// x * y + z with a single rounding (to nearest even). NaN results are 0x7e00.
+// The exact product (22 bits) and z are aligned in a 32 bit window whose top
+// is the larger of their leading bit positions; whatever falls below the
+// window can only matter as a sticky bit, since then the other operand is
+// far larger.
+constexpr inline std::uint16_t half_fma(std::uint16_t x, std::uint16_t y,
+                                        std::uint16_t z) noexcept {
+  const std::uint32_t one = (0x00000001);
+  const std::uint32_t h_s_mask = (0x00008000);
+  const std::uint32_t h_em_mask = (0x00007fff);
+  const std::uint32_t h_e_mask = (0x00007c00);
+  const std::uint32_t h_m_mask = (0x000003ff);
+  const std::uint32_t h_m_hidden = (0x00000400);
+  const std::uint32_t h_e_pos = (0x0000000a);
+  const std::uint32_t h_e_max_normal = (0x0000001e);
+  const std::uint32_t h_nan = (0x00007e00);
+  const std::uint32_t h_s_to_msb_sa = (0x00000010);
+  const std::uint32_t p_m_bits = (0x00000016);
+  const std::uint32_t z_m_bits = (0x0000000b);
+  const std::uint32_t z_e_offset = (0x00000019);
+  const std::uint32_t p_window_pos = (0x00000009);
+  const std::uint32_t z_window_pos = (0x00000014);
+  const std::uint32_t window_msb = (0x0000001f);
+  const std::uint32_t window_e_offset = (0x00000042);
+  const std::uint32_t c_m_grs_msb = (0x0000000d);
+  const std::uint32_t c_grs_size = (0x00000003);
+  const std::uint32_t c_grs_mask = (0x00000007);
+  const std::uint32_t c_grs_round_bias = (0x00000003);
+  const std::uint32_t x_s = (x & h_s_mask);
+  const std::uint32_t y_s = (y & h_s_mask);
+  const std::uint32_t p_s = (x_s ^ y_s);
+  const std::uint32_t z_s = (z & h_s_mask);
+  const std::uint32_t x_em = (x & h_em_mask);
+  const std::uint32_t y_em = (y & h_em_mask);
+  const std::uint32_t z_em = (z & h_em_mask);
+  const std::uint32_t x_e = (x_em >> h_e_pos);
+  const std::uint32_t y_e = (y_em >> h_e_pos);
+  const std::uint32_t z_e = (z_em >> h_e_pos);
+  const std::uint32_t is_x_e_eqz_msb = (x_e - 1);
+  const std::uint32_t is_y_e_eqz_msb = (y_e - 1);
+  const std::uint32_t is_z_e_eqz_msb = (z_e - 1);
+  const std::uint32_t x_m_hidden_bit =
+    half_private::_uint32_sels(is_x_e_eqz_msb, 0, h_m_hidden);
+  const std::uint32_t y_m_hidden_bit =
+    half_private::_uint32_sels(is_y_e_eqz_msb, 0, h_m_hidden);
+  const std::uint32_t z_m_hidden_bit =
+    half_private::_uint32_sels(is_z_e_eqz_msb, 0, h_m_hidden);
+  const std::uint32_t x_m = ((x & h_m_mask) | x_m_hidden_bit);
+  const std::uint32_t y_m = ((y & h_m_mask) | y_m_hidden_bit);
+  const std::uint32_t z_m = ((z & h_m_mask) | z_m_hidden_bit);
+  const std::uint32_t x_e_unpacked = (x_e | (is_x_e_eqz_msb >> 31));
+  const std::uint32_t y_e_unpacked = (y_e | (is_y_e_eqz_msb >> 31));
+  const std::uint32_t z_e_unpacked = (z_e | (is_z_e_eqz_msb >> 31));
+  const std::uint32_t p_m = (x_m * y_m);
+  const std::uint32_t p_top = (x_e_unpacked + y_e_unpacked + p_m_bits);
+  const std::uint32_t z_top = (z_e_unpacked + z_e_offset + z_m_bits);
+  const std::uint32_t is_z_top_larger_msb = (p_top - z_top);
+  const std::uint32_t top =
+    half_private::_uint32_sels(is_z_top_larger_msb, z_top, p_top);
+  const std::uint32_t p_d = (top - p_top);
+  const std::uint32_t z_d = (top - z_top);
+  const std::uint32_t p_sa = (p_window_pos - p_d);
+  const std::uint32_t z_sa = (z_window_pos - z_d);
+  const std::uint32_t p_rsa_unclamped = (p_d - p_window_pos);
+  const std::uint32_t z_rsa_unclamped = (z_d - z_window_pos);
+  const std::uint32_t p_rsa_clamp_msb = (window_msb - p_rsa_unclamped);
+  const std::uint32_t z_rsa_clamp_msb = (window_msb - z_rsa_unclamped);
+  const std::uint32_t p_rsa_clamped = half_private::_uint32_sels(
+    p_rsa_clamp_msb, window_msb, p_rsa_unclamped);
+  const std::uint32_t z_rsa_clamped = half_private::_uint32_sels(
+    z_rsa_clamp_msb, window_msb, z_rsa_unclamped);
+  const std::uint32_t p_lsa = half_private::_uint32_sels(p_sa, 0, p_sa);
+  const std::uint32_t z_lsa = half_private::_uint32_sels(z_sa, 0, z_sa);
+  const std::uint32_t p_rsa =
+    half_private::_uint32_sels(p_sa, p_rsa_clamped, 0);
+  const std::uint32_t z_rsa =
+    half_private::_uint32_sels(z_sa, z_rsa_clamped, 0);
+  const std::uint32_t p_lost = (p_m & ((one << p_rsa) - 1));
+  const std::uint32_t z_lost = (z_m & ((one << z_rsa) - 1));
+  const std::uint32_t p_sticky = ((-p_lost) >> 31);
+  const std::uint32_t z_sticky = ((-z_lost) >> 31);
+  const std::uint32_t p_window = (((p_m << p_lsa) >> p_rsa) | p_sticky);
+  const std::uint32_t z_window = (((z_m << z_lsa) >> z_rsa) | z_sticky);
+  const std::uint32_t is_sub_msb = ((p_s ^ z_s) << h_s_to_msb_sa);
+  const std::uint32_t is_z_larger_msb = (p_window - z_window);
+  const std::uint32_t c_sum = (p_window + z_window);
+  const std::uint32_t c_diff_pz = (p_window - z_window);
+  const std::uint32_t c_diff_zp = (z_window - p_window);
+  const std::uint32_t c_diff =
+    half_private::_uint32_sels(is_z_larger_msb, c_diff_zp, c_diff_pz);
+  const std::uint32_t is_c_s_z_msb = (is_sub_msb & is_z_larger_msb);
+  const std::uint32_t c_window =
+    half_private::_uint32_sels(is_sub_msb, c_diff, c_sum);
+  const std::uint32_t c_s = half_private::_uint32_sels(is_c_s_z_msb, z_s, p_s);
+  const std::uint32_t c_nlz = half_private::_uint32_cntlz(c_window);
+  const std::uint32_t c_msb = (window_msb - c_nlz);
+  const std::uint32_t c_e = (c_msb + top - window_e_offset);
+  const std::uint32_t is_c_denorm_msb = (c_e - 1);
+  const std::uint32_t c_denorm_sa = (one - c_e);
+  const std::uint32_t c_e_packed =
+    half_private::_uint32_sels(is_c_denorm_msb, one, c_e);
+  const std::uint32_t c_norm_sa = (c_msb - c_m_grs_msb);
+  const std::uint32_t c_extra_sa =
+    half_private::_uint32_sels(is_c_denorm_msb, c_denorm_sa, 0);
+  const std::uint32_t c_sa = (c_norm_sa + c_extra_sa);
+  const std::uint32_t c_lsa_unclamped = (-c_sa);
+  const std::uint32_t c_rsa_clamp_msb = (window_msb - c_sa);
+  const std::uint32_t c_rsa_clamped =
+    half_private::_uint32_sels(c_rsa_clamp_msb, window_msb, c_sa);
+  const std::uint32_t c_lsa =
+    half_private::_uint32_sels(c_sa, c_lsa_unclamped, 0);
+  const std::uint32_t c_rsa =
+    half_private::_uint32_sels(c_sa, 0, c_rsa_clamped);
+  const std::uint32_t c_lost = (c_window & ((one << c_rsa) - 1));
+  const std::uint32_t c_sticky = ((-c_lost) >> 31);
+  const std::uint32_t c_m_grs = (((c_window << c_lsa) >> c_rsa) | c_sticky);
+  const std::uint32_t c_m = (c_m_grs >> c_grs_size);
+  const std::uint32_t c_m_lsb = (c_m & one);
+  const std::uint32_t c_grs = (c_m_grs & c_grs_mask);
+  const std::uint32_t c_grs_biased = (c_grs + c_grs_round_bias);
+  const std::uint32_t c_round = ((c_grs_biased + c_m_lsb) >> c_grs_size);
+  const std::uint32_t c_e_inplace = ((c_e_packed - 1) << h_e_pos);
+  const std::uint32_t c_em_unrounded = (c_e_inplace + c_m);
+  const std::uint32_t c_em_norm = (c_em_unrounded + c_round);
+  const std::uint32_t is_c_overflow_msb = (h_e_max_normal - c_e);
+  const std::uint32_t is_c_zero_msb = (~c_window & (c_window - 1));
+  const std::uint32_t c_s_zero = (p_s & z_s);
+  const std::uint32_t is_x_nan_msb = (h_e_mask - x_em);
+  const std::uint32_t is_y_nan_msb = (h_e_mask - y_em);
+  const std::uint32_t is_z_nan_msb = (h_e_mask - z_em);
+  const std::uint32_t is_x_inf_msb = ((x_em ^ h_e_mask) - 1);
+  const std::uint32_t is_y_inf_msb = ((y_em ^ h_e_mask) - 1);
+  const std::uint32_t is_z_inf_msb = ((z_em ^ h_e_mask) - 1);
+  const std::uint32_t is_x_zero_msb = (x_em - 1);
+  const std::uint32_t is_y_zero_msb = (y_em - 1);
+  const std::uint32_t is_p_inf_msb = (is_x_inf_msb | is_y_inf_msb);
+  const std::uint32_t is_p_inf_zero_msb =
+    ((is_x_inf_msb & is_y_zero_msb) | (is_y_inf_msb & is_x_zero_msb));
+  const std::uint32_t is_inf_sub_msb =
+    (is_p_inf_msb & is_z_inf_msb & is_sub_msb);
+  const std::uint32_t is_nan_operand_msb =
+    (is_x_nan_msb | is_y_nan_msb | is_z_nan_msb);
+  const std::uint32_t is_c_nan_msb =
+    (is_nan_operand_msb | is_p_inf_zero_msb | is_inf_sub_msb);
+  const std::uint32_t c_em_overflow_result =
+    half_private::_uint32_sels(is_c_overflow_msb, h_e_mask, c_em_norm);
+  const std::uint32_t c_common_result = (c_s | c_em_overflow_result);
+  const std::uint32_t c_zero_result =
+    half_private::_uint32_sels(is_c_zero_msb, c_s_zero, c_common_result);
+  const std::uint32_t c_z_inf_result =
+    half_private::_uint32_sels(is_z_inf_msb, z, c_zero_result);
+  const std::uint32_t c_p_inf_result =
+    half_private::_uint32_sels(is_p_inf_msb, p_s | h_e_mask, c_z_inf_result);
+  const std::uint32_t c_result =
+    half_private::_uint32_sels(is_c_nan_msb, h_nan, c_p_inf_result);
+  return std::uint16_t(c_result);
+}
+
 constexpr inline std::uint16_t half_neg(std::uint16_t h) noexcept {
   return h ^ 0x8000;
 }
@@ -330,6 +659,139 @@ constexpr inline std::uint16_t half_sub(std::uint16_t ha,
 
 } // namespace half
 
+namespace half::half_private {
+
+// The value order as an integer: the sign-magnitude bits turned into two's
+// complement, so -0 and +0 both map to 0.
+[[nodiscard]] constexpr inline std::uint32_t
+_half_order_key(std::uint16_t h) noexcept {
+  const std::uint32_t h_em_mask = (0x00007fff);
+  const std::uint32_t h_s_to_msb_sa = (0x00000010);
+  const std::uint32_t em = (h & h_em_mask);
+  const std::uint32_t s_msb = (std::uint32_t(h) << h_s_to_msb_sa);
+  const std::uint32_t s_mask = (std::uint32_t)(((std::int32_t)s_msb) >> 31);
+  const std::uint32_t key = ((em ^ s_mask) - s_mask);
+  return key;
+}
+
+// The same with -0 below +0 and NaNs at the ends, IEEE 754 totalOrder:
+// negative values map to -em - 1.
+[[nodiscard]] constexpr inline std::uint32_t
+_half_total_order_key(std::uint16_t h) noexcept {
+  const std::uint32_t h_em_mask = (0x00007fff);
+  const std::uint32_t h_s_to_msb_sa = (0x00000010);
+  const std::uint32_t em = (h & h_em_mask);
+  const std::uint32_t s_msb = (std::uint32_t(h) << h_s_to_msb_sa);
+  const std::uint32_t s_mask = (std::uint32_t)(((std::int32_t)s_msb) >> 31);
+  const std::uint32_t key = (em ^ s_mask);
+  return key;
+}
+
+[[nodiscard]] constexpr inline std::uint32_t
+_half_is_nan_msb(std::uint16_t h) noexcept {
+  const std::uint32_t h_em_mask = (0x00007fff);
+  const std::uint32_t h_e_mask = (0x00007c00);
+  const std::uint32_t em = (h & h_em_mask);
+  const std::uint32_t is_nan_msb = (h_e_mask - em);
+  return is_nan_msb;
+}
+
+} // namespace half::half_private
+
+namespace half {
+
+// IEEE comparisons without branches: false if either side is NaN, and
+// -0 == +0. The keys differ by less than 2^16, so the msb of their
+// difference is the comparison.
+constexpr inline bool half_less(std::uint16_t x, std::uint16_t y) noexcept {
+  const std::uint32_t x_key = half_private::_half_order_key(x);
+  const std::uint32_t y_key = half_private::_half_order_key(y);
+  const std::uint32_t is_x_nan_msb = half_private::_half_is_nan_msb(x);
+  const std::uint32_t is_y_nan_msb = half_private::_half_is_nan_msb(y);
+  const std::uint32_t is_less_msb = (x_key - y_key);
+  const std::uint32_t is_c_msb = (is_less_msb & ~is_x_nan_msb & ~is_y_nan_msb);
+  return (is_c_msb >> 31) != 0;
+}
+
+constexpr inline bool half_less_equal(std::uint16_t x,
+                                      std::uint16_t y) noexcept {
+  const std::uint32_t x_key = half_private::_half_order_key(x);
+  const std::uint32_t y_key = half_private::_half_order_key(y);
+  const std::uint32_t is_x_nan_msb = half_private::_half_is_nan_msb(x);
+  const std::uint32_t is_y_nan_msb = half_private::_half_is_nan_msb(y);
+  const std::uint32_t is_greater_msb = (y_key - x_key);
+  const std::uint32_t is_c_msb =
+    (~is_greater_msb & ~is_x_nan_msb & ~is_y_nan_msb);
+  return (is_c_msb >> 31) != 0;
+}
+
+constexpr inline bool half_equal(std::uint16_t x, std::uint16_t y) noexcept {
+  const std::uint32_t x_key = half_private::_half_order_key(x);
+  const std::uint32_t y_key = half_private::_half_order_key(y);
+  const std::uint32_t is_x_nan_msb = half_private::_half_is_nan_msb(x);
+  const std::uint32_t is_y_nan_msb = half_private::_half_is_nan_msb(y);
+  const std::uint32_t diff = (x_key - y_key);
+  const std::uint32_t is_equal_msb = (~diff & (diff - 1));
+  const std::uint32_t is_c_msb = (is_equal_msb & ~is_x_nan_msb & ~is_y_nan_msb);
+  return (is_c_msb >> 31) != 0;
+}
+
+// IEEE 754 totalOrder(x, y), i.e. x <= y in the order -NaN < -inf < ... <
+// -0 < +0 < ... < +inf < +NaN; totalOrderMag compares |x| and |y|.
+constexpr inline bool half_total_order(std::uint16_t x,
+                                       std::uint16_t y) noexcept {
+  const std::uint32_t x_key = half_private::_half_total_order_key(x);
+  const std::uint32_t y_key = half_private::_half_total_order_key(y);
+  const std::uint32_t is_greater_msb = (y_key - x_key);
+  return (is_greater_msb >> 31) == 0;
+}
+
+constexpr inline bool half_total_order_mag(std::uint16_t x,
+                                           std::uint16_t y) noexcept {
+  const std::uint16_t h_em_mask = (0x7fff);
+  return half_total_order(x & h_em_mask, y & h_em_mask);
+}
+
+// IEEE 754 minimumNumber / maximumNumber: a NaN operand gives the other one
+// and -0 < +0.
+constexpr inline std::uint16_t half_min(std::uint16_t x,
+                                        std::uint16_t y) noexcept {
+  const std::uint32_t x_key = half_private::_half_total_order_key(x);
+  const std::uint32_t y_key = half_private::_half_total_order_key(y);
+  const std::uint32_t is_x_nan_msb = half_private::_half_is_nan_msb(x);
+  const std::uint32_t is_y_nan_msb = half_private::_half_is_nan_msb(y);
+  const std::uint32_t is_y_less_msb = (y_key - x_key);
+  const std::uint32_t is_c_y_msb =
+    (is_x_nan_msb | (is_y_less_msb & ~is_y_nan_msb));
+  const std::uint32_t c_result = half_private::_uint32_sels(is_c_y_msb, y, x);
+  return std::uint16_t(c_result);
+}
+
+constexpr inline std::uint16_t half_max(std::uint16_t x,
+                                        std::uint16_t y) noexcept {
+  const std::uint32_t x_key = half_private::_half_total_order_key(x);
+  const std::uint32_t y_key = half_private::_half_total_order_key(y);
+  const std::uint32_t is_x_nan_msb = half_private::_half_is_nan_msb(x);
+  const std::uint32_t is_y_nan_msb = half_private::_half_is_nan_msb(y);
+  const std::uint32_t is_y_greater_msb = (x_key - y_key);
+  const std::uint32_t is_c_y_msb =
+    (is_x_nan_msb | (is_y_greater_msb & ~is_y_nan_msb));
+  const std::uint32_t c_result = half_private::_uint32_sels(is_c_y_msb, y, x);
+  return std::uint16_t(c_result);
+}
+
+// half_min(half_max(x, lo), hi) for lo <= hi, except that a NaN x stays.
+constexpr inline std::uint16_t half_clamp(std::uint16_t x, std::uint16_t lo,
+                                          std::uint16_t hi) noexcept {
+  const std::uint32_t is_x_nan_msb = half_private::_half_is_nan_msb(x);
+  const std::uint32_t c_clamped = half_min(half_max(x, lo), hi);
+  const std::uint32_t c_result =
+    half_private::_uint32_sels(is_x_nan_msb, x, c_clamped);
+  return std::uint16_t(c_result);
+}
+
+} // namespace half
+
 namespace numeric {
 constexpr inline unsigned long const version = 20210121UL;
 #ifdef FLOAT16_T_DEBUG
@@ -388,17 +850,41 @@ inline std::ostream &operator<<(std::ostream &os, float32 const &f32) {
   return os;
 }
 
+#ifdef FLOAT16_T_NATIVE_FLOAT16
+// The compiler's _Float16 (IEEE binary16, round to nearest even); meson
+// defines FLOAT16_T_NATIVE_FLOAT16 when the compiler has it.
+constexpr inline _Float16 to_native(float16 f16) noexcept {
+  return std::bit_cast<_Float16>(f16.bits_);
+}
+
+constexpr inline float16 from_native(_Float16 v) noexcept {
+  return float16{std::bit_cast<std::uint16_t>(v)};
+}
+#endif
+
 inline constexpr float16 float32_to_float16(float input) noexcept {
+#ifdef FLOAT16_T_NATIVE_FLOAT16
+  return from_native(static_cast<_Float16>(input));
+#else
   float32 f32 = {};
   f32.bits_ = std::bit_cast<std::uint32_t>(input);
   float16 f16 = {};
   f16.bits_ = half::float_to_half(f32.bits_);
   return f16;
+#endif
 }
 
 inline constexpr float32 float16_to_float32(std::uint16_t input) noexcept {
   float32 f32{};
+#if defined(FLOAT16_T_NATIVE_FLOAT16)
+  f32.bits_ = std::bit_cast<std::uint32_t>(
+    static_cast<float>(to_native(float16{input})));
+#elif defined(FLOAT16_T_HALF_TO_FLOAT_TABLE)
+  f32.bits_ = std::is_constant_evaluated() ? half::half_to_float(input)
+                                           : half::half_to_float_table(input);
+#else
   f32.bits_ = half::half_to_float(input);
+#endif
   return f32;
 }
 
@@ -422,6 +908,10 @@ struct float16_t {
     data_{float16_t_private::float32_to_float16(static_cast<float>(other))} {}
   explicit constexpr inline float16_t(std::uint16_t bits) noexcept :
     data_{bits} {}
+#ifdef FLOAT16_T_NATIVE_FLOAT16
+  explicit constexpr inline float16_t(_Float16 other) noexcept :
+    data_{float16_t_private::from_native(other)} {}
+#endif
 
   constexpr inline float16_t &operator=(float16_t const &) noexcept = default;
   constexpr inline float16_t &operator=(float16_t &&) noexcept = default;
@@ -443,42 +933,66 @@ struct float16_t {
     return data_.bits_;
   }
 
+#ifdef FLOAT16_T_NATIVE_FLOAT16
+  explicit constexpr inline operator _Float16() const noexcept {
+    return float16_t_private::to_native(data_);
+  }
+#endif
+
   constexpr inline float16_t &operator+=(float16_t v) noexcept {
+#ifdef FLOAT16_T_NATIVE_FLOAT16
+    const _Float16 x = float16_t_private::to_native(data_);
+    const _Float16 y = float16_t_private::to_native(v.data_);
+    data_ = float16_t_private::from_native(x + y);
+#else
     data_.bits_ = half::half_add(data_.bits_, v.data_.bits_);
+#endif
     return *this;
   }
 
   constexpr inline float16_t &operator-=(float16_t v) noexcept {
+#ifdef FLOAT16_T_NATIVE_FLOAT16
+    const _Float16 x = float16_t_private::to_native(data_);
+    const _Float16 y = float16_t_private::to_native(v.data_);
+    data_ = float16_t_private::from_native(x - y);
+#else
     data_.bits_ = half::half_sub(data_.bits_, v.data_.bits_);
+#endif
     return *this;
   }
 
   constexpr inline float16_t &operator*=(float16_t v) noexcept {
+#ifdef FLOAT16_T_NATIVE_FLOAT16
+    const _Float16 x = float16_t_private::to_native(data_);
+    const _Float16 y = float16_t_private::to_native(v.data_);
+    data_ = float16_t_private::from_native(x * y);
+#else
     data_.bits_ = half::half_mul(data_.bits_, v.data_.bits_);
+#endif
     return *this;
   }
 
   constexpr inline float16_t &operator/=(float16_t v) noexcept {
-    *this = float(*this) / float(v);
+#ifdef FLOAT16_T_NATIVE_FLOAT16
+    const _Float16 x = float16_t_private::to_native(data_);
+    const _Float16 y = float16_t_private::to_native(v.data_);
+    data_ = float16_t_private::from_native(x / y);
+#else
+    data_.bits_ = half::half_div(data_.bits_, v.data_.bits_);
+#endif
     return *this;
   }
 
   constexpr inline float16_t &operator+=(float v) noexcept {
-    auto f16 = float16_t_private::float32_to_float16(v);
-    data_.bits_ = half::half_add(data_.bits_, f16.bits_);
-    return *this;
+    return *this += float16_t{v};
   }
 
   constexpr inline float16_t &operator-=(float v) noexcept {
-    auto f16 = float16_t_private::float32_to_float16(v);
-    data_.bits_ = half::half_sub(data_.bits_, f16.bits_);
-    return *this;
+    return *this -= float16_t{v};
   }
 
   constexpr inline float16_t &operator*=(float v) noexcept {
-    auto f16 = float16_t_private::float32_to_float16(v);
-    data_.bits_ = half::half_mul(data_.bits_, f16.bits_);
-    return *this;
+    return *this *= float16_t{v};
   }
 
   constexpr inline float16_t &operator/=(float v) noexcept {
@@ -542,56 +1056,71 @@ constexpr inline float16_t operator*(float16_t lhs, float16_t rhs) noexcept {
 }
 
 constexpr inline float16_t operator/(float16_t lhs, float16_t rhs) noexcept {
-  return float16_t{float(lhs) / float(rhs)};
+  float16_t ans{lhs};
+  ans /= rhs;
+  return ans;
 }
 
+#ifdef FLOAT16_T_NATIVE_FLOAT16
+
 constexpr inline bool operator<(float16_t lhs, float16_t rhs) noexcept {
-  auto const l_ieee = lhs.data_.ieee_();
-  auto const r_ieee = rhs.data_.ieee_();
-
-  if (l_ieee.sign_ == 1) {
-    if (r_ieee.sign_ == 0)
-      return true;
-    if (l_ieee.exp_ > r_ieee.exp_)
-      return true;
-    if (l_ieee.exp_ < r_ieee.exp_)
-      return false;
-    if (l_ieee.frac_ > r_ieee.frac_)
-      return true;
-    return false;
-  }
+  return float16_t_private::to_native(lhs.data_) <
+         float16_t_private::to_native(rhs.data_);
+}
+
+constexpr inline bool operator==(float16_t lhs, float16_t rhs) noexcept {
+  return float16_t_private::to_native(lhs.data_) ==
+         float16_t_private::to_native(rhs.data_);
+}
 
-  if (r_ieee.sign_ == 1)
-    return false;
-  if (l_ieee.exp_ > r_ieee.exp_)
-    return false;
-  if (l_ieee.exp_ < r_ieee.exp_)
-    return true;
-  if (l_ieee.frac_ >= r_ieee.frac_)
-    return false;
-  return true;
+constexpr inline bool operator<=(float16_t lhs, float16_t rhs) noexcept {
+  return float16_t_private::to_native(lhs.data_) <=
+         float16_t_private::to_native(rhs.data_);
+}
+
+constexpr inline bool operator>(float16_t lhs, float16_t rhs) noexcept {
+  return float16_t_private::to_native(lhs.data_) >
+         float16_t_private::to_native(rhs.data_);
+}
+
+constexpr inline bool operator>=(float16_t lhs, float16_t rhs) noexcept {
+  return float16_t_private::to_native(lhs.data_) >=
+         float16_t_private::to_native(rhs.data_);
+}
+
+constexpr inline bool operator!=(float16_t lhs, float16_t rhs) noexcept {
+  return float16_t_private::to_native(lhs.data_) !=
+         float16_t_private::to_native(rhs.data_);
+}
+
+#else
+
+constexpr inline bool operator<(float16_t lhs, float16_t rhs) noexcept {
+  return half::half_less(lhs.data_.bits_, rhs.data_.bits_);
 }
 
 constexpr inline bool operator==(float16_t lhs, float16_t rhs) noexcept {
-  return lhs.data_.bits_ == rhs.data_.bits_;
+  return half::half_equal(lhs.data_.bits_, rhs.data_.bits_);
 }
 
 constexpr inline bool operator<=(float16_t lhs, float16_t rhs) noexcept {
-  return (lhs < rhs) || (lhs == rhs);
+  return half::half_less_equal(lhs.data_.bits_, rhs.data_.bits_);
 }
 
 constexpr inline bool operator>(float16_t lhs, float16_t rhs) noexcept {
-  return !(lhs <= rhs);
+  return half::half_less(rhs.data_.bits_, lhs.data_.bits_);
 }
 
 constexpr inline bool operator>=(float16_t lhs, float16_t rhs) noexcept {
-  return !(lhs < rhs);
+  return half::half_less_equal(rhs.data_.bits_, lhs.data_.bits_);
 }
 
 constexpr inline bool operator!=(float16_t lhs, float16_t rhs) noexcept {
   return !(lhs == rhs);
 }
 
+#endif
+
 template <typename CharT, class Traits>
 std::basic_ostream<CharT, Traits> &
 operator<<(std::basic_ostream<CharT, Traits> &os, float16_t const &f) {
@@ -660,12 +1189,15 @@ constexpr inline auto fmod = float16_t_private::make_binary_function(
 constexpr inline auto remainder = float16_t_private::make_binary_function(
   [](float f1, float f2) { return std::remainder(f1, f2); });
 // remquo ??
-constexpr inline auto fma = float16_t_private::make_trinary_function(
-  [](float f1, float f2, float f3) { return std::fma(f1, f2, f3); });
+constexpr inline float16_t fma(float16_t f1, float16_t f2,
+                               float16_t f3) noexcept {
+  return float16_t{half::half_fma(f1.data_.bits_, f2.data_.bits_,
+                                  f3.data_.bits_)};
+}
 constexpr inline auto fmax = float16_t_private::make_binary_function(
   [](float f1, float f2) { return std::fmax(f1, f2); });
 constexpr inline auto fmin = float16_t_private::make_binary_function(
-  [](float f1, float f2) { return std::fmax(f1, f2); });
+  [](float f1, float f2) { return std::fmin(f1, f2); });
 constexpr inline auto fdim = float16_t_private::make_binary_function(
   [](float f1, float f2) { return std::fdim(f1, f2); });
 constexpr inline auto lerp = float16_t_private::make_trinary_function(
@@ -686,8 +1218,9 @@ constexpr inline auto log1p =
   float16_t_private::make_unary_function([](float f) { return std::log1p(f); });
 constexpr inline auto pow = float16_t_private::make_binary_function(
   [](float f1, float f2) { return std::pow(f1, f2); });
-constexpr inline auto sqrt =
-  float16_t_private::make_unary_function([](float f) { return std::sqrt(f); });
+constexpr inline float16_t sqrt(float16_t f) noexcept {
+  return float16_t{half::half_sqrt(f.data_.bits_)};
+}
 constexpr inline auto cbrt =
   float16_t_private::make_unary_function([](float f) { return std::cbrt(f); });
 
@@ -761,20 +1294,29 @@ constexpr inline auto copysign = float16_t_private::make_binary_function(
   [](float f1, float f2) { return std::copysign(f1, f2); });
 
 constexpr inline bool is_nan(float16_t f16) noexcept {
-  return (std::uint16_t(f16) & 0x7fff) > 0x7f80;
+  return (std::uint16_t(f16) & 0x7fff) > 0x7c00;
 }
 
 constexpr inline bool is_inf(float16_t f16) noexcept {
-  return (std::uint16_t(f16) & 0x7fff) == 0x7f80;
+  return (std::uint16_t(f16) & 0x7fff) == 0x7c00;
 }
 
 constexpr inline bool is_finite(float16_t f16) noexcept {
-  return (std::uint16_t(f16) & 0x7f80) != 0x7f80;
+  return (std::uint16_t(f16) & 0x7c00) != 0x7c00;
 }
 
 constexpr inline bool is_normal(float16_t f16) noexcept {
-  auto const exponent = std::uint16_t(f16) & 0x7f80;
-  return (exponent != 0x7f80) && (exponent != 0);
+  auto const exponent = std::uint16_t(f16) & 0x7c00;
+  return (exponent != 0x7c00) && (exponent != 0);
+}
+
+// IEEE 754 totalOrder and totalOrderMag, see half::half_total_order.
+constexpr inline bool total_order(float16_t f1, float16_t f2) noexcept {
+  return half::half_total_order(std::uint16_t(f1), std::uint16_t(f2));
+}
+
+constexpr inline bool total_order_mag(float16_t f1, float16_t f2) noexcept {
+  return half::half_total_order_mag(std::uint16_t(f1), std::uint16_t(f2));
 }
 
 constexpr inline bool is_positive(float16_t f16) noexcept {
@@ -821,8 +1363,6 @@ constexpr inline auto riemann_zeta = float16_t_private::make_unary_function(
 
 } // namespace numeric
 
-#endif
-
 namespace std {
 
 template <> struct numeric_limits<numeric::float16_t> {
@@ -889,3 +1429,5 @@ template <> inline constexpr bool is_signed_v<numeric::float16_t> = true;
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
+
+#endif
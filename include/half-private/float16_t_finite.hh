@@ -0,0 +1,312 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+#include "dispatch.hh"
+#include "float16_t.hpp"
+#include "fp_convert.hh"
+#include "fp_convert_n.hh"
+#include "parallel.hh"
+#include "simd.hh"
+
+namespace half::half_private {
+
+inline bool _half_all_finite_n_scalar(const std::uint16_t *x,
+                                      std::size_t n) noexcept {
+  const std::uint16_t h_e_mask = (0x7c00);
+  for (std::size_t i = 0; i < n; ++i)
+    if ((x[i] & h_e_mask) == h_e_mask)
+      return false;
+  return true;
+}
+
+// x[i] = x[i] * factor for every i, rounded as float_to_half; false as soon
+// as a result is not finite, leaving the rest of x as it was.
+inline bool _half_unscale_n_scalar(std::uint16_t *x, std::size_t n,
+                                   float factor) noexcept {
+  const std::uint16_t h_e_mask = (0x7c00);
+  for (std::size_t i = 0; i < n; ++i) {
+    const float f = std::bit_cast<float>(half_to_float(x[i]));
+    const std::uint32_t product = std::bit_cast<std::uint32_t>(f * factor);
+    const std::uint16_t c = float_to_half(product);
+    x[i] = c;
+    if ((c & h_e_mask) == h_e_mask)
+      return false;
+  }
+  return true;
+}
+
+// dst[i] = x[i] * factor in fp32, which keeps the results that would be
+// fp16 subnormals or zero; false as soon as one is not finite.
+inline bool _half_unscale_to_float_n_scalar(const std::uint16_t *x,
+                                            std::uint32_t *dst, std::size_t n,
+                                            float factor) noexcept {
+  const std::uint32_t f_e_mask = (0x7f800000);
+  for (std::size_t i = 0; i < n; ++i) {
+    const float f = std::bit_cast<float>(half_to_float(x[i]));
+    const std::uint32_t product = std::bit_cast<std::uint32_t>(f * factor);
+    dst[i] = product;
+    if ((product & f_e_mask) == f_e_mask)
+      return false;
+  }
+  return true;
+}
+
+#if FLOAT16_T_HAS_VECTOR_EXT
+
+// Vectors tested together: their non-finite masks are OR-ed and only the
+// result is reduced, one horizontal test per group. A half is an infinity
+// or a NaN iff its exponent is all ones, that is iff (h & h_e_mask) +
+// h_e_lsb carries into bit 15.
+inline constexpr std::size_t _finite_vectors = 4;
+
+// Whether any lane of v has a bit of mask set, mask repeating the lane
+// pattern across 64 bits.
+template <typename V_>
+FLOAT16_T_SIMD_INLINE bool _vec_any_bits(const V_ &v,
+                                         std::uint64_t mask) noexcept {
+  std::uint64_t words[sizeof(V_) / sizeof(std::uint64_t)];
+  std::memcpy(words, &v, sizeof(words));
+  std::uint64_t any = 0;
+  for (const std::uint64_t word : words)
+    any |= word;
+  return (any & mask) != 0;
+}
+
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE bool _half_all_finite_n_kernel(const std::uint16_t *x,
+                                                     std::size_t n) noexcept {
+  using vh = typename _simd<N_>::u16;
+  const std::uint16_t h_e_mask = (0x7c00);
+  const std::uint16_t h_e_lsb = (0x0400);
+  const std::uint64_t h_msb_lanes = (0x8000800080008000);
+  constexpr std::size_t step = _finite_vectors * N_;
+  std::size_t i = 0;
+  for (; i + step <= n; i += step) {
+    vh is_nonfinite_msb{};
+    for (std::size_t v = 0; v < _finite_vectors; ++v) {
+      vh h;
+      std::memcpy(&h, x + i + v * N_, sizeof(h));
+      is_nonfinite_msb |= ((h & h_e_mask) + h_e_lsb);
+    }
+    if (_vec_any_bits(is_nonfinite_msb, h_msb_lanes))
+      return false;
+  }
+  return _half_all_finite_n_scalar(x + i, n - i);
+}
+
+// Widen_ loads Widen_::lanes halves as fp32 lanes; the products narrow
+// through _vec_float_to_half, so the results are the scalar ones.
+template <typename Widen_>
+FLOAT16_T_SIMD_INLINE bool _half_unscale_n_kernel(std::uint16_t *x,
+                                                  std::size_t n,
+                                                  float factor) noexcept {
+  constexpr std::size_t N_ = Widen_::lanes;
+  using vu = typename _simd<N_>::u32;
+  using vh = typename _simd<N_>::u16;
+  using vf = typename _simd<N_>::f32;
+  const std::uint32_t h_e_mask = (0x00007c00);
+  const std::uint32_t h_e_lsb = (0x00000400);
+  const std::uint64_t h_msb_lanes = (0x0000800000008000);
+  constexpr std::size_t step = _finite_vectors * N_;
+  std::size_t i = 0;
+  for (; i + step <= n; i += step) {
+    vu is_nonfinite_msb{};
+    for (std::size_t v = 0; v < _finite_vectors; ++v) {
+      vf f;
+      Widen_::load(f, x + i + v * N_);
+      const vu product = (vu)(f * factor);
+      vu c;
+      _vec_float_to_half<N_>(c, product);
+      const vh c_narrow = __builtin_convertvector(c, vh);
+      std::memcpy(x + i + v * N_, &c_narrow, sizeof(c_narrow));
+      is_nonfinite_msb |= ((c & h_e_mask) + h_e_lsb);
+    }
+    if (_vec_any_bits(is_nonfinite_msb, h_msb_lanes))
+      return false;
+  }
+  return _half_unscale_n_scalar(x + i, n - i, factor);
+}
+
+// The products are checked as floats: (p & f_e_mask) + f_e_lsb carries
+// into bit 31 iff the exponent is all ones.
+template <typename Widen_>
+FLOAT16_T_SIMD_INLINE bool
+_half_unscale_to_float_n_kernel(const std::uint16_t *x, std::uint32_t *dst,
+                                std::size_t n, float factor) noexcept {
+  constexpr std::size_t N_ = Widen_::lanes;
+  using vu = typename _simd<N_>::u32;
+  using vf = typename _simd<N_>::f32;
+  const std::uint32_t f_e_mask = (0x7f800000);
+  const std::uint32_t f_e_lsb = (0x00800000);
+  const std::uint64_t f_msb_lanes = (0x8000000080000000);
+  constexpr std::size_t step = _finite_vectors * N_;
+  std::size_t i = 0;
+  for (; i + step <= n; i += step) {
+    vu is_nonfinite_msb{};
+    for (std::size_t v = 0; v < _finite_vectors; ++v) {
+      vf f;
+      Widen_::load(f, x + i + v * N_);
+      const vu product = (vu)(f * factor);
+      std::memcpy(dst + i + v * N_, &product, sizeof(product));
+      is_nonfinite_msb |= ((product & f_e_mask) + f_e_lsb);
+    }
+    if (_vec_any_bits(is_nonfinite_msb, f_msb_lanes))
+      return false;
+  }
+  return _half_unscale_to_float_n_scalar(x + i, dst + i, n - i, factor);
+}
+
+inline bool _half_all_finite_n_simd128(const std::uint16_t *x,
+                                       std::size_t n) noexcept {
+  return _half_all_finite_n_kernel<8>(x, n);
+}
+
+inline bool _half_unscale_n_simd128(std::uint16_t *x, std::size_t n,
+                                    float factor) noexcept {
+  return _half_unscale_n_kernel<_half_widen_emulated<4>>(x, n, factor);
+}
+
+inline bool _half_unscale_to_float_n_simd128(const std::uint16_t *x,
+                                             std::uint32_t *dst, std::size_t n,
+                                             float factor) noexcept {
+  return _half_unscale_to_float_n_kernel<_half_widen_emulated<4>>(x, dst, n,
+                                                                  factor);
+}
+
+#endif // FLOAT16_T_HAS_VECTOR_EXT
+
+using _half_all_finite_n_fn = bool(const std::uint16_t *,
+                                   std::size_t) noexcept;
+using _half_unscale_n_fn = bool(std::uint16_t *, std::size_t, float) noexcept;
+using _half_unscale_to_float_n_fn = bool(const std::uint16_t *,
+                                         std::uint32_t *, std::size_t,
+                                         float) noexcept;
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+
+FLOAT16_T_TARGET_AVX2 inline bool
+_half_all_finite_n_avx2(const std::uint16_t *x, std::size_t n) noexcept {
+  return _half_all_finite_n_kernel<16>(x, n);
+}
+
+FLOAT16_T_TARGET_AVX512 inline bool
+_half_all_finite_n_avx512(const std::uint16_t *x, std::size_t n) noexcept {
+  return _half_all_finite_n_kernel<32>(x, n);
+}
+
+FLOAT16_T_TARGET_AVX2 inline bool
+_half_unscale_n_avx2(std::uint16_t *x, std::size_t n, float factor) noexcept {
+  return _half_unscale_n_kernel<_half_widen_f16c>(x, n, factor);
+}
+
+FLOAT16_T_TARGET_AVX512 inline bool
+_half_unscale_n_avx512(std::uint16_t *x, std::size_t n,
+                       float factor) noexcept {
+  return _half_unscale_n_kernel<_half_widen_avx512_f16c>(x, n, factor);
+}
+
+FLOAT16_T_TARGET_AVX2 inline bool
+_half_unscale_to_float_n_avx2(const std::uint16_t *x, std::uint32_t *dst,
+                              std::size_t n, float factor) noexcept {
+  return _half_unscale_to_float_n_kernel<_half_widen_f16c>(x, dst, n, factor);
+}
+
+FLOAT16_T_TARGET_AVX512 inline bool
+_half_unscale_to_float_n_avx512(const std::uint16_t *x, std::uint32_t *dst,
+                                std::size_t n, float factor) noexcept {
+  return _half_unscale_to_float_n_kernel<_half_widen_avx512_f16c>(x, dst, n,
+                                                                  factor);
+}
+
+inline constexpr _kernel_table<_half_all_finite_n_fn>
+  _half_all_finite_n_kernels{
+    {_half_all_finite_n_scalar, _half_all_finite_n_simd128,
+     _half_all_finite_n_avx2, _half_all_finite_n_avx512}};
+
+inline constexpr _kernel_table<_half_unscale_n_fn>
+  _half_unscale_n_kernels{
+    {_half_unscale_n_scalar, _half_unscale_n_simd128, _half_unscale_n_avx2,
+     _half_unscale_n_avx512}};
+
+inline constexpr _kernel_table<_half_unscale_to_float_n_fn>
+  _half_unscale_to_float_n_kernels{
+    {_half_unscale_to_float_n_scalar, _half_unscale_to_float_n_simd128,
+     _half_unscale_to_float_n_avx2, _half_unscale_to_float_n_avx512}};
+
+#elif FLOAT16_T_HAS_VECTOR_EXT
+
+inline constexpr _kernel_table<_half_all_finite_n_fn>
+  _half_all_finite_n_kernels{
+    {_half_all_finite_n_scalar, _half_all_finite_n_simd128,
+     _half_all_finite_n_simd128, _half_all_finite_n_simd128}};
+
+inline constexpr _kernel_table<_half_unscale_n_fn>
+  _half_unscale_n_kernels{
+    {_half_unscale_n_scalar, _half_unscale_n_simd128, _half_unscale_n_simd128,
+     _half_unscale_n_simd128}};
+
+inline constexpr _kernel_table<_half_unscale_to_float_n_fn>
+  _half_unscale_to_float_n_kernels{
+    {_half_unscale_to_float_n_scalar, _half_unscale_to_float_n_simd128,
+     _half_unscale_to_float_n_simd128, _half_unscale_to_float_n_simd128}};
+
+#else
+
+inline constexpr _kernel_table<_half_all_finite_n_fn>
+  _half_all_finite_n_kernels{
+    {_half_all_finite_n_scalar, _half_all_finite_n_scalar,
+     _half_all_finite_n_scalar, _half_all_finite_n_scalar}};
+
+inline constexpr _kernel_table<_half_unscale_n_fn>
+  _half_unscale_n_kernels{
+    {_half_unscale_n_scalar, _half_unscale_n_scalar, _half_unscale_n_scalar,
+     _half_unscale_n_scalar}};
+
+inline constexpr _kernel_table<_half_unscale_to_float_n_fn>
+  _half_unscale_to_float_n_kernels{
+    {_half_unscale_to_float_n_scalar, _half_unscale_to_float_n_scalar,
+     _half_unscale_to_float_n_scalar, _half_unscale_to_float_n_scalar}};
+
+#endif
+
+} // namespace half::half_private
+
+namespace numeric::float16_t_private {
+
+// Elements a thread checks between looks at whether another has found a
+// non-finite value.
+inline constexpr std::size_t _finite_block = 0x4000;
+
+} // namespace numeric::float16_t_private
+
+namespace numeric {
+
+// Whether no element of x is an infinity or a NaN. The SIMD kernels test
+// four vectors at a time and return at the first group holding one; across
+// threads, the others stop within float16_t_private::_finite_block elements.
+[[nodiscard]] inline bool all_finite(std::span<const float16_t> x) noexcept {
+  using float16_t_private::_finite_block;
+  const std::uint16_t *bits = reinterpret_cast<const std::uint16_t *>(x.data());
+  std::atomic<bool> finite{true};
+  half::parallel_for(x.size(), [&](std::size_t i, std::size_t end) {
+    const auto kernel =
+      half::half_private::_half_all_finite_n_kernels[half::active_backend()];
+    for (; i < end && finite.load(std::memory_order_relaxed);
+         i += _finite_block) {
+      if (!kernel(bits + i, std::min(_finite_block, end - i))) {
+        finite.store(false, std::memory_order_relaxed);
+        return;
+      }
+    }
+  });
+  return finite.load(std::memory_order_relaxed);
+}
+
+} // namespace numeric
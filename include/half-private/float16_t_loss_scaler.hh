@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "dispatch.hh"
+#include "float16_t.hpp"
+#include "float16_t_finite.hh"
+#include "parallel.hh"
+
+namespace numeric::float16_t_private {
+
+// Runs unscale(b, i, count) over elements [i, i + count) of buffer b, for
+// buffers of sizes[b] elements taken as one span of their total length, so
+// that many small buffers share chunks and threads; false if unscale
+// returned false, in which case every thread stops within _finite_block
+// elements.
+template <typename Fn_>
+[[nodiscard]] inline bool _unscale_buffers(std::span<const std::size_t> sizes,
+                                           Fn_ unscale) {
+  std::vector<std::size_t> ends(sizes.size());
+  std::size_t total = 0;
+  for (std::size_t b = 0; b < sizes.size(); ++b)
+    ends[b] = total += sizes[b];
+  std::atomic<bool> finite{true};
+  half::parallel_for(total, [&](std::size_t i, std::size_t end) {
+    std::size_t b =
+      std::size_t(std::upper_bound(ends.begin(), ends.end(), i) - ends.begin());
+    while (i < end && finite.load(std::memory_order_relaxed)) {
+      const std::size_t begin = ends[b] - sizes[b];
+      const std::size_t count = std::min({end, ends[b], i + _finite_block}) - i;
+      if (!unscale(b, i - begin, count)) {
+        finite.store(false, std::memory_order_relaxed);
+        return;
+      }
+      i += count;
+      while (b < ends.size() && ends[b] == i)
+        ++b;
+    }
+  });
+  return finite.load(std::memory_order_relaxed);
+}
+
+// In place; false if a product is not finite.
+[[nodiscard]] inline bool
+_unscale_buffers(std::span<const std::span<float16_t>> buffers, float factor) {
+  std::vector<std::size_t> sizes(buffers.size());
+  for (std::size_t b = 0; b < buffers.size(); ++b)
+    sizes[b] = buffers[b].size();
+  return _unscale_buffers(sizes, [&](std::size_t b, std::size_t i,
+                                     std::size_t count) {
+    const auto kernel =
+      half::half_private::_half_unscale_n_kernels[half::active_backend()];
+    return kernel(reinterpret_cast<std::uint16_t *>(buffers[b].data() + i),
+                  count, factor);
+  });
+}
+
+// Into dst[b], over the first min(buffers[b].size(), dst[b].size())
+// elements of the first min(buffers.size(), dst.size()) buffers.
+[[nodiscard]] inline bool
+_unscale_buffers(std::span<const std::span<const float16_t>> buffers,
+                 std::span<const std::span<float>> dst, float factor) {
+  std::vector<std::size_t> sizes(std::min(buffers.size(), dst.size()));
+  for (std::size_t b = 0; b < sizes.size(); ++b)
+    sizes[b] = std::min(buffers[b].size(), dst[b].size());
+  return _unscale_buffers(sizes, [&](std::size_t b, std::size_t i,
+                                     std::size_t count) {
+    const auto kernel = half::half_private::
+      _half_unscale_to_float_n_kernels[half::active_backend()];
+    return kernel(
+      reinterpret_cast<const std::uint16_t *>(buffers[b].data() + i),
+      reinterpret_cast<std::uint32_t *>(dst[b].data() + i), count, factor);
+  });
+}
+
+} // namespace numeric::float16_t_private
+
+namespace numeric {
+
+// Dynamic loss scaling for training with fp16 gradients: the loss is
+// multiplied by scale() before the backward pass, so that small gradients
+// do not flush to zero, and step() divides the gradients back. The scale
+// is multiplied by backoff_factor after a step whose gradients overflowed,
+// which the optimizer should then skip, and by growth_factor after
+// growth_interval finite steps in a row.
+class loss_scaler {
+public:
+  explicit loss_scaler(float scale = 0x1p16f, float growth_factor = 2.0f,
+                       float backoff_factor = 0.5f,
+                       std::size_t growth_interval = 2000) noexcept
+      : _scale(scale), _growth_factor(growth_factor),
+        _backoff_factor(backoff_factor),
+        _growth_interval(std::max<std::size_t>(1, growth_interval)) {}
+
+  [[nodiscard]] float scale() const noexcept { return _scale; }
+
+  // Finite steps since the scale last changed.
+  [[nodiscard]] std::size_t good_steps() const noexcept { return _good_steps; }
+
+  // Multiplies every gradient by 1 / scale() in place, in fp32 rounded by
+  // half::float_to_half, and returns whether all of the results are
+  // finite. The buffers go through the active executor in one pass that
+  // also checks them and stops at the first infinity or NaN, leaving the
+  // gradients partly unscaled. Results under 2^-14 in magnitude lose bits
+  // as fp16 subnormals, and those under 2^-25 flush to zero: the scale
+  // kept them, and this gives them up.
+  [[nodiscard]] bool
+  unscale(std::span<const std::span<float16_t>> gradients) const {
+    return float16_t_private::_unscale_buffers(gradients, 1.0f / _scale);
+  }
+
+  // The same into fp32 master gradients, with no rounding past the fp32
+  // product and the check made on the fp32 results: master[b][i] receives
+  // gradients[b][i] / scale(), over the shorter of each pair of buffers
+  // and of the two spans.
+  [[nodiscard]] bool
+  unscale(std::span<const std::span<const float16_t>> gradients,
+          std::span<const std::span<float>> master) const {
+    return float16_t_private::_unscale_buffers(gradients, master,
+                                               1.0f / _scale);
+  }
+
+  // Moves the scale on by one step whose gradients were finite or not. A
+  // scale that would grow to infinity stays where it is.
+  void update(bool finite) noexcept {
+    if (!finite) {
+      _scale *= _backoff_factor;
+      _good_steps = 0;
+      return;
+    }
+    if (++_good_steps < _growth_interval)
+      return;
+    if (std::isfinite(_scale * _growth_factor))
+      _scale *= _growth_factor;
+    _good_steps = 0;
+  }
+
+  // unscale, then update; whether the optimizer should apply the gradients.
+  [[nodiscard]] bool step(std::span<const std::span<float16_t>> gradients) {
+    const bool finite = unscale(gradients);
+    update(finite);
+    return finite;
+  }
+
+  [[nodiscard]] bool step(std::span<const std::span<const float16_t>> gradients,
+                          std::span<const std::span<float>> master) {
+    const bool finite = unscale(gradients, master);
+    update(finite);
+    return finite;
+  }
+
+private:
+  float _scale;
+  float _growth_factor;
+  float _backoff_factor;
+  std::size_t _growth_interval;
+  std::size_t _good_steps = 0;
+};
+
+} // namespace numeric
@@ -0,0 +1,357 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cinttypes>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "dispatch.hh"
+#include "float16_t.hpp"
+#include "fp_convert_n.hh"
+#include "parallel.hh"
+#include "simd.hh"
+
+namespace half::half_private {
+
+enum struct _reduce_op { sum, dot, sum_sq, sum_sq_dev };
+
+[[nodiscard]] inline float _reduce_widen(std::uint16_t h) noexcept {
+  const std::uint32_t f_bits = half_to_float(h);
+  float f;
+  std::memcpy(&f, &f_bits, sizeof(f));
+  return f;
+}
+
+// The term op adds for x and y; sum_sq_dev squares the deviation from shift.
+template <_reduce_op Op_>
+[[nodiscard]] inline float _reduce_term(float x, float y,
+                                       float shift) noexcept {
+  if constexpr (Op_ == _reduce_op::sum)
+    return x;
+  else if constexpr (Op_ == _reduce_op::dot)
+    return x * y;
+  else if constexpr (Op_ == _reduce_op::sum_sq)
+    return x * x;
+  else
+    return (x - shift) * (x - shift);
+}
+
+// Hides v from the optimizer where it may reassociate float arithmetic
+// (-ffast-math, -Ofast), which would fold Kahan's (t - sum) - y to zero:
+// every intermediate of the compensation goes through it.
+template <typename F_>
+FLOAT16_T_SIMD_INLINE void _reduce_opaque([[maybe_unused]] F_ &v) noexcept {
+#if defined(__ASSOCIATIVE_MATH__) || defined(__FAST_MATH__)
+#if defined(__x86_64__) || defined(__i386__)
+  __asm__("" : "+v"(v));
+#elif defined(__aarch64__)
+  __asm__("" : "+w"(v));
+#else
+  __asm__("" : "+m"(v));
+#endif
+#endif
+}
+
+// sum += term, with Kahan_ keeping the lost low bits in compensation.
+template <bool Kahan_, typename F_>
+FLOAT16_T_SIMD_INLINE void _reduce_add(F_ &sum, F_ &compensation,
+                                       const F_ &term) noexcept {
+  if constexpr (Kahan_) {
+    F_ y = term - compensation;
+    _reduce_opaque(y);
+    F_ t = sum + y;
+    _reduce_opaque(t);
+    F_ high = t - sum;
+    _reduce_opaque(high);
+    compensation = high - y;
+    sum = t;
+  } else {
+    sum += term;
+  }
+}
+
+// The sum of the terms of x[i] (and y[i], for dot) over [0, n) in fp32.
+template <_reduce_op Op_, bool Kahan_>
+inline float _reduce_n_scalar(const std::uint16_t *x, const std::uint16_t *y,
+                              std::size_t n, float shift) noexcept {
+  float sum = 0.0f;
+  float compensation = 0.0f;
+  for (std::size_t i = 0; i < n; ++i) {
+    const float y_i = Op_ == _reduce_op::dot ? _reduce_widen(y[i]) : 0.0f;
+    const float term = _reduce_term<Op_>(_reduce_widen(x[i]), y_i, shift);
+    _reduce_add<Kahan_>(sum, compensation, term);
+  }
+  return sum - compensation;
+}
+
+#if FLOAT16_T_HAS_VECTOR_EXT
+
+// Independent accumulators per kernel, so that the adds of one do not wait on
+// those of the others.
+inline constexpr std::size_t _reduce_accumulators = 4;
+
+// Widen_ loads Widen_::lanes halves as fp32 lanes.
+template <_reduce_op Op_, bool Kahan_, typename Widen_>
+FLOAT16_T_SIMD_INLINE float _reduce_n_kernel(const std::uint16_t *x,
+                                             const std::uint16_t *y,
+                                             std::size_t n,
+                                             float shift) noexcept {
+  constexpr std::size_t N_ = Widen_::lanes;
+  using vf = typename _simd<N_>::f32;
+  constexpr std::size_t step = _reduce_accumulators * N_;
+  vf sums[_reduce_accumulators] = {};
+  vf compensations[_reduce_accumulators] = {};
+  std::size_t i = 0;
+  for (; i + step <= n; i += step) {
+    for (std::size_t a = 0; a < _reduce_accumulators; ++a) {
+      vf x_f, y_f = {};
+      Widen_::load(x_f, x + i + a * N_);
+      if constexpr (Op_ == _reduce_op::dot)
+        Widen_::load(y_f, y + i + a * N_);
+      vf term;
+      if constexpr (Op_ == _reduce_op::sum)
+        term = x_f;
+      else if constexpr (Op_ == _reduce_op::dot)
+        term = x_f * y_f;
+      else if constexpr (Op_ == _reduce_op::sum_sq)
+        term = x_f * x_f;
+      else
+        term = (x_f - shift) * (x_f - shift);
+      _reduce_add<Kahan_>(sums[a], compensations[a], term);
+    }
+  }
+  for (std::size_t a = 1; a < _reduce_accumulators; ++a) {
+    _reduce_add<Kahan_>(sums[0], compensations[0], sums[a]);
+    _reduce_add<Kahan_>(sums[0], compensations[0], -compensations[a]);
+  }
+  float lanes[N_], lane_compensations[N_];
+  std::memcpy(lanes, &sums[0], sizeof(lanes));
+  std::memcpy(lane_compensations, &compensations[0],
+              sizeof(lane_compensations));
+  float sum = _reduce_n_scalar<Op_, Kahan_>(x + i, y ? y + i : y, n - i, shift);
+  float compensation = 0.0f;
+  for (std::size_t lane = 0; lane < N_; ++lane) {
+    _reduce_add<Kahan_>(sum, compensation, lanes[lane]);
+    _reduce_add<Kahan_>(sum, compensation, -lane_compensations[lane]);
+  }
+  return sum - compensation;
+}
+
+template <_reduce_op Op_, bool Kahan_>
+inline float _reduce_n_simd128(const std::uint16_t *x, const std::uint16_t *y,
+                               std::size_t n, float shift) noexcept {
+  return _reduce_n_kernel<Op_, Kahan_, _half_widen_emulated<4>>(x, y, n,
+                                                                 shift);
+}
+
+#endif // FLOAT16_T_HAS_VECTOR_EXT
+
+using _reduce_n_fn = float(const std::uint16_t *, const std::uint16_t *,
+                           std::size_t, float) noexcept;
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+
+template <_reduce_op Op_, bool Kahan_>
+FLOAT16_T_TARGET_AVX2 inline float
+_reduce_n_avx2(const std::uint16_t *x, const std::uint16_t *y, std::size_t n,
+               float shift) noexcept {
+  return _reduce_n_kernel<Op_, Kahan_, _half_widen_f16c>(x, y, n, shift);
+}
+
+template <_reduce_op Op_, bool Kahan_>
+FLOAT16_T_TARGET_AVX512 inline float
+_reduce_n_avx512(const std::uint16_t *x, const std::uint16_t *y, std::size_t n,
+                 float shift) noexcept {
+  return _reduce_n_kernel<Op_, Kahan_, _half_widen_avx512_f16c>(x, y, n,
+                                                                  shift);
+}
+
+template <_reduce_op Op_, bool Kahan_>
+inline constexpr _kernel_table<_reduce_n_fn> _reduce_n_kernels{
+  {_reduce_n_scalar<Op_, Kahan_>, _reduce_n_simd128<Op_, Kahan_>,
+   _reduce_n_avx2<Op_, Kahan_>, _reduce_n_avx512<Op_, Kahan_>}};
+
+#elif FLOAT16_T_HAS_VECTOR_EXT
+
+template <_reduce_op Op_, bool Kahan_>
+inline constexpr _kernel_table<_reduce_n_fn> _reduce_n_kernels{
+  {_reduce_n_scalar<Op_, Kahan_>, _reduce_n_simd128<Op_, Kahan_>,
+   _reduce_n_simd128<Op_, Kahan_>, _reduce_n_simd128<Op_, Kahan_>}};
+
+#else
+
+template <_reduce_op Op_, bool Kahan_>
+inline constexpr _kernel_table<_reduce_n_fn> _reduce_n_kernels{
+  {_reduce_n_scalar<Op_, Kahan_>, _reduce_n_scalar<Op_, Kahan_>,
+   _reduce_n_scalar<Op_, Kahan_>, _reduce_n_scalar<Op_, Kahan_>}};
+
+#endif
+
+} // namespace half::half_private
+
+namespace numeric {
+
+// How the reductions below add up their fp32 terms. Every kernel keeps
+// several vectors of partial sums and adds their lanes at the end.
+enum struct summation {
+  // One kernel pass over the whole span; each lane accumulates up to
+  // n / (4 * lanes) terms, so the error grows with n.
+  fast,
+  // Kernel passes over blocks of 1024 elements, whose sums are added
+  // pairwise; the error grows with log n. As fast as fast.
+  pairwise,
+  // Kahan-compensated lanes over the whole span; the error does not grow
+  // with n. Four adds per term instead of one, still bound by memory on
+  // large spans.
+  kahan,
+};
+
+} // namespace numeric
+
+namespace numeric::float16_t_private {
+
+inline constexpr std::size_t _reduce_block = 0x400;
+
+template <half::half_private::_reduce_op Op_>
+[[nodiscard]] inline float _reduce(const float16_t *x, const float16_t *y,
+                                   std::size_t n, float shift,
+                                   summation method) noexcept {
+  using half::half_private::_reduce_n_kernels;
+  const std::uint16_t *x_bits = reinterpret_cast<const std::uint16_t *>(x);
+  const std::uint16_t *y_bits = reinterpret_cast<const std::uint16_t *>(y);
+  const auto backend = half::active_backend();
+  if (method == summation::kahan)
+    return _reduce_n_kernels<Op_, true>[backend](x_bits, y_bits, n, shift);
+  const auto kernel = _reduce_n_kernels<Op_, false>[backend];
+  if (method == summation::fast)
+    return kernel(x_bits, y_bits, n, shift);
+  // The pending sums of 2^level blocks, for each set bit of blocks: adding a
+  // block carries like incrementing a binary counter.
+  float pending[64];
+  std::size_t pending_count = 0;
+  std::size_t blocks = 0;
+  for (std::size_t i = 0; i < n; i += _reduce_block, ++blocks) {
+    const std::size_t block = std::min(_reduce_block, n - i);
+    float sum = kernel(x_bits + i, y_bits ? y_bits + i : y_bits, block, shift);
+    for (std::size_t carry = blocks; carry & 1; carry >>= 1)
+      sum += pending[--pending_count];
+    pending[pending_count++] = sum;
+  }
+  float sum = 0.0f;
+  while (pending_count != 0)
+    sum += pending[--pending_count];
+  return sum;
+}
+
+// _reduce over chunks of a power of two blocks on the active executor.
+// Pairwise chunk sums carry into each other as the blocks of one pass
+// would, so the result is the serial one; fast and kahan add the chunk
+// sums in order.
+template <half::half_private::_reduce_op Op_>
+[[nodiscard]] inline float _reduce_parallel(const float16_t *x,
+                                            const float16_t *y, std::size_t n,
+                                            float shift, summation method) {
+  half::executor &e = half::active_executor();
+  const std::size_t grain = half::parallel_grain();
+  if (half::half_private::_run_serially || e.concurrency() <= 1 ||
+      n < 2 * grain)
+    return _reduce<Op_>(x, y, n, shift, method);
+  const std::size_t chunk = std::bit_ceil(std::max(
+    {_reduce_block, grain, n / (std::size_t{e.concurrency()} * 4)}));
+  const std::size_t chunks = (n + chunk - 1) / chunk;
+  std::vector<float> partial(chunks);
+  half::half_private::_on_threads(unsigned(chunks), [&](unsigned t) {
+    const std::size_t i = t * chunk;
+    partial[t] = _reduce<Op_>(x + i, y ? y + i : y, std::min(chunk, n - i),
+                              shift, method);
+  });
+  if (method != summation::pairwise) {
+    float sum = 0.0f;
+    for (const float p : partial)
+      sum += p;
+    return sum;
+  }
+  const bool short_last = n % chunk != 0;
+  float pending[64];
+  std::size_t pending_count = 0;
+  for (std::size_t t = 0; t + short_last < chunks; ++t) {
+    float sum = partial[t];
+    for (std::size_t carry = t; carry & 1; carry >>= 1)
+      sum += pending[--pending_count];
+    pending[pending_count++] = sum;
+  }
+  float sum = short_last ? partial.back() : 0.0f;
+  while (pending_count != 0)
+    sum += pending[--pending_count];
+  return sum;
+}
+
+} // namespace numeric::float16_t_private
+
+namespace numeric {
+
+// Reductions that widen to fp32 in registers and accumulate there, instead
+// of rounding to half on every step like repeated operator+=. NaNs and
+// infinities propagate as in float arithmetic. Like the bulk span
+// functions they go across the active executor's threads from two
+// parallel_grain()s: pairwise sums come out the same as on one thread,
+// while fast and kahan add up per-chunk sums.
+
+[[nodiscard]] inline float
+sum(std::span<const float16_t> x,
+    summation method = summation::pairwise) {
+  using half::half_private::_reduce_op;
+  return float16_t_private::_reduce_parallel<_reduce_op::sum>(
+    x.data(), nullptr, x.size(), 0.0f, method);
+}
+
+// Over the shorter of the two spans.
+[[nodiscard]] inline float
+dot(std::span<const float16_t> x, std::span<const float16_t> y,
+    summation method = summation::pairwise) {
+  using half::half_private::_reduce_op;
+  const std::size_t n = std::min(x.size(), y.size());
+  return float16_t_private::_reduce_parallel<_reduce_op::dot>(
+    x.data(), y.data(), n, 0.0f, method);
+}
+
+[[nodiscard]] inline float
+sum_sq(std::span<const float16_t> x,
+       summation method = summation::pairwise) {
+  using half::half_private::_reduce_op;
+  return float16_t_private::_reduce_parallel<_reduce_op::sum_sq>(
+    x.data(), nullptr, x.size(), 0.0f, method);
+}
+
+// The Euclidean norm, sqrt(sum_sq(x)).
+[[nodiscard]] inline float
+norm2(std::span<const float16_t> x,
+      summation method = summation::pairwise) {
+  return std::sqrt(sum_sq(x, method));
+}
+
+// NaN for an empty span.
+[[nodiscard]] inline float
+mean(std::span<const float16_t> x,
+     summation method = summation::pairwise) {
+  return sum(x, method) / float(x.size());
+}
+
+// The population variance, in two passes: the mean, then the squared
+// deviations from it, which does not cancel like sum_sq / n - mean^2. NaN
+// for an empty span.
+[[nodiscard]] inline float
+variance(std::span<const float16_t> x,
+         summation method = summation::pairwise) {
+  using half::half_private::_reduce_op;
+  const float x_mean = mean(x, method);
+  return float16_t_private::_reduce_parallel<_reduce_op::sum_sq_dev>(
+           x.data(), nullptr, x.size(), x_mean, method) /
+         float(x.size());
+}
+
+} // namespace numeric
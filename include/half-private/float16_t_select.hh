@@ -0,0 +1,320 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+#include "compare_n.hh"
+#include "dispatch.hh"
+#include "float16_t.hpp"
+#include "simd.hh"
+
+namespace half::half_private {
+
+// _half_order_key offset to be unsigned, with NaNs below everything else:
+// -inf is 0x0400, so 0 is only ever a NaN.
+inline constexpr std::uint16_t _select_key_nan = 0;
+
+[[nodiscard]] constexpr inline std::uint16_t
+_select_key(std::uint16_t h) noexcept {
+  const std::uint32_t key_bias = (0x00008000);
+  const std::uint32_t key = (_half_order_key(h) + key_bias);
+  const std::uint32_t is_nan_msb = _half_is_nan_msb(h);
+  const std::uint32_t c_key = _uint32_sels(is_nan_msb, _select_key_nan, key);
+  return std::uint16_t(c_key);
+}
+
+// keys[i] = _select_key(x[i]) for i in [0, n); returns the largest, or
+// _select_key_nan if n is 0.
+inline std::uint16_t _select_keys_n_scalar(const std::uint16_t *x,
+                                           std::uint16_t *keys,
+                                           std::size_t n) noexcept {
+  std::uint16_t max_key = _select_key_nan;
+  for (std::size_t i = 0; i < n; ++i) {
+    keys[i] = _select_key(x[i]);
+    max_key = std::max(max_key, keys[i]);
+  }
+  return max_key;
+}
+
+#if FLOAT16_T_HAS_VECTOR_EXT
+
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE std::uint16_t
+_select_keys_n_kernel(const std::uint16_t *x, std::uint16_t *keys,
+                      std::size_t n) noexcept {
+  using vh = typename _simd<N_>::u16;
+  const std::uint16_t key_bias = (0x8000);
+  vh max_keys = vh{} + _select_key_nan;
+  std::size_t i = 0;
+  for (; i + N_ <= n; i += N_) {
+    vh h;
+    std::memcpy(&h, x + i, sizeof(h));
+    vh order_key, total_order_key, is_nan;
+    _vec_half_order_keys<N_>(order_key, total_order_key, is_nan, h);
+    const vh key = (order_key + key_bias);
+    const vh c_key = (key & ~is_nan);
+    const vh is_c_key_gt = (vh)(c_key > max_keys);
+    max_keys = ((c_key & is_c_key_gt) | (max_keys & ~is_c_key_gt));
+    std::memcpy(keys + i, &c_key, sizeof(c_key));
+  }
+  std::uint16_t lanes[N_];
+  std::memcpy(lanes, &max_keys, sizeof(lanes));
+  std::uint16_t max_key = _select_keys_n_scalar(x + i, keys + i, n - i);
+  for (std::size_t lane = 0; lane < N_; ++lane)
+    max_key = std::max(max_key, lanes[lane]);
+  return max_key;
+}
+
+inline std::uint16_t _select_keys_n_simd128(const std::uint16_t *x,
+                                            std::uint16_t *keys,
+                                            std::size_t n) noexcept {
+  return _select_keys_n_kernel<8>(x, keys, n);
+}
+
+#endif // FLOAT16_T_HAS_VECTOR_EXT
+
+using _select_keys_n_fn = std::uint16_t(const std::uint16_t *,
+                                        std::uint16_t *, std::size_t) noexcept;
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+
+FLOAT16_T_TARGET_AVX2 inline std::uint16_t
+_select_keys_n_avx2(const std::uint16_t *x, std::uint16_t *keys,
+                    std::size_t n) noexcept {
+  return _select_keys_n_kernel<16>(x, keys, n);
+}
+
+FLOAT16_T_TARGET_AVX512 inline std::uint16_t
+_select_keys_n_avx512(const std::uint16_t *x, std::uint16_t *keys,
+                      std::size_t n) noexcept {
+  return _select_keys_n_kernel<32>(x, keys, n);
+}
+
+inline constexpr _kernel_table<_select_keys_n_fn> _select_keys_n_kernels{
+  {_select_keys_n_scalar, _select_keys_n_simd128, _select_keys_n_avx2,
+   _select_keys_n_avx512}};
+
+#elif FLOAT16_T_HAS_VECTOR_EXT
+
+inline constexpr _kernel_table<_select_keys_n_fn> _select_keys_n_kernels{
+  {_select_keys_n_scalar, _select_keys_n_simd128, _select_keys_n_simd128,
+   _select_keys_n_simd128}};
+
+#else
+
+inline constexpr _kernel_table<_select_keys_n_fn> _select_keys_n_kernels{
+  {_select_keys_n_scalar, _select_keys_n_scalar, _select_keys_n_scalar,
+   _select_keys_n_scalar}};
+
+#endif
+
+} // namespace half::half_private
+
+namespace numeric::float16_t_private {
+
+// argmax and topk turn x into keys a chunk this long at a time, in a buffer
+// on the stack (4 KiB) that stays in L1 while it is scanned.
+inline constexpr std::size_t _select_chunk = 0x800;
+
+inline constexpr std::size_t _topk_digit_count = 0x100;
+
+// topk keeps candidates in a buffer on the stack this long when k is at most
+// half of it, and otherwise counts key bytes.
+inline constexpr std::size_t _topk_candidates = 0x400;
+
+// Keeping candidates, topk skips blocks this long (two cache lines of x) on
+// their largest key.
+inline constexpr std::size_t _topk_filter_block = 0x40;
+
+// topk counts into this many histograms in turn, so that runs of equal
+// digits do not wait on each other's increments.
+inline constexpr std::size_t _topk_histograms = 4;
+
+// Each histogram has a second half for the keys that the low byte pass
+// skips, so that it counts without branching.
+using _topk_counts = std::uint32_t[_topk_histograms][2 * _topk_digit_count];
+
+// Adds the keys with the high byte hi_digit to count by their low byte, and
+// the others past _topk_digit_count; or every key by its high byte if
+// All_hi_.
+template <bool All_hi_>
+inline void _topk_count(const std::uint16_t *keys, std::size_t n,
+                        std::size_t hi_digit, _topk_counts &count) noexcept {
+  const auto add = [&](std::uint32_t *histogram, std::uint16_t key) {
+    const std::size_t hi = (key >> 8);
+    const std::size_t lo = (key & 0xff);
+    if constexpr (All_hi_)
+      ++histogram[hi];
+    else
+      ++histogram[lo | std::size_t(hi != hi_digit) << 8];
+  };
+  const std::size_t n_body = n - n % _topk_histograms;
+  for (std::size_t i = 0; i < n_body; i += _topk_histograms)
+    for (std::size_t j = 0; j < _topk_histograms; ++j)
+      add(count[j], keys[i + j]);
+  for (std::size_t i = n_body; i < n; ++i)
+    add(count[0], keys[i]);
+}
+
+// The digit at which the keys counted, from the largest digit down, reach k
+// (there must be at least k); adds the counts above it to above.
+[[nodiscard]] inline std::size_t _topk_digit(const _topk_counts &count,
+                                             std::size_t k,
+                                             std::size_t &above) noexcept {
+  std::size_t digit = _topk_digit_count;
+  std::size_t digit_count = 0;
+  do {
+    --digit;
+    above += digit_count;
+    digit_count = 0;
+    for (std::size_t j = 0; j < _topk_histograms; ++j)
+      digit_count += count[j][digit];
+  } while (above + digit_count < k);
+  return digit;
+}
+
+// Orders indices by their keys, largest first, then by index.
+struct _topk_before {
+  const std::uint16_t *bits;
+
+  [[nodiscard]] bool operator()(std::uint32_t a,
+                                std::uint32_t b) const noexcept {
+    const std::uint16_t a_key = half::half_private::_select_key(bits[a]);
+    const std::uint16_t b_key = half::half_private::_select_key(bits[b]);
+    return a_key > b_key || (a_key == b_key && a < b);
+  }
+};
+
+// topk for k <= _topk_candidates / 2: appends the indices with keys above
+// the k-th largest key so far to the candidates and, when there are 2k of
+// them, keeps the first k. The threshold soon rises so far that most blocks
+// of _topk_filter_block keys are skipped on their maximum, so this runs at
+// about the speed of the key kernel.
+inline void _topk_filter(const std::uint16_t *bits, std::size_t size,
+                         std::size_t k, std::uint32_t *indices) noexcept {
+  const auto keys_n =
+    half::half_private::_select_keys_n_kernels[half::active_backend()];
+  const _topk_before before{bits};
+  std::uint16_t keys[_topk_filter_block];
+  std::uint32_t candidates[_topk_candidates];
+  std::size_t count = 0;
+  // Later indices with the same key as the k-th rank below it, so only
+  // larger keys are taken once there are k.
+  std::int32_t threshold = -1;
+  for (std::size_t block = 0; block < size; block += _topk_filter_block) {
+    const std::size_t n = std::min(_topk_filter_block, size - block);
+    if (std::int32_t(keys_n(bits + block, keys, n)) <= threshold)
+      continue;
+    for (std::size_t i = 0; i < n; ++i) {
+      if (std::int32_t(keys[i]) <= threshold)
+        continue;
+      candidates[count++] = std::uint32_t(block + i);
+      if (count == 2 * k) {
+        std::nth_element(candidates, candidates + k - 1, candidates + count,
+                         before);
+        count = k;
+        threshold = half::half_private::_select_key(bits[candidates[k - 1]]);
+      }
+    }
+  }
+  std::partial_sort(candidates, candidates + k, candidates + count, before);
+  std::copy_n(candidates, k, indices);
+}
+
+// topk for larger k: a histogram of the high key byte finds the bin of the
+// k-th largest key, a histogram of the low byte in that bin finds the key and
+// how many of it are taken, and a last pass collects them.
+inline void _topk_histogram(const std::uint16_t *bits, std::size_t size,
+                            std::size_t k, std::uint32_t *indices) noexcept {
+  const auto keys_n =
+    half::half_private::_select_keys_n_kernels[half::active_backend()];
+  std::uint16_t keys[_select_chunk];
+  _topk_counts count = {};
+  for (std::size_t chunk = 0; chunk < size; chunk += _select_chunk) {
+    const std::size_t n = std::min(_select_chunk, size - chunk);
+    keys_n(bits + chunk, keys, n);
+    _topk_count<true>(keys, n, 0, count);
+  }
+  std::size_t above = 0;
+  const std::size_t hi = _topk_digit(count, k, above);
+  const std::uint16_t hi_key = std::uint16_t(hi << 8);
+  std::memset(count, 0, sizeof(count));
+  for (std::size_t chunk = 0; chunk < size; chunk += _select_chunk) {
+    const std::size_t n = std::min(_select_chunk, size - chunk);
+    if (keys_n(bits + chunk, keys, n) >= hi_key)
+      _topk_count<false>(keys, n, hi, count);
+  }
+  const std::size_t lo = _topk_digit(count, k, above);
+  const std::uint16_t threshold = std::uint16_t(hi_key | lo);
+  std::size_t equal_left = k - above;
+  std::size_t written = 0;
+  for (std::size_t chunk = 0; written < k; chunk += _select_chunk) {
+    const std::size_t n = std::min(_select_chunk, size - chunk);
+    if (keys_n(bits + chunk, keys, n) < threshold)
+      continue;
+    for (std::size_t i = 0; i < n && written < k; ++i) {
+      const bool is_equal = keys[i] == threshold;
+      if (keys[i] > threshold || (is_equal && equal_left != 0)) {
+        equal_left -= is_equal;
+        indices[written++] = std::uint32_t(chunk + i);
+      }
+    }
+  }
+  std::sort(indices, indices + k, _topk_before{bits});
+}
+
+} // namespace numeric::float16_t_private
+
+namespace numeric {
+
+// Index of the first largest value of x (-0 == +0), ignoring NaNs; x.size()
+// if x is empty or all NaN. Each chunk of keys is reduced with a vector max
+// and only searched when its maximum is the largest so far.
+[[nodiscard]] inline std::size_t argmax(std::span<const float16_t> x) noexcept {
+  using namespace float16_t_private;
+  using half::half_private::_select_key_nan;
+  const std::uint16_t *bits = reinterpret_cast<const std::uint16_t *>(x.data());
+  const auto keys_n =
+    half::half_private::_select_keys_n_kernels[half::active_backend()];
+  std::uint16_t keys[_select_chunk];
+  std::uint16_t max_key = _select_key_nan;
+  std::size_t max_index = x.size();
+  for (std::size_t chunk = 0; chunk < x.size(); chunk += _select_chunk) {
+    const std::size_t n = std::min(_select_chunk, x.size() - chunk);
+    const std::uint16_t chunk_max_key = keys_n(bits + chunk, keys, n);
+    if (chunk_max_key > max_key) {
+      max_key = chunk_max_key;
+      const std::uint16_t *max = std::find(keys, keys + n, max_key);
+      max_index = chunk + std::size_t(max - keys);
+    }
+  }
+  return max_index;
+}
+
+// The min(k, x.size()) largest values of x (NaNs below everything else)
+// with their indices, largest first and equal values by index; indices and
+// values must hold that many, and x.size() must fit in 32 bits. Returns how
+// many were written. Small k keep a running threshold over candidates, larger
+// k select with histograms of the key bytes; both skip the chunks whose
+// maximum is too small, and keep everything on the stack.
+inline std::size_t topk(std::span<const float16_t> x, std::size_t k,
+                        std::span<std::uint32_t> indices,
+                        std::span<float16_t> values) noexcept {
+  using namespace float16_t_private;
+  const std::uint16_t *bits = reinterpret_cast<const std::uint16_t *>(x.data());
+  k = std::min({k, x.size(), indices.size(), values.size()});
+  if (k == 0)
+    return 0;
+  if (k <= _topk_candidates / 2)
+    _topk_filter(bits, x.size(), k, indices.data());
+  else
+    _topk_histogram(bits, x.size(), k, indices.data());
+  for (std::size_t i = 0; i < k; ++i)
+    values[i] = x[indices[i]];
+  return k;
+}
+
+} // namespace numeric
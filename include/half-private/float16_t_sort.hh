@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "float16_t.hpp"
+#include "parallel.hh"
+
+namespace numeric::float16_t_private {
+
+inline constexpr std::size_t _sort_key_count = 0x10000;
+inline constexpr std::size_t _sort_digit_count = 0x100;
+
+// Shorter spans than there are keys are sorted faster by two radix passes
+// over the bytes of the key than by one counting pass over all the keys.
+inline constexpr std::size_t _sort_counting_min = 0x10000;
+
+// Below this many elements per thread the parallel sorts run serially.
+inline constexpr std::size_t _sort_parallel_min = 0x40000;
+
+// The bits of h as an unsigned key in IEEE 754 totalOrder: the sign bit is
+// flipped for positive values and every bit for negative ones.
+[[nodiscard]] constexpr inline std::uint16_t
+_sort_key(std::uint16_t h) noexcept {
+  const std::uint16_t h_s_mask = (0x8000);
+  return std::uint16_t(half::half_private::_half_total_order_key(h) ^
+                       h_s_mask);
+}
+
+[[nodiscard]] constexpr inline std::uint16_t
+_sort_key_bits(std::uint16_t key) noexcept {
+  const std::uint16_t h_s_mask = (0x8000);
+  return std::uint16_t(half::half_private::_half_total_order_key(
+                         std::uint16_t(key ^ h_s_mask)));
+}
+
+[[nodiscard]] inline std::uint16_t _bits(const float16_t *x) noexcept {
+  std::uint16_t h;
+  std::memcpy(&h, x, sizeof(h));
+  return h;
+}
+
+// Stable LSD radix sort of the keys (and their indices) over the low and
+// the high byte.
+inline void _radix_sort_keys(std::uint16_t *keys, std::uint32_t *indices,
+                             std::size_t n) {
+  std::size_t lo_count[_sort_digit_count + 1] = {};
+  std::size_t hi_count[_sort_digit_count + 1] = {};
+  for (std::size_t i = 0; i < n; ++i) {
+    ++lo_count[(keys[i] & 0xff) + 1];
+    ++hi_count[(keys[i] >> 8) + 1];
+  }
+  for (std::size_t d = 1; d < _sort_digit_count; ++d) {
+    lo_count[d] += lo_count[d - 1];
+    hi_count[d] += hi_count[d - 1];
+  }
+  std::vector<std::uint16_t> key_buffer(n);
+  std::vector<std::uint32_t> index_buffer(indices ? n : 0);
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::size_t to = lo_count[keys[i] & 0xff]++;
+    key_buffer[to] = keys[i];
+    if (indices)
+      index_buffer[to] = indices[i];
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::size_t to = hi_count[key_buffer[i] >> 8]++;
+    keys[to] = key_buffer[i];
+    if (indices)
+      indices[to] = index_buffer[i];
+  }
+}
+
+[[nodiscard]] inline unsigned _sort_threads(std::size_t n,
+                                            unsigned threads) noexcept {
+  threads = half::half_private::_threads_or_concurrency(threads);
+  const std::size_t useful = std::max<std::size_t>(1, n / _sort_parallel_min);
+  return unsigned(std::min<std::size_t>(threads, useful));
+}
+
+// Splits x into a slice per thread and counts the keys of each slice; then
+// replaces every count by the position of the slice's first element with
+// that key, so that scattering the slices in order is stable. Returns the
+// slice bounds.
+inline std::vector<std::size_t>
+_parallel_key_offsets(std::span<const float16_t> x, unsigned threads,
+                      std::vector<std::size_t> &offsets) {
+  const std::size_t n = x.size();
+  std::vector<std::size_t> bounds(threads + 1);
+  for (unsigned t = 0; t <= threads; ++t)
+    bounds[t] = n * t / threads;
+  offsets.assign(std::size_t(threads) * _sort_key_count, 0);
+  half::half_private::_on_threads(threads, [&](unsigned t) {
+    std::size_t *count = offsets.data() + t * _sort_key_count;
+    for (std::size_t i = bounds[t]; i < bounds[t + 1]; ++i)
+      ++count[_sort_key(_bits(x.data() + i))];
+  });
+  std::size_t position = 0;
+  for (std::size_t key = 0; key < _sort_key_count; ++key) {
+    for (unsigned t = 0; t < threads; ++t) {
+      std::size_t &count = offsets[t * _sort_key_count + key];
+      const std::size_t start = position;
+      position += count;
+      count = start;
+    }
+  }
+  return bounds;
+}
+
+} // namespace numeric::float16_t_private
+
+namespace numeric {
+
+// Sorts x in IEEE 754 totalOrder (-NaN, -inf, ..., -0, +0, ..., +inf, +NaN;
+// the same as operator< for the values it orders): a counting sort over the
+// 65536 keys, or for short spans two radix passes over their bytes.
+inline void sort(std::span<float16_t> x) {
+  using namespace float16_t_private;
+  const std::size_t n = x.size();
+  if (n < _sort_counting_min) {
+    std::vector<std::uint16_t> keys(n);
+    for (std::size_t i = 0; i < n; ++i)
+      keys[i] = _sort_key(_bits(x.data() + i));
+    _radix_sort_keys(keys.data(), nullptr, n);
+    for (std::size_t i = 0; i < n; ++i)
+      x[i] = float16_t{_sort_key_bits(keys[i])};
+    return;
+  }
+  std::vector<std::size_t> count(_sort_key_count);
+  for (std::size_t i = 0; i < n; ++i)
+    ++count[_sort_key(_bits(x.data() + i))];
+  std::size_t i = 0;
+  for (std::size_t key = 0; key < _sort_key_count; ++key) {
+    const float16_t value{_sort_key_bits(std::uint16_t(key))};
+    std::fill_n(x.begin() + std::ptrdiff_t(i), count[key], value);
+    i += count[key];
+  }
+}
+
+// indices[i] = the position in x of its i-th value in the order of sort(x);
+// equal values keep their order. x.size() must fit in 32 bits.
+inline void argsort(std::span<const float16_t> x,
+                    std::span<std::uint32_t> indices) {
+  using namespace float16_t_private;
+  const std::size_t n = std::min(x.size(), indices.size());
+  if (n < _sort_counting_min) {
+    std::vector<std::uint16_t> keys(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      keys[i] = _sort_key(_bits(x.data() + i));
+      indices[i] = std::uint32_t(i);
+    }
+    _radix_sort_keys(keys.data(), indices.data(), n);
+    return;
+  }
+  std::vector<std::size_t> offset(_sort_key_count);
+  for (std::size_t i = 0; i < n; ++i)
+    ++offset[_sort_key(_bits(x.data() + i))];
+  std::size_t position = 0;
+  for (std::size_t key = 0; key < _sort_key_count; ++key) {
+    const std::size_t start = position;
+    position += offset[key];
+    offset[key] = start;
+  }
+  for (std::size_t i = 0; i < n; ++i)
+    indices[offset[_sort_key(_bits(x.data() + i))]++] = std::uint32_t(i);
+}
+
+// sort and argsort in up to `threads` tasks on half::active_executor() (0:
+// one per thread it has), each taking at least 2^18 elements; shorter spans
+// are sorted on the calling thread.
+inline void parallel_sort(std::span<float16_t> x, unsigned threads = 0) {
+  using namespace float16_t_private;
+  const std::size_t n = x.size();
+  threads = _sort_threads(n, threads);
+  if (threads == 1)
+    return sort(x);
+  std::vector<std::size_t> offsets;
+  const std::vector<std::size_t> bounds = _parallel_key_offsets(
+    std::span<const float16_t>{x.data(), n}, threads, offsets);
+  // The first thread's offsets are where each key starts; every thread fills
+  // its slice of the output from the key that covers its first position.
+  const std::size_t *start = offsets.data();
+  half::half_private::_on_threads(threads, [&](unsigned t) {
+    std::size_t i = bounds[t];
+    std::size_t key = std::size_t(
+      std::upper_bound(start, start + _sort_key_count, i) - start - 1);
+    for (; i < bounds[t + 1]; ++key) {
+      const std::size_t end =
+        key + 1 < _sort_key_count ? std::min(start[key + 1], bounds[t + 1])
+                                  : bounds[t + 1];
+      const float16_t value{_sort_key_bits(std::uint16_t(key))};
+      for (; i < end; ++i)
+        x[i] = value;
+    }
+  });
+}
+
+inline void parallel_argsort(std::span<const float16_t> x,
+                             std::span<std::uint32_t> indices,
+                             unsigned threads = 0) {
+  using namespace float16_t_private;
+  const std::size_t n = std::min(x.size(), indices.size());
+  threads = _sort_threads(n, threads);
+  if (threads == 1)
+    return argsort(x, indices);
+  std::vector<std::size_t> offsets;
+  const std::vector<std::size_t> bounds =
+    _parallel_key_offsets(x.first(n), threads, offsets);
+  half::half_private::_on_threads(threads, [&](unsigned t) {
+    std::size_t *offset = offsets.data() + t * _sort_key_count;
+    for (std::size_t i = bounds[t]; i < bounds[t + 1]; ++i)
+      indices[offset[_sort_key(_bits(x.data() + i))]++] = std::uint32_t(i);
+  });
+}
+
+} // namespace numeric
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+#include "float16_t.hpp"
+#include "parallel.hh"
+
+namespace half::half_private {
+
+// In execution.hh.
+template <typename Policy_> class _policy_scope;
+
+} // namespace half::half_private
+
+namespace numeric::float16_t_private {
+
+inline constexpr std::size_t _unary_table_size = 0x10000;
+
+// Fn_ of every 16 bit pattern (128 KiB). libm is not constexpr, so the
+// tables are filled at run time.
+template <const auto &Fn_> struct _unary_table_t {
+  std::uint16_t bits[_unary_table_size];
+
+  _unary_table_t() noexcept {
+    for (std::size_t i = 0; i < _unary_table_size; ++i)
+      bits[i] = std::uint16_t(Fn_(float16_t{static_cast<std::uint16_t>(i)}));
+  }
+};
+
+// Built on first use; initialisation of the static is thread-safe.
+template <const auto &Fn_>
+[[nodiscard]] inline const std::uint16_t *_unary_table() noexcept {
+  static const _unary_table_t<Fn_> table;
+  return table.bits;
+}
+
+} // namespace numeric::float16_t_private
+
+namespace numeric::table {
+
+// Same results as Fn_, read from its table. Called with two spans it maps
+// min(src.size(), dst.size()) values, across threads for large spans (see
+// half::parallel_for); with an execution policy first as well, given
+// half-private/execution.hh, which maps it as for the bulk functions.
+template <const auto &Fn_> struct unary_function {
+  [[nodiscard]] float16_t operator()(float16_t f) const noexcept {
+    return float16_t{float16_t_private::_unary_table<Fn_>()[std::uint16_t(f)]};
+  }
+
+  void operator()(std::span<const float16_t> src,
+                  std::span<float16_t> dst) const noexcept {
+    const std::uint16_t *table = float16_t_private::_unary_table<Fn_>();
+    const std::size_t n = std::min(src.size(), dst.size());
+    half::parallel_for(dst.first(n), [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        std::uint16_t h;
+        std::memcpy(&h, src.data() + i, sizeof(h));
+        std::memcpy(dst.data() + i, table + h, sizeof(h));
+      }
+    });
+  }
+
+  template <typename Policy_>
+  void operator()(Policy_ &&, std::span<const float16_t> src,
+                  std::span<float16_t> dst) const noexcept {
+    const half::half_private::_policy_scope<Policy_> scope;
+    (*this)(src, dst);
+  }
+};
+
+inline constexpr unary_function<numeric::exp> exp{};
+inline constexpr unary_function<numeric::exp2> exp2{};
+inline constexpr unary_function<numeric::expm1> expm1{};
+inline constexpr unary_function<numeric::log> log{};
+inline constexpr unary_function<numeric::log10> log10{};
+inline constexpr unary_function<numeric::log2> log2{};
+inline constexpr unary_function<numeric::log1p> log1p{};
+inline constexpr unary_function<numeric::sqrt> sqrt{};
+inline constexpr unary_function<numeric::cbrt> cbrt{};
+inline constexpr unary_function<numeric::sin> sin{};
+inline constexpr unary_function<numeric::sinh> sinh{};
+inline constexpr unary_function<numeric::cos> cos{};
+inline constexpr unary_function<numeric::cosh> cosh{};
+inline constexpr unary_function<numeric::tan> tan{};
+inline constexpr unary_function<numeric::tanh> tanh{};
+inline constexpr unary_function<numeric::asin> asin{};
+inline constexpr unary_function<numeric::asinh> asinh{};
+inline constexpr unary_function<numeric::acos> acos{};
+inline constexpr unary_function<numeric::acosh> acosh{};
+inline constexpr unary_function<numeric::atan> atan{};
+inline constexpr unary_function<numeric::atanh> atanh{};
+inline constexpr unary_function<numeric::erf> erf{};
+inline constexpr unary_function<numeric::erfc> erfc{};
+inline constexpr unary_function<numeric::tgamma> tgamma{};
+inline constexpr unary_function<numeric::lgamma> lgamma{};
+inline constexpr unary_function<numeric::ceil> ceil{};
+inline constexpr unary_function<numeric::floor> floor{};
+inline constexpr unary_function<numeric::trunc> trunc{};
+inline constexpr unary_function<numeric::round> round{};
+inline constexpr unary_function<numeric::nearbyint> nearbyint{};
+inline constexpr unary_function<numeric::rint> rint{};
+inline constexpr unary_function<numeric::logb> logb{};
+
+#if __STDCPP_MATH_SPEC_FUNCS__ >= 201003L
+inline constexpr unary_function<numeric::comp_ellint_1> comp_ellint_1{};
+inline constexpr unary_function<numeric::comp_ellint_2> comp_ellint_2{};
+inline constexpr unary_function<numeric::expint> expint{};
+inline constexpr unary_function<numeric::riemann_zeta> riemann_zeta{};
+#endif
+
+} // namespace numeric::table
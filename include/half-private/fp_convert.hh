@@ -1,6 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <cstring>
+
 #include "helpers.hh"
+#ifdef FLOAT16_T_FLOAT_TO_HALF_TABLE
+#include "fp_convert_base_shift.hh"
+#endif
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -11,6 +17,9 @@ namespace half {
 
 [[maybe_unused, nodiscard]] constexpr inline std::uint16_t
 float_to_half(std::uint32_t f) noexcept {
+#ifdef FLOAT16_T_FLOAT_TO_HALF_TABLE
+  return half_private::_float_to_half_table(f);
+#else
   const std::uint32_t one = (0x00000001);
   const std::uint32_t f_s_mask = (0x80000000);
   const std::uint32_t f_e_mask = (0x7f800000);
@@ -22,12 +31,14 @@ float_to_half(std::uint32_t f) noexcept {
   const std::uint32_t h_e_pos = (0x0000000a);
   const std::uint32_t h_e_mask = (0x00007c00);
   const std::uint32_t h_snan_mask = (0x00007e00);
-  const std::uint32_t h_e_mask_value = (0x0000001f);
+  const std::uint32_t h_e_max_normal = (0x0000001e);
   const std::uint32_t f_h_s_pos_offset = (0x00000010);
   const std::uint32_t f_h_bias_offset = (0x00000070);
   const std::uint32_t f_h_m_pos_offset = (0x0000000d);
   const std::uint32_t h_nan_min = (0x00007c01);
   const std::uint32_t f_h_e_biased_flag = (0x0000008f);
+  const std::uint32_t f_m_denorm_sa_mask = (0x0000001f);
+  const std::uint32_t f_m_sa_bits = (0x00000005);
   const std::uint32_t f_s = (f & f_s_mask);
   const std::uint32_t f_e = (f & f_e_mask);
   const std::uint16_t h_s = (f_s >> f_h_s_pos_offset);
@@ -39,8 +50,17 @@ float_to_half(std::uint32_t f) noexcept {
   const std::uint32_t f_m_round_offset = (f_m_round_mask << one);
   const std::uint32_t f_m_rounded = (f_m + f_m_round_offset);
   const std::uint32_t f_m_denorm_sa = (one - f_e_half_bias);
-  const std::uint32_t f_m_with_hidden = (f_m_rounded | f_m_hidden_bit);
-  const std::uint32_t f_m_denorm = (f_m_with_hidden >> f_m_denorm_sa);
+  const std::uint32_t f_m_denorm_sa_mod =
+    (f_m_denorm_sa & f_m_denorm_sa_mask);
+  const std::uint32_t f_m_denorm_sa_overflow =
+    (f_m_denorm_sa >> f_m_sa_bits);
+  const std::uint32_t is_f_m_denorm_sa_overflow_msb =
+    (-f_m_denorm_sa_overflow);
+  const std::uint32_t f_m_with_hidden = (f_m_rounded + f_m_hidden_bit);
+  const std::uint32_t f_m_denorm_unclamped =
+    (f_m_with_hidden >> f_m_denorm_sa_mod);
+  const std::uint32_t f_m_denorm = half_private::_uint32_sels(
+    is_f_m_denorm_sa_overflow_msb, 0, f_m_denorm_unclamped);
   const std::uint32_t h_m_denorm = (f_m_denorm >> f_h_m_pos_offset);
   const std::uint32_t f_m_rounded_overflow = (f_m_rounded & f_m_hidden_bit);
   const std::uint32_t m_nan = (f_m >> f_h_m_pos_offset);
@@ -58,7 +78,7 @@ float_to_half(std::uint32_t f) noexcept {
   const std::uint32_t is_f_inf_msb = (is_f_e_flagged_msb & is_f_m_eqz_msb);
   const std::uint32_t is_f_nan_underflow_msb =
     (is_f_e_flagged_msb & is_h_nan_eqz_msb);
-  const std::uint32_t is_e_overflow_msb = (h_e_mask_value - f_e_half_bias);
+  const std::uint32_t is_e_overflow_msb = (h_e_max_normal - f_e_half_bias);
   const std::uint32_t is_h_inf_msb = (is_e_overflow_msb | is_f_inf_msb);
   const std::uint32_t is_f_nsnan_msb = (f_snan - f_snan_mask);
   const std::uint32_t is_m_norm_overflow_msb = (-f_m_rounded_overflow);
@@ -77,6 +97,7 @@ float_to_half(std::uint32_t f) noexcept {
     half_private::_uint32_sels(is_f_snan_msb, h_snan_mask, h_em_denorm_result);
   const std::uint32_t h_result = (h_s | h_em_snan_result);
   return std::uint16_t(h_result);
+#endif
 }
 
 constexpr inline std::uint32_t half_to_float(std::uint16_t h) noexcept {
@@ -129,6 +150,34 @@ constexpr inline std::uint32_t half_to_float(std::uint16_t h) noexcept {
 
 }
 
+namespace half::half_private {
+
+// The bulk entry points access elements through memcpy only, so callers may
+// pass the storage of any 16/32 bit trivially copyable type (fps enums).
+inline void _float_to_half_n_scalar(const std::uint32_t *src,
+                                    std::uint16_t *dst,
+                                    std::size_t n) noexcept {
+  for (std::size_t i = 0; i < n; ++i) {
+    std::uint32_t f;
+    std::memcpy(&f, src + i, sizeof(f));
+    const std::uint16_t h = float_to_half(f);
+    std::memcpy(dst + i, &h, sizeof(h));
+  }
+}
+
+inline void _half_to_float_n_scalar(const std::uint16_t *src,
+                                    std::uint32_t *dst,
+                                    std::size_t n) noexcept {
+  for (std::size_t i = 0; i < n; ++i) {
+    std::uint16_t h;
+    std::memcpy(&h, src + i, sizeof(h));
+    const std::uint32_t f = half_to_float(h);
+    std::memcpy(dst + i, &f, sizeof(f));
+  }
+}
+
+} // namespace half::half_private
+
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
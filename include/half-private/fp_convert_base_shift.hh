@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+
+namespace half::half_private {
+
+// float_to_half from tables indexed by the 9 sign and exponent bits:
+//   m = (f & m_mask[i]) | m_hidden[i]
+//   h = base[i] + ((m + ((m & 0x1000) << 1)) >> shift[i])
+// The rounding step is the one float_to_half uses (ties away from zero,
+// applied before subnormals are shifted down), and a rounding carry out of
+// the mantissa lands in the exponent field of base, so the results are the
+// same as float_to_half's for every input. m_mask keeps only the quiet bit
+// for exponent 0xff, giving 0x7c00 / 0x7e00 like float_to_half does.
+struct _float_to_half_base_shift_t {
+  std::uint32_t m_mask[512];
+  std::uint32_t m_hidden[512];
+  std::uint16_t base[512];
+  std::uint8_t shift[512];
+};
+
+[[nodiscard]] constexpr inline _float_to_half_base_shift_t
+_make_float_to_half_base_shift() noexcept {
+  const std::uint32_t f_m_mask = (0x007fffff);
+  const std::uint32_t f_m_quiet = (0x00400000);
+  const std::uint32_t f_m_hidden_bit = (0x00800000);
+  const std::uint32_t f_e_max = (0x000000ff);
+  const std::uint32_t f_h_bias_offset = (0x00000070);
+  const std::uint32_t f_h_m_pos_offset = (0x0000000d);
+  const std::uint32_t h_e_pos = (0x0000000a);
+  const std::uint32_t h_e_max_normal = (0x0000001e);
+  const std::uint32_t h_e_mask = (0x00007c00);
+  const std::uint32_t h_s_mask = (0x00008000);
+  const std::uint32_t shift_max = (0x0000001f);
+  _float_to_half_base_shift_t t{};
+  for (std::uint32_t i = 0; i < 512; ++i) {
+    const std::uint32_t f_e = (i & f_e_max);
+    const std::uint32_t h_s = (i >> 8) * h_s_mask;
+    if (f_e <= f_h_bias_offset) {
+      const std::uint32_t denorm_sa = (f_h_bias_offset + 1 - f_e);
+      const std::uint32_t sa = f_h_m_pos_offset + denorm_sa;
+      t.m_mask[i] = f_m_mask;
+      t.m_hidden[i] = f_m_hidden_bit;
+      t.base[i] = std::uint16_t(h_s);
+      t.shift[i] = std::uint8_t(sa < shift_max ? sa : shift_max);
+    } else if (f_e - f_h_bias_offset <= h_e_max_normal) {
+      t.m_mask[i] = f_m_mask;
+      t.m_hidden[i] = 0;
+      t.base[i] = std::uint16_t(h_s | ((f_e - f_h_bias_offset) << h_e_pos));
+      t.shift[i] = std::uint8_t(f_h_m_pos_offset);
+    } else {
+      t.m_mask[i] = (f_e == f_e_max) ? f_m_quiet : 0;
+      t.m_hidden[i] = 0;
+      t.base[i] = std::uint16_t(h_s | h_e_mask);
+      t.shift[i] = std::uint8_t(f_h_m_pos_offset);
+    }
+  }
+  return t;
+}
+
+inline constexpr _float_to_half_base_shift_t _float_to_half_base_shift =
+  _make_float_to_half_base_shift();
+
+[[nodiscard]] constexpr inline std::uint16_t
+_float_to_half_table(std::uint32_t f) noexcept {
+  const std::uint32_t f_se_pos = (0x00000017);
+  const std::uint32_t f_m_round_bit = (0x00001000);
+  const std::uint32_t one = (0x00000001);
+  const _float_to_half_base_shift_t &t = _float_to_half_base_shift;
+  const std::uint32_t i = (f >> f_se_pos);
+  const std::uint32_t m = ((f & t.m_mask[i]) | t.m_hidden[i]);
+  const std::uint32_t m_round_offset = ((m & f_m_round_bit) << one);
+  const std::uint32_t m_rounded = (m + m_round_offset);
+  const std::uint32_t h_result = (t.base[i] + (m_rounded >> t.shift[i]));
+  return std::uint16_t(h_result);
+}
+
+} // namespace half::half_private
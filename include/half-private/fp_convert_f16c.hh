@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+
+#include "dispatch.hh"
+#include "fp_convert.hh"
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+
+#include <immintrin.h>
+
+// F16C conversions (vcvtph2ps / vcvtps2ph).
+//
+// half -> float: the hardware agrees with half_to_float on every input except
+// signalling NaNs, which it quiets. The quiet bit is put back to the input's,
+// so these are drop-in replacements for the emulation.
+//
+// float -> half: the hardware rounds to nearest-even, float_to_half does not,
+// so results differ for
+//   - exact ties in the normal range (float_to_half rounds them away from
+//     zero, one ulp above the hardware),
+//   - subnormal results (float_to_half truncates them, up to one ulp below),
+//   - NaNs (float_to_half gives 0x7e00 for quiet NaNs and infinity for
+//     signalling ones, the hardware keeps the top payload bits and quiets).
+// They are only used where FLOAT16_T_F16C_FLOAT_TO_HALF asks for them.
+
+namespace half::half_private {
+
+[[gnu::target("f16c")]] inline std::uint32_t
+_half_to_float_f16c(std::uint16_t h) noexcept {
+  const std::uint32_t h_em_mask = (0x00007fff);
+  const std::uint32_t h_e_mask = (0x00007c00);
+  const std::uint32_t h_m_quiet = (0x00000200);
+  const std::uint32_t f_m_quiet = (0x00400000);
+  const float f = _cvtsh_ss(h);
+  std::uint32_t f_hw;
+  std::memcpy(&f_hw, &f, sizeof(f_hw));
+  const std::uint32_t h_em = (h & h_em_mask);
+  const std::uint32_t is_nan_msb = (h_e_mask - h_em);
+  const std::uint32_t is_quiet_eqz_msb = ((h & h_m_quiet) - 1);
+  const std::uint32_t is_snan_msb = (is_nan_msb & is_quiet_eqz_msb);
+  const std::uint32_t f_quiet_fix = _uint32_sels(is_snan_msb, f_m_quiet, 0);
+  const std::uint32_t f_result = (f_hw & ~f_quiet_fix);
+  return f_result;
+}
+
+[[gnu::target("f16c")]] inline std::uint16_t
+_float_to_half_f16c(std::uint32_t f) noexcept {
+  float x;
+  std::memcpy(&x, &f, sizeof(x));
+  return static_cast<std::uint16_t>(_cvtss_sh(x, _MM_FROUND_TO_NEAREST_INT));
+}
+
+[[gnu::target("f16c")]] inline void
+_float_to_half_n_f16c_scalar(const std::uint32_t *src, std::uint16_t *dst,
+                             std::size_t n) noexcept {
+  for (std::size_t i = 0; i < n; ++i) {
+    std::uint32_t f;
+    std::memcpy(&f, src + i, sizeof(f));
+    const std::uint16_t h = _float_to_half_f16c(f);
+    std::memcpy(dst + i, &h, sizeof(h));
+  }
+}
+
+FLOAT16_T_TARGET_AVX2 inline void
+_half_to_float_n_f16c(const std::uint16_t *src, std::uint32_t *dst,
+                      std::size_t n) noexcept {
+  const __m256i h_em_mask = _mm256_set1_epi32(0x00007fff);
+  const __m256i h_e_mask = _mm256_set1_epi32(0x00007c00);
+  const __m256i h_m_quiet = _mm256_set1_epi32(0x00000200);
+  const __m256i f_m_quiet = _mm256_set1_epi32(0x00400000);
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i h =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    const __m256i f_hw = _mm256_castps_si256(_mm256_cvtph_ps(h));
+    const __m256i h_wide = _mm256_cvtepu16_epi32(h);
+    const __m256i h_em = _mm256_and_si256(h_wide, h_em_mask);
+    const __m256i is_nan = _mm256_cmpgt_epi32(h_em, h_e_mask);
+    const __m256i h_quiet = _mm256_and_si256(h_wide, h_m_quiet);
+    const __m256i is_quiet = _mm256_cmpeq_epi32(h_quiet, h_m_quiet);
+    const __m256i is_snan = _mm256_andnot_si256(is_quiet, is_nan);
+    const __m256i f_quiet_fix = _mm256_and_si256(is_snan, f_m_quiet);
+    const __m256i f_result = _mm256_andnot_si256(f_quiet_fix, f_hw);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), f_result);
+  }
+  _half_to_float_n_scalar(src + i, dst + i, n - i);
+}
+
+FLOAT16_T_TARGET_AVX512 inline void
+_half_to_float_n_avx512_f16c(const std::uint16_t *src, std::uint32_t *dst,
+                             std::size_t n) noexcept {
+  const __m512i h_em_mask = _mm512_set1_epi32(0x00007fff);
+  const __m512i h_e_mask = _mm512_set1_epi32(0x00007c00);
+  const __m512i h_m_quiet = _mm512_set1_epi32(0x00000200);
+  const __m512i f_m_quiet = _mm512_set1_epi32(0x00400000);
+  // The maskz forms avoid _mm512_undefined_*, which GCC 12 reports as
+  // maybe-uninitialized in optimised builds.
+  const __mmask16 all = 0xffff;
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m256i h =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    const __m512i f_hw = _mm512_castps_si512(_mm512_maskz_cvtph_ps(all, h));
+    const __m512i h_wide = _mm512_maskz_cvtepu16_epi32(all, h);
+    const __m512i h_em = _mm512_and_si512(h_wide, h_em_mask);
+    const __mmask16 is_nan = _mm512_cmpgt_epi32_mask(h_em, h_e_mask);
+    const __mmask16 is_quiet = _mm512_test_epi32_mask(h_wide, h_m_quiet);
+    const __mmask16 is_snan = is_nan & ~is_quiet;
+    const __m512i f_result =
+      _mm512_mask_andnot_epi32(f_hw, is_snan, f_m_quiet, f_hw);
+    _mm512_storeu_si512(dst + i, f_result);
+  }
+  _half_to_float_n_scalar(src + i, dst + i, n - i);
+}
+
+FLOAT16_T_TARGET_AVX2 inline void
+_float_to_half_n_f16c(const std::uint32_t *src, std::uint16_t *dst,
+                      std::size_t n) noexcept {
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 f = _mm256_loadu_ps(reinterpret_cast<const float *>(src + i));
+    const __m128i h =
+      _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), h);
+  }
+  _float_to_half_n_f16c_scalar(src + i, dst + i, n - i);
+}
+
+FLOAT16_T_TARGET_AVX512 inline void
+_float_to_half_n_avx512_f16c(const std::uint32_t *src, std::uint16_t *dst,
+                             std::size_t n) noexcept {
+  // maskz for the reason given in _half_to_float_n_avx512_f16c.
+  const __mmask16 all = 0xffff;
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m512 f = _mm512_loadu_ps(src + i);
+    const __m256i h = _mm512_maskz_cvtps_ph(
+      all, f, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), h);
+  }
+  _float_to_half_n_f16c_scalar(src + i, dst + i, n - i);
+}
+
+// Widen policies loading 8 or 16 halves as fp32 lanes with vcvtph2ps; exact
+// like half_to_float but for the quiet bit of signalling NaNs, which float
+// arithmetic sets anyway. The loads are not always_inline: GCC only inlines
+// them once the kernel has been inlined into a function with the same target.
+struct _half_widen_f16c {
+  static constexpr std::size_t lanes = 8;
+
+  FLOAT16_T_TARGET_AVX2 static inline void
+  load(_simd<8>::f32 &f, const std::uint16_t *h) noexcept {
+    const __m256 f_hw = _mm256_cvtph_ps(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(h)));
+    std::memcpy(&f, &f_hw, sizeof(f));
+  }
+};
+
+struct _half_widen_avx512_f16c {
+  static constexpr std::size_t lanes = 16;
+
+  FLOAT16_T_TARGET_AVX512 static inline void
+  load(_simd<16>::f32 &f, const std::uint16_t *h) noexcept {
+    const __mmask16 all = 0xffff;
+    const __m512 f_hw = _mm512_maskz_cvtph_ps(
+      all, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(h)));
+    std::memcpy(&f, &f_hw, sizeof(f));
+  }
+};
+
+} // namespace half::half_private
+
+#endif // FLOAT16_T_HAS_X86_DISPATCH
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+#include "dispatch.hh"
+#include "fp_convert.hh"
+#include "fp_convert_f16c.hh"
+#include "parallel.hh"
+#include "simd.hh"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4146) // we use this as a bit trick, so no warning pz
+#endif
+
+namespace half::half_private {
+
+#if FLOAT16_T_HAS_VECTOR_EXT
+
+// Lane-wise copies of half::float_to_half and half::half_to_float. Every step
+// is the same operation as in the scalar code, so results are bit-identical.
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_vec_float_to_half(typename _simd<N_>::u32 &h_result,
+                   const typename _simd<N_>::u32 &f) noexcept {
+  using vu = typename _simd<N_>::u32;
+  using vs = typename _simd<N_>::s32;
+  const std::uint32_t one = (0x00000001);
+  const std::uint32_t f_s_mask = (0x80000000);
+  const std::uint32_t f_e_mask = (0x7f800000);
+  const std::uint32_t f_m_mask = (0x007fffff);
+  const std::uint32_t f_m_hidden_bit = (0x00800000);
+  const std::uint32_t f_m_round_bit = (0x00001000);
+  const std::uint32_t f_snan_mask = (0x7fc00000);
+  const std::uint32_t f_e_pos = (0x00000017);
+  const std::uint32_t h_e_pos = (0x0000000a);
+  const std::uint32_t h_e_mask = (0x00007c00);
+  const std::uint32_t h_snan_mask = (0x00007e00);
+  const std::uint32_t h_e_max_normal = (0x0000001e);
+  const std::uint32_t f_h_s_pos_offset = (0x00000010);
+  const std::uint32_t f_h_bias_offset = (0x00000070);
+  const std::uint32_t f_h_m_pos_offset = (0x0000000d);
+  const std::uint32_t h_nan_min = (0x00007c01);
+  const std::uint32_t f_h_e_biased_flag = (0x0000008f);
+  const std::uint32_t f_m_denorm_sa_mask = (0x0000001f);
+  const std::uint32_t f_m_sa_bits = (0x00000005);
+  const vu f_s = (f & f_s_mask);
+  const vu f_e = (f & f_e_mask);
+  const vu h_s = (f_s >> f_h_s_pos_offset);
+  const vu f_m = (f & f_m_mask);
+  const vu f_e_amount = (f_e >> f_e_pos);
+  const vu f_e_half_bias = (f_e_amount - f_h_bias_offset);
+  const vu f_snan = (f & f_snan_mask);
+  const vu f_m_round_mask = (f_m & f_m_round_bit);
+  const vu f_m_round_offset = (f_m_round_mask << one);
+  const vu f_m_rounded = (f_m + f_m_round_offset);
+  const vu f_m_denorm_sa = (one - f_e_half_bias);
+  const vu f_m_denorm_sa_mod = (f_m_denorm_sa & f_m_denorm_sa_mask);
+  const vu f_m_denorm_sa_overflow = (f_m_denorm_sa >> f_m_sa_bits);
+  const vu is_f_m_denorm_sa_overflow_msb = (-f_m_denorm_sa_overflow);
+  const vu f_m_with_hidden = (f_m_rounded + f_m_hidden_bit);
+  const vu f_m_denorm_unclamped = (f_m_with_hidden >> f_m_denorm_sa_mod);
+  const vu f_m_denorm =
+    ((vs)is_f_m_denorm_sa_overflow_msb < 0) ? vu{} : f_m_denorm_unclamped;
+  const vu h_m_denorm = (f_m_denorm >> f_h_m_pos_offset);
+  const vu f_m_rounded_overflow = (f_m_rounded & f_m_hidden_bit);
+  const vu m_nan = (f_m >> f_h_m_pos_offset);
+  const vu h_em_nan = (h_e_mask | m_nan);
+  const vu h_e_norm_overflow_offset = (f_e_half_bias + 1);
+  const vu h_e_norm_overflow = (h_e_norm_overflow_offset << h_e_pos);
+  const vu h_e_norm = (f_e_half_bias << h_e_pos);
+  const vu h_m_norm = (f_m_rounded >> f_h_m_pos_offset);
+  const vu h_em_norm = (h_e_norm | h_m_norm);
+  const vu is_h_ndenorm_msb = (f_h_bias_offset - f_e_amount);
+  const vu is_f_e_flagged_msb = (f_h_e_biased_flag - f_e_half_bias);
+  const vu is_h_denorm_msb = (~is_h_ndenorm_msb);
+  const vu is_f_m_eqz_msb = (f_m - 1);
+  const vu is_h_nan_eqz_msb = (m_nan - 1);
+  const vu is_f_inf_msb = (is_f_e_flagged_msb & is_f_m_eqz_msb);
+  const vu is_f_nan_underflow_msb = (is_f_e_flagged_msb & is_h_nan_eqz_msb);
+  const vu is_e_overflow_msb = (h_e_max_normal - f_e_half_bias);
+  const vu is_h_inf_msb = (is_e_overflow_msb | is_f_inf_msb);
+  const vu is_f_nsnan_msb = (f_snan - f_snan_mask);
+  const vu is_m_norm_overflow_msb = (-f_m_rounded_overflow);
+  const vu is_f_snan_msb = (~is_f_nsnan_msb);
+  const vu h_em_overflow_result =
+    ((vs)is_m_norm_overflow_msb < 0) ? h_e_norm_overflow : h_em_norm;
+  const vu h_em_nan_result =
+    ((vs)is_f_e_flagged_msb < 0) ? h_em_nan : h_em_overflow_result;
+  const vu h_em_nan_underflow_result =
+    ((vs)is_f_nan_underflow_msb < 0) ? vu{} + h_nan_min : h_em_nan_result;
+  const vu h_em_inf_result =
+    ((vs)is_h_inf_msb < 0) ? vu{} + h_e_mask : h_em_nan_underflow_result;
+  const vu h_em_denorm_result =
+    ((vs)is_h_denorm_msb < 0) ? h_m_denorm : h_em_inf_result;
+  const vu h_em_snan_result =
+    ((vs)is_f_snan_msb < 0) ? vu{} + h_snan_mask : h_em_denorm_result;
+  h_result = (h_s | h_em_snan_result);
+}
+
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_vec_half_to_float(typename _simd<N_>::u32 &f_result,
+                   const typename _simd<N_>::u32 &h) noexcept {
+  using vu = typename _simd<N_>::u32;
+  using vs = typename _simd<N_>::s32;
+  const std::uint32_t h_e_mask = (0x00007c00);
+  const std::uint32_t h_m_mask = (0x000003ff);
+  const std::uint32_t h_s_mask = (0x00008000);
+  const std::uint32_t h_f_s_pos_offset = (0x00000010);
+  const std::uint32_t h_f_e_pos_offset = (0x0000000d);
+  const std::uint32_t h_f_bias_offset = (0x0001c000);
+  const std::uint32_t f_e_mask = (0x7f800000);
+  const std::uint32_t f_m_mask = (0x007fffff);
+  const std::uint32_t h_f_e_denorm_bias = (0x0000007e);
+  const std::uint32_t h_f_m_denorm_sa_bias = (0x00000008);
+  const std::uint32_t f_e_pos = (0x00000017);
+  const std::uint32_t h_e_mask_minus_one = (0x00007bff);
+  const vu h_e = (h & h_e_mask);
+  const vu h_m = (h & h_m_mask);
+  const vu h_s = (h & h_s_mask);
+  const vu h_e_f_bias = (h_e + h_f_bias_offset);
+  vu h_m_nlz;
+  _vec_uint32_cntlz_small<N_>(h_m_nlz, h_m);
+  const vu f_s = (h_s << h_f_s_pos_offset);
+  const vu f_e = (h_e_f_bias << h_f_e_pos_offset);
+  const vu f_m = (h_m << h_f_e_pos_offset);
+  const vu f_em = (f_e | f_m);
+  const vu h_f_m_sa = (h_m_nlz - h_f_m_denorm_sa_bias);
+  const vu f_e_denorm_unpacked = (h_f_e_denorm_bias - h_f_m_sa);
+  const vu h_f_m = (h_m << h_f_m_sa);
+  const vu f_m_denorm = (h_f_m & f_m_mask);
+  const vu f_e_denorm = (f_e_denorm_unpacked << f_e_pos);
+  const vu f_em_denorm = (f_e_denorm | f_m_denorm);
+  const vu f_em_nan = (f_e_mask | f_m);
+  const vu is_e_eqz_msb = (h_e - 1);
+  const vu is_m_nez_msb = (-h_m);
+  const vu is_e_flagged_msb = (h_e_mask_minus_one - h_e);
+  const vu is_zero_msb = (is_e_eqz_msb & ~is_m_nez_msb);
+  const vu is_inf_msb = (is_e_flagged_msb & ~is_m_nez_msb);
+  const vu is_denorm_msb = (is_m_nez_msb & is_e_eqz_msb);
+  const vu is_nan_msb = (is_e_flagged_msb & is_m_nez_msb);
+  const vu f_zero_result = ((vs)is_zero_msb < 0) ? vu{} : f_em;
+  const vu f_denorm_result =
+    ((vs)is_denorm_msb < 0) ? f_em_denorm : f_zero_result;
+  const vu f_inf_result =
+    ((vs)is_inf_msb < 0) ? vu{} + f_e_mask : f_denorm_result;
+  const vu f_nan_result =
+    ((vs)is_nan_msb < 0) ? f_em_nan : f_inf_result;
+  f_result = (f_s | f_nan_result);
+}
+
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void _float_to_half_n_kernel(const std::uint32_t *src,
+                                                   std::uint16_t *dst,
+                                                   std::size_t n) noexcept {
+  using vu = typename _simd<N_>::u32;
+  using vh = typename _simd<N_>::u16;
+  std::size_t i = 0;
+  for (; i + N_ <= n; i += N_) {
+    vu f, h;
+    std::memcpy(&f, src + i, sizeof(f));
+    _vec_float_to_half<N_>(h, f);
+    const vh h_narrow = __builtin_convertvector(h, vh);
+    std::memcpy(dst + i, &h_narrow, sizeof(h_narrow));
+  }
+  _float_to_half_n_scalar(src + i, dst + i, n - i);
+}
+
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void _half_to_float_n_kernel(const std::uint16_t *src,
+                                                   std::uint32_t *dst,
+                                                   std::size_t n) noexcept {
+  using vu = typename _simd<N_>::u32;
+  using vh = typename _simd<N_>::u16;
+  std::size_t i = 0;
+  for (; i + N_ <= n; i += N_) {
+    vh h_narrow;
+    std::memcpy(&h_narrow, src + i, sizeof(h_narrow));
+    const vu h = __builtin_convertvector(h_narrow, vu);
+    vu f;
+    _vec_half_to_float<N_>(f, h);
+    std::memcpy(dst + i, &f, sizeof(f));
+  }
+  _half_to_float_n_scalar(src + i, dst + i, n - i);
+}
+
+// Loads N_ halves as fp32 lanes with the lane-wise half_to_float; the widen
+// policies of the fp32-accumulating kernels (see fp_convert_f16c.hh for the
+// F16C ones).
+template <std::size_t N_> struct _half_widen_emulated {
+  static constexpr std::size_t lanes = N_;
+
+  FLOAT16_T_SIMD_INLINE static void load(typename _simd<N_>::f32 &f,
+                                         const std::uint16_t *h) noexcept {
+    using vu = typename _simd<N_>::u32;
+    using vh = typename _simd<N_>::u16;
+    using vf = typename _simd<N_>::f32;
+    vh h_narrow;
+    std::memcpy(&h_narrow, h, sizeof(h_narrow));
+    const vu h_wide = __builtin_convertvector(h_narrow, vu);
+    vu f_bits;
+    _vec_half_to_float<N_>(f_bits, h_wide);
+    f = (vf)f_bits;
+  }
+};
+
+inline void _float_to_half_n_simd128(const std::uint32_t *src,
+                                     std::uint16_t *dst,
+                                     std::size_t n) noexcept {
+  _float_to_half_n_kernel<4>(src, dst, n);
+}
+
+inline void _half_to_float_n_simd128(const std::uint16_t *src,
+                                     std::uint32_t *dst,
+                                     std::size_t n) noexcept {
+  _half_to_float_n_kernel<4>(src, dst, n);
+}
+
+#endif // FLOAT16_T_HAS_VECTOR_EXT
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+
+FLOAT16_T_TARGET_AVX2 inline void
+_float_to_half_n_avx2(const std::uint32_t *src, std::uint16_t *dst,
+                      std::size_t n) noexcept {
+  _float_to_half_n_kernel<8>(src, dst, n);
+}
+
+FLOAT16_T_TARGET_AVX512 inline void
+_float_to_half_n_avx512(const std::uint32_t *src, std::uint16_t *dst,
+                        std::size_t n) noexcept {
+  _float_to_half_n_kernel<16>(src, dst, n);
+}
+
+inline constexpr _kernel_table<void(const std::uint32_t *, std::uint16_t *,
+                                    std::size_t) noexcept>
+  _float_to_half_n_kernels{{_float_to_half_n_scalar, _float_to_half_n_simd128,
+                            _float_to_half_n_avx2, _float_to_half_n_avx512}};
+
+inline constexpr _kernel_table<void(const std::uint16_t *, std::uint32_t *,
+                                    std::size_t) noexcept>
+  _half_to_float_n_kernels{{_half_to_float_n_scalar, _half_to_float_n_simd128,
+                            _half_to_float_n_f16c,
+                            _half_to_float_n_avx512_f16c}};
+
+// Round-to-nearest-even F16C conversion, see fp_convert_f16c.hh.
+inline constexpr _kernel_table<void(const std::uint32_t *, std::uint16_t *,
+                                    std::size_t) noexcept>
+  _float_to_half_n_hw_kernels{{_float_to_half_n_scalar,
+                               _float_to_half_n_simd128, _float_to_half_n_f16c,
+                               _float_to_half_n_avx512_f16c}};
+
+#elif FLOAT16_T_HAS_VECTOR_EXT
+
+inline constexpr _kernel_table<void(const std::uint32_t *, std::uint16_t *,
+                                    std::size_t) noexcept>
+  _float_to_half_n_kernels{{_float_to_half_n_scalar, _float_to_half_n_simd128,
+                            _float_to_half_n_simd128,
+                            _float_to_half_n_simd128}};
+
+inline constexpr _kernel_table<void(const std::uint16_t *, std::uint32_t *,
+                                    std::size_t) noexcept>
+  _half_to_float_n_kernels{{_half_to_float_n_scalar, _half_to_float_n_simd128,
+                            _half_to_float_n_simd128,
+                            _half_to_float_n_simd128}};
+
+#else
+
+inline constexpr _kernel_table<void(const std::uint32_t *, std::uint16_t *,
+                                    std::size_t) noexcept>
+  _float_to_half_n_kernels{{_float_to_half_n_scalar, _float_to_half_n_scalar,
+                            _float_to_half_n_scalar, _float_to_half_n_scalar}};
+
+inline constexpr _kernel_table<void(const std::uint16_t *, std::uint32_t *,
+                                    std::size_t) noexcept>
+  _half_to_float_n_kernels{{_half_to_float_n_scalar, _half_to_float_n_scalar,
+                            _half_to_float_n_scalar, _half_to_float_n_scalar}};
+
+#endif
+
+inline void _float_to_half_n(const std::uint32_t *src, std::uint16_t *dst,
+                             std::size_t n) noexcept {
+  _float_to_half_n_kernels[active_backend()](src, dst, n);
+}
+
+inline void _half_to_float_n(const std::uint16_t *src, std::uint32_t *dst,
+                             std::size_t n) noexcept {
+  _half_to_float_n_kernels[active_backend()](src, dst, n);
+}
+
+// Like _float_to_half_n, but uses F16C where the backend has it; on other
+// backends this is the emulation.
+inline void _float_to_half_n_hw(const std::uint32_t *src, std::uint16_t *dst,
+                                std::size_t n) noexcept {
+#if FLOAT16_T_HAS_X86_DISPATCH
+  _float_to_half_n_hw_kernels[active_backend()](src, dst, n);
+#else
+  _float_to_half_n(src, dst, n);
+#endif
+}
+
+} // namespace half::half_private
+
+namespace half {
+
+// Converts min(src.size(), dst.size()) values; like every bulk span
+// function, across the active executor's threads from two parallel_grain()s.
+inline void float_to_half_n(std::span<const std::uint32_t> src,
+                            std::span<std::uint16_t> dst) noexcept {
+  parallel_for(dst.first(std::min(src.size(), dst.size())),
+               [&](std::size_t i, std::size_t end) {
+                 half_private::_float_to_half_n(src.data() + i, dst.data() + i,
+                                                end - i);
+               });
+}
+
+inline void half_to_float_n(std::span<const std::uint16_t> src,
+                            std::span<std::uint32_t> dst) noexcept {
+  parallel_for(dst.first(std::min(src.size(), dst.size())),
+               [&](std::size_t i, std::size_t end) {
+                 half_private::_half_to_float_n(src.data() + i, dst.data() + i,
+                                                end - i);
+               });
+}
+
+} // namespace half
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
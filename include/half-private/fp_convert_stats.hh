@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cinttypes>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <span>
+
+#include "dispatch.hh"
+#include "fp_convert.hh"
+#include "fp_convert_n.hh"
+#include "parallel.hh"
+#include "simd.hh"
+
+namespace half {
+
+// What float_to_half_n_stats saw. min, max and absmax are over the non-NaN
+// inputs (+inf, -inf and 0 when there are none).
+struct conversion_stats {
+  // Finite inputs that rounded to +-inf.
+  std::size_t overflow = 0;
+  // Non-zero inputs that rounded to +-0.
+  std::size_t underflow = 0;
+  // Results that are subnormal halves.
+  std::size_t subnormal = 0;
+  // Infinite and NaN inputs.
+  std::size_t inf = 0;
+  std::size_t nan = 0;
+  float min = HUGE_VALF;
+  float max = -HUGE_VALF;
+  float absmax = 0.0f;
+
+  // Every result is finite: what dynamic loss scaling checks.
+  [[nodiscard]] bool finite() const noexcept {
+    return overflow == 0 && inf == 0 && nan == 0;
+  }
+};
+
+} // namespace half
+
+namespace half::half_private {
+
+inline void _merge_stats(conversion_stats &to,
+                         const conversion_stats &from) noexcept {
+  to.overflow += from.overflow;
+  to.underflow += from.underflow;
+  to.subnormal += from.subnormal;
+  to.inf += from.inf;
+  to.nan += from.nan;
+  to.min = std::min(to.min, from.min);
+  to.max = std::max(to.max, from.max);
+  to.absmax = std::max(to.absmax, from.absmax);
+}
+
+inline void _float_to_half_n_stats_scalar(const std::uint32_t *src,
+                                          std::uint16_t *dst, std::size_t n,
+                                          conversion_stats &stats) noexcept {
+  const std::uint32_t f_abs_mask = (0x7fffffff);
+  const std::uint32_t f_inf = (0x7f800000);
+  const std::uint16_t h_abs_mask = (0x7fff);
+  const std::uint16_t h_inf = (0x7c00);
+  const std::uint16_t h_normal_min = (0x0400);
+  std::uint32_t absmax = std::bit_cast<std::uint32_t>(stats.absmax);
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::uint32_t f = src[i];
+    const std::uint16_t h = float_to_half(f);
+    dst[i] = h;
+    const std::uint32_t f_abs = f & f_abs_mask;
+    const std::uint16_t h_abs = h & h_abs_mask;
+    stats.overflow += h_abs == h_inf && f_abs < f_inf;
+    stats.underflow += h_abs == 0 && f_abs != 0;
+    stats.subnormal += h_abs != 0 && h_abs < h_normal_min;
+    stats.inf += f_abs == f_inf;
+    if (f_abs > f_inf) {
+      ++stats.nan;
+      continue;
+    }
+    const float value = std::bit_cast<float>(f);
+    stats.min = value < stats.min ? value : stats.min;
+    stats.max = value > stats.max ? value : stats.max;
+    absmax = f_abs > absmax ? f_abs : absmax;
+  }
+  stats.absmax = std::bit_cast<float>(absmax);
+}
+
+#if FLOAT16_T_HAS_VECTOR_EXT
+
+// Lane counters are added up every _stats_block elements, well before they
+// could wrap.
+inline constexpr std::size_t _stats_block = 0x100000;
+
+// _float_to_half_n_kernel, counting in lanes alongside. The tests are sign
+// bits of differences, as in _vec_float_to_half: the magnitudes are below
+// 2^31. Non-NaN magnitudes order like their bits, and NaNs fail the fp32
+// compares.
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_float_to_half_n_stats_kernel(const std::uint32_t *src, std::uint16_t *dst,
+                              std::size_t n,
+                              conversion_stats &stats) noexcept {
+  using vu = typename _simd<N_>::u32;
+  using vs = typename _simd<N_>::s32;
+  using vh = typename _simd<N_>::u16;
+  using vf = typename _simd<N_>::f32;
+  const std::uint32_t one = (0x00000001);
+  const std::uint32_t msb_pos = (0x0000001f);
+  const std::uint32_t f_abs_mask = (0x7fffffff);
+  const std::uint32_t f_inf = (0x7f800000);
+  const std::uint32_t h_abs_mask = (0x00007fff);
+  const std::uint32_t h_inf = (0x00007c00);
+  const std::uint32_t h_normal_min = (0x00000400);
+  std::size_t i = 0;
+  while (i + N_ <= n) {
+    vu overflow{}, underflow{}, subnormal{}, inf{}, nan{}, absmax{};
+    vf lo = vf{} + HUGE_VALF, hi = vf{} - HUGE_VALF;
+    const std::size_t end = std::min(n, i + _stats_block);
+    for (; i + N_ <= end; i += N_) {
+      vu f, h;
+      std::memcpy(&f, src + i, sizeof(f));
+      _vec_float_to_half<N_>(h, f);
+      const vh h_narrow = __builtin_convertvector(h, vh);
+      std::memcpy(dst + i, &h_narrow, sizeof(h_narrow));
+      const vu f_abs = (f & f_abs_mask);
+      const vu h_abs = (h & h_abs_mask);
+      const vu is_f_finite_msb = (f_abs - f_inf);
+      const vu is_f_nan_msb = (f_inf - f_abs);
+      const vu is_f_inf_msb = ((f_abs ^ f_inf) - one);
+      const vu is_f_nez_msb = (-f_abs);
+      const vu is_h_inf_msb = ((h_abs ^ h_inf) - one);
+      const vu is_h_eqz_msb = (h_abs - one);
+      const vu is_h_subnormal_msb = ((-h_abs) & (h_abs - h_normal_min));
+      overflow += ((is_h_inf_msb & is_f_finite_msb) >> msb_pos);
+      underflow += ((is_h_eqz_msb & is_f_nez_msb) >> msb_pos);
+      subnormal += (is_h_subnormal_msb >> msb_pos);
+      inf += (is_f_inf_msb >> msb_pos);
+      nan += (is_f_nan_msb >> msb_pos);
+      const vu magnitude = ((vs)is_f_nan_msb < 0) ? vu{} : f_abs;
+      const vu is_greater_msb = (absmax - magnitude);
+      absmax = ((vs)is_greater_msb < 0) ? magnitude : absmax;
+      const vf value = (vf)f;
+      lo = value < lo ? value : lo;
+      hi = value > hi ? value : hi;
+    }
+    std::uint32_t absmax_bits = std::bit_cast<std::uint32_t>(stats.absmax);
+    for (std::size_t l = 0; l < N_; ++l) {
+      stats.overflow += overflow[l];
+      stats.underflow += underflow[l];
+      stats.subnormal += subnormal[l];
+      stats.inf += inf[l];
+      stats.nan += nan[l];
+      absmax_bits = std::max<std::uint32_t>(absmax_bits, absmax[l]);
+      stats.min = std::min<float>(stats.min, lo[l]);
+      stats.max = std::max<float>(stats.max, hi[l]);
+    }
+    stats.absmax = std::bit_cast<float>(absmax_bits);
+  }
+  _float_to_half_n_stats_scalar(src + i, dst + i, n - i, stats);
+}
+
+inline void _float_to_half_n_stats_simd128(const std::uint32_t *src,
+                                           std::uint16_t *dst, std::size_t n,
+                                           conversion_stats &stats) noexcept {
+  _float_to_half_n_stats_kernel<4>(src, dst, n, stats);
+}
+
+#endif // FLOAT16_T_HAS_VECTOR_EXT
+
+using _float_to_half_n_stats_fn = void(const std::uint32_t *, std::uint16_t *,
+                                       std::size_t,
+                                       conversion_stats &) noexcept;
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+
+FLOAT16_T_TARGET_AVX2 inline void
+_float_to_half_n_stats_avx2(const std::uint32_t *src, std::uint16_t *dst,
+                            std::size_t n, conversion_stats &stats) noexcept {
+  _float_to_half_n_stats_kernel<8>(src, dst, n, stats);
+}
+
+FLOAT16_T_TARGET_AVX512 inline void
+_float_to_half_n_stats_avx512(const std::uint32_t *src, std::uint16_t *dst,
+                              std::size_t n, conversion_stats &stats) noexcept {
+  _float_to_half_n_stats_kernel<16>(src, dst, n, stats);
+}
+
+inline constexpr _kernel_table<_float_to_half_n_stats_fn>
+  _float_to_half_n_stats_kernels{
+    {_float_to_half_n_stats_scalar, _float_to_half_n_stats_simd128,
+     _float_to_half_n_stats_avx2, _float_to_half_n_stats_avx512}};
+
+#elif FLOAT16_T_HAS_VECTOR_EXT
+
+inline constexpr _kernel_table<_float_to_half_n_stats_fn>
+  _float_to_half_n_stats_kernels{
+    {_float_to_half_n_stats_scalar, _float_to_half_n_stats_simd128,
+     _float_to_half_n_stats_simd128, _float_to_half_n_stats_simd128}};
+
+#else
+
+inline constexpr _kernel_table<_float_to_half_n_stats_fn>
+  _float_to_half_n_stats_kernels{
+    {_float_to_half_n_stats_scalar, _float_to_half_n_stats_scalar,
+     _float_to_half_n_stats_scalar, _float_to_half_n_stats_scalar}};
+
+#endif
+
+} // namespace half::half_private
+
+namespace half {
+
+// float_to_half_n, gathering conversion_stats in the same pass: one read of
+// src where converting and then scanning the input or output for overflow
+// and absmax would take three. The halves are float_to_half_n's.
+[[nodiscard]] inline conversion_stats
+float_to_half_n_stats(std::span<const std::uint32_t> src,
+                      std::span<std::uint16_t> dst) noexcept {
+  conversion_stats stats;
+  std::mutex mutex;
+  parallel_for(dst.first(std::min(src.size(), dst.size())),
+               [&](std::size_t i, std::size_t end) {
+                 conversion_stats chunk;
+                 half_private::_float_to_half_n_stats_kernels[active_backend()](
+                   src.data() + i, dst.data() + i, end - i, chunk);
+                 const std::lock_guard lock(mutex);
+                 half_private::_merge_stats(stats, chunk);
+               });
+  return stats;
+}
+
+} // namespace half
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+#include "dispatch.hh"
+#include "fp_convert_n.hh"
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace half::half_private {
+
+inline constexpr std::size_t _half_to_float_table_size = 0x10000;
+
+struct _half_to_float_table_t {
+  std::uint32_t bits[_half_to_float_table_size];
+
+  _half_to_float_table_t() noexcept {
+    std::uint16_t h[256];
+    for (std::size_t i = 0; i < _half_to_float_table_size; i += 256) {
+      for (std::size_t j = 0; j < 256; ++j)
+        h[j] = static_cast<std::uint16_t>(i + j);
+      _half_to_float_n(h, bits + i, 256);
+    }
+  }
+};
+
+// half_to_float of every 16 bit pattern (256 KiB), built on first use.
+[[nodiscard]] inline const std::uint32_t *_half_to_float_table() noexcept {
+  static const _half_to_float_table_t table;
+  return table.bits;
+}
+
+inline void _half_to_float_n_table_scalar(const std::uint16_t *src,
+                                          std::uint32_t *dst,
+                                          std::size_t n) noexcept {
+  const std::uint32_t *table = _half_to_float_table();
+  for (std::size_t i = 0; i < n; ++i) {
+    std::uint16_t h;
+    std::memcpy(&h, src + i, sizeof(h));
+    std::memcpy(dst + i, table + h, sizeof(std::uint32_t));
+  }
+}
+
+#if FLOAT16_T_HAS_X86_DISPATCH
+
+FLOAT16_T_TARGET_AVX2 inline void
+_half_to_float_n_table_avx2(const std::uint16_t *src, std::uint32_t *dst,
+                            std::size_t n) noexcept {
+  const int *table = reinterpret_cast<const int *>(_half_to_float_table());
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i h =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    const __m256i index = _mm256_cvtepu16_epi32(h);
+    const __m256i f = _mm256_i32gather_epi32(table, index, 4);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), f);
+  }
+  _half_to_float_n_table_scalar(src + i, dst + i, n - i);
+}
+
+FLOAT16_T_TARGET_AVX512 inline void
+_half_to_float_n_table_avx512(const std::uint16_t *src, std::uint32_t *dst,
+                              std::size_t n) noexcept {
+  const int *table = reinterpret_cast<const int *>(_half_to_float_table());
+  const __mmask16 all = 0xffff;
+  const __m512i zero = _mm512_setzero_si512();
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m256i h =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    const __m512i index = _mm512_maskz_cvtepu16_epi32(all, h);
+    const __m512i f = _mm512_mask_i32gather_epi32(zero, all, index, table, 4);
+    _mm512_storeu_si512(dst + i, f);
+  }
+  _half_to_float_n_table_scalar(src + i, dst + i, n - i);
+}
+
+inline constexpr _kernel_table<void(const std::uint16_t *, std::uint32_t *,
+                                    std::size_t) noexcept>
+  _half_to_float_n_table_kernels{
+    {_half_to_float_n_table_scalar, _half_to_float_n_table_scalar,
+     _half_to_float_n_table_avx2, _half_to_float_n_table_avx512}};
+
+#else
+
+inline constexpr _kernel_table<void(const std::uint16_t *, std::uint32_t *,
+                                    std::size_t) noexcept>
+  _half_to_float_n_table_kernels{
+    {_half_to_float_n_table_scalar, _half_to_float_n_table_scalar,
+     _half_to_float_n_table_scalar, _half_to_float_n_table_scalar}};
+
+#endif
+
+inline void _half_to_float_n_table(const std::uint16_t *src,
+                                   std::uint32_t *dst,
+                                   std::size_t n) noexcept {
+  _half_to_float_n_table_kernels[active_backend()](src, dst, n);
+}
+
+} // namespace half::half_private
+
+namespace half {
+
+// Same results as half_to_float, read from a table; not constexpr.
+[[nodiscard]] inline std::uint32_t
+half_to_float_table(std::uint16_t h) noexcept {
+  return half_private::_half_to_float_table()[h];
+}
+
+// Converts min(src.size(), dst.size()) values.
+inline void half_to_float_table_n(std::span<const std::uint16_t> src,
+                                  std::span<std::uint32_t> dst) noexcept {
+  half_private::_half_to_float_n_table(src.data(), dst.data(),
+                                       std::min(src.size(), dst.size()));
+}
+
+} // namespace half
@@ -135,5 +135,39 @@ _uint16_cntlz(std::uint16_t x) noexcept {
 #endif // NOT __GNUC__
 }
 
+// floor(sqrt(x)) for x < 2^31, one result bit per step.
+[[maybe_unused, nodiscard]] constexpr inline std::uint32_t
+_uint32_isqrt(std::uint32_t x) noexcept {
+  std::uint32_t rem = x;
+  std::uint32_t root = 0;
+  for (std::uint32_t bit = 0x40000000; bit != 0; bit >>= 2) {
+    const std::uint32_t trial = (root + bit);
+    const std::uint32_t is_rem_lt_trial_msb = (rem - trial);
+    const std::uint32_t root_half = (root >> 1);
+    rem = _uint32_sels(is_rem_lt_trial_msb, rem, rem - trial);
+    root = _uint32_sels(is_rem_lt_trial_msb, root_half, root_half + bit);
+  }
+  return root;
+}
+
+// x / y, with x % y in rem, for x / y < 2^Bits_ and y << (Bits_ - 1) below
+// 2^31: one quotient bit per step as restoring division, since vector units
+// have no integer divide.
+template <std::uint32_t Bits_>
+[[maybe_unused, nodiscard]] constexpr inline std::uint32_t
+_uint32_div_small(std::uint32_t x, std::uint32_t y,
+                  std::uint32_t &rem) noexcept {
+  std::uint32_t q = 0;
+  rem = x;
+  for (std::uint32_t bit = Bits_; bit-- != 0;) {
+    const std::uint32_t trial = (y << bit);
+    const std::uint32_t is_rem_lt_trial_msb = (rem - trial);
+    const std::uint32_t q_bit = (std::uint32_t{1} << bit);
+    rem = _uint32_sels(is_rem_lt_trial_msb, rem, rem - trial);
+    q = _uint32_sels(is_rem_lt_trial_msb, q, q | q_bit);
+  }
+  return q;
+}
+
 } // namespace half::half_private
 
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace half {
+
+// Runs the tasks of a bulk operation: run calls fn(context, i) once for
+// every i in [0, tasks), on the calling thread and any others, and returns
+// once all of them have returned. Tasks do not throw: parallel_for catches
+// what its functions throw and rethrows it after run. Implement it to put
+// the bulk functions on an application's own threads (see set_executor).
+class executor {
+public:
+  using task_fn = void(void *context, std::size_t task);
+
+  virtual ~executor() = default;
+
+  // How many threads run uses at once, the caller included.
+  [[nodiscard]] virtual unsigned concurrency() const noexcept = 0;
+
+  virtual void run(std::size_t tasks, task_fn *fn, void *context) noexcept = 0;
+};
+
+// Runs every task on the calling thread.
+class serial_executor final : public executor {
+public:
+  [[nodiscard]] unsigned concurrency() const noexcept override { return 1; }
+
+  void run(std::size_t tasks, task_fn *fn, void *context) noexcept override {
+    for (std::size_t i = 0; i < tasks; ++i)
+      fn(context, i);
+  }
+};
+
+} // namespace half
+
+namespace half::half_private {
+
+// Set on pool workers, on a caller while it runs tasks and under the seq
+// and unseq policies: parallel_for, and a run from inside a task, go serial
+// rather than wait on threads that are busy.
+inline thread_local bool _run_serially = false;
+
+class _serial_scope {
+public:
+  explicit _serial_scope(bool serial) noexcept : _saved(_run_serially) {
+    _run_serially = serial;
+  }
+  _serial_scope(const _serial_scope &) = delete;
+  _serial_scope &operator=(const _serial_scope &) = delete;
+  ~_serial_scope() { _run_serially = _saved; }
+
+private:
+  bool _saved;
+};
+
+inline constexpr std::size_t _cache_line = 64;
+
+} // namespace half::half_private
+
+namespace half {
+
+// threads - 1 persistent workers (0: one thread per core) and the caller.
+// The threads of a run take tasks in turn off a shared counter, so those
+// that finish early take over what is left instead of waiting. A run made
+// from inside a task, or while another thread's run has the pool, runs
+// serially on its own thread.
+class thread_pool final : public executor {
+public:
+  explicit thread_pool(unsigned threads = 0) {
+    if (threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    _workers.reserve(threads - 1);
+    try {
+      for (unsigned t = 1; t < threads; ++t)
+        _workers.emplace_back([this] { _work(); });
+    } catch (const std::system_error &) {
+      // Runs with the workers that did start.
+    }
+  }
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  ~thread_pool() override {
+    {
+      const std::lock_guard lock(_mutex);
+      _stop = true;
+    }
+    _wake.notify_all();
+    for (std::thread &worker : _workers)
+      worker.join();
+  }
+
+  [[nodiscard]] unsigned concurrency() const noexcept override {
+    return unsigned(_workers.size()) + 1;
+  }
+
+  void run(std::size_t tasks, task_fn *fn, void *context) noexcept override {
+    if (tasks <= 1 || _workers.empty() || half_private::_run_serially ||
+        _busy.test_and_set(std::memory_order_acquire)) {
+      for (std::size_t i = 0; i < tasks; ++i)
+        fn(context, i);
+      return;
+    }
+    {
+      const std::lock_guard lock(_mutex);
+      _fn = fn;
+      _context = context;
+      _tasks = tasks;
+      _next.store(0, std::memory_order_relaxed);
+      _active = _workers.size();
+      ++_generation;
+    }
+    _wake.notify_all();
+    {
+      const half_private::_serial_scope serial(true);
+      _drain();
+    }
+    {
+      std::unique_lock lock(_mutex);
+      _done.wait(lock, [this] { return _active == 0; });
+    }
+    _busy.clear(std::memory_order_release);
+  }
+
+private:
+  void _drain() noexcept {
+    for (std::size_t i;
+         (i = _next.fetch_add(1, std::memory_order_relaxed)) < _tasks;)
+      _fn(_context, i);
+  }
+
+  void _work() noexcept {
+    half_private::_run_serially = true;
+    std::uint64_t seen = 0;
+    for (;;) {
+      {
+        std::unique_lock lock(_mutex);
+        _wake.wait(lock, [&] { return _stop || _generation != seen; });
+        if (_stop)
+          return;
+        seen = _generation;
+      }
+      _drain();
+      const std::lock_guard lock(_mutex);
+      if (--_active == 0)
+        _done.notify_one();
+    }
+  }
+
+  std::mutex _mutex;
+  std::condition_variable _wake, _done;
+  std::vector<std::thread> _workers;
+  std::atomic_flag _busy = ATOMIC_FLAG_INIT;
+  std::atomic<std::size_t> _next{0};
+  task_fn *_fn = nullptr;
+  void *_context = nullptr;
+  std::size_t _tasks = 0;
+  std::size_t _active = 0;
+  std::uint64_t _generation = 0;
+  bool _stop = false;
+};
+
+} // namespace half
+
+namespace half::half_private {
+
+[[nodiscard]] inline std::atomic<executor *> &_executor_state() noexcept {
+  static std::atomic<executor *> state{nullptr};
+  return state;
+}
+
+[[nodiscard]] inline std::atomic<std::size_t> &_grain_state() noexcept {
+  static std::atomic<std::size_t> state{0x40000};
+  return state;
+}
+
+// The first exception thrown by the tasks of a run, which the caller
+// rethrows once run has returned: executor::run is noexcept, so it cannot
+// pass through it. Tasks that start after it are skipped.
+class _task_error {
+public:
+  template <typename Fn_> void call(Fn_ &&fn) noexcept {
+    if (_failed.load(std::memory_order_relaxed))
+      return;
+    try {
+      fn();
+    } catch (...) {
+      if (!_failed.exchange(true, std::memory_order_relaxed))
+        _error = std::current_exception();
+    }
+  }
+
+  void rethrow() const {
+    if (_error)
+      std::rethrow_exception(_error);
+  }
+
+private:
+  std::atomic<bool> _failed{false};
+  std::exception_ptr _error;
+};
+
+template <typename Fn_> struct _parallel_chunks {
+  Fn_ &fn;
+  std::size_t n, head, chunk;
+  _task_error error{};
+
+  // Chunk i ends at head + (i + 1) chunk; the first also takes the head.
+  static void run(void *context, std::size_t i) noexcept {
+    auto &c = *static_cast<_parallel_chunks *>(context);
+    const std::size_t begin = i == 0 ? 0 : c.head + i * c.chunk;
+    c.error.call(
+      [&] { c.fn(begin, std::min(c.n, c.head + (i + 1) * c.chunk)); });
+  }
+};
+
+} // namespace half::half_private
+
+namespace half {
+
+// A thread_pool of one thread per core, started on first use.
+[[nodiscard]] inline executor &default_executor() {
+  static thread_pool pool;
+  return pool;
+}
+
+// The executor the bulk functions and the parallel sorts run on.
+[[nodiscard]] inline executor &active_executor() {
+  executor *e = half_private::_executor_state().load(std::memory_order_acquire);
+  return e ? *e : default_executor();
+}
+
+// Puts the bulk functions on e, which must outlive its use; nullptr goes
+// back to default_executor(). Returns the previous executor, or nullptr.
+inline executor *set_executor(executor *e) noexcept {
+  return half_private::_executor_state().exchange(e, std::memory_order_acq_rel);
+}
+
+// The fewest elements parallel_for gives a thread by default: a bulk span
+// function runs on the calling thread below two of them, 512 Ki elements.
+[[nodiscard]] inline std::size_t parallel_grain() noexcept {
+  return half_private::_grain_state().load(std::memory_order_relaxed);
+}
+
+// Returns the previous grain; 0 counts as 1.
+inline std::size_t set_parallel_grain(std::size_t grain) noexcept {
+  return half_private::_grain_state().exchange(std::max<std::size_t>(1, grain),
+                                               std::memory_order_relaxed);
+}
+
+// Calls fn(begin, end) over chunks of [0, n) on the active executor. Chunks
+// hold at least grain elements, and boundaries are multiples of line after
+// the first head elements; under two grains, on an executor of one thread,
+// or from inside a task, fn(0, n) runs on the calling thread. The first
+// exception fn throws is rethrown once every chunk has returned, and the
+// chunks that had not started are skipped.
+template <typename Fn_>
+void parallel_for(std::size_t n, Fn_ &&fn, std::size_t grain,
+                  std::size_t line, std::size_t head = 0) {
+  grain = std::max<std::size_t>(1, grain);
+  if (n < 2 * grain || n <= head || half_private::_run_serially) {
+    fn(std::size_t{0}, n);
+    return;
+  }
+  executor &e = active_executor();
+  const unsigned threads = e.concurrency();
+  if (threads <= 1) {
+    fn(std::size_t{0}, n);
+    return;
+  }
+  // A few chunks per thread evens out threads that start late.
+  std::size_t chunk = std::max(grain, (n - head) / (std::size_t{threads} * 4));
+  chunk = (chunk + line - 1) / line * line;
+  half_private::_parallel_chunks<Fn_> chunks{fn, n, head, chunk};
+  e.run((n - head + chunk - 1) / chunk,
+        half_private::_parallel_chunks<Fn_>::run, &chunks);
+  chunks.error.rethrow();
+}
+
+template <typename Fn_>
+void parallel_for(std::size_t n, Fn_ &&fn,
+                  std::size_t grain = parallel_grain()) {
+  parallel_for(n, fn, grain, 1);
+}
+
+// Over the elements of out, with chunk boundaries on its cache lines, so
+// that no two threads write to the same line.
+template <typename Ty_, typename Fn_>
+void parallel_for(std::span<Ty_> out, Fn_ &&fn,
+                  std::size_t grain = parallel_grain()) {
+  std::size_t line = 1, head = 0;
+  if constexpr (half_private::_cache_line % sizeof(Ty_) == 0) {
+    const auto address = reinterpret_cast<std::uintptr_t>(out.data());
+    line = half_private::_cache_line / sizeof(Ty_);
+    head = (0 - address) % half_private::_cache_line / sizeof(Ty_);
+  }
+  parallel_for(out.size(), fn, grain, line, head);
+}
+
+} // namespace half
+
+namespace half::half_private {
+
+// Runs fn(t) for t in [0, tasks) on the active executor, as the parallel
+// sorts and GEMM split their work; rethrows what fn threw, as parallel_for.
+template <typename Fn_> void _on_threads(unsigned tasks, Fn_ fn) {
+  struct context_t {
+    Fn_ &fn;
+    _task_error error{};
+  } context{fn};
+  active_executor().run(
+    tasks,
+    [](void *context, std::size_t t) noexcept {
+      auto &c = *static_cast<context_t *>(context);
+      c.error.call([&] { c.fn(unsigned(t)); });
+    },
+    &context);
+  context.error.rethrow();
+}
+
+// threads, or the active executor's concurrency when it is 0.
+[[nodiscard]] inline unsigned _threads_or_concurrency(unsigned threads) {
+  return threads != 0 ? threads : active_executor().concurrency();
+}
+
+} // namespace half::half_private
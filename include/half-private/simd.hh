@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+
+#include "helpers.hh"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define FLOAT16_T_HAS_VECTOR_EXT 1
+#define FLOAT16_T_SIMD_INLINE [[gnu::always_inline]] inline
+#else
+#define FLOAT16_T_HAS_VECTOR_EXT 0
+#define FLOAT16_T_SIMD_INLINE inline
+#endif
+
+#if FLOAT16_T_HAS_VECTOR_EXT
+
+namespace half::half_private {
+
+// N lanes of 32, 16 or 8 bit integers as a GNU vector; every operator works
+// lane-wise, so the branchless scalar code maps onto them one to one. The
+// _uint32_sels(test, a, b) selects become ((vs)test < 0) ? a : b.
+template <std::size_t N_> struct _simd {
+  typedef std::uint32_t u32 __attribute__((vector_size(N_ * 4)));
+  typedef std::int32_t s32 __attribute__((vector_size(N_ * 4)));
+  typedef std::uint16_t u16 __attribute__((vector_size(N_ * 2)));
+  typedef std::int16_t s16 __attribute__((vector_size(N_ * 2)));
+  typedef std::uint8_t u8 __attribute__((vector_size(N_)));
+  typedef float f32 __attribute__((vector_size(N_ * 4)));
+
+  static constexpr std::size_t lanes = N_;
+};
+
+// Vectors are passed by reference: by value, 256/512 bit vectors in
+// signatures draw -Wpsabi notes from every translation unit that is not
+// itself compiled for AVX, even though these functions are always inlined
+// into kernels that are.
+
+// Only exact for x < 2^24: the lane is converted to float and the leading
+// zero count read back from the biased exponent.
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_vec_uint32_cntlz_small(typename _simd<N_>::u32 &result,
+                        const typename _simd<N_>::u32 &x) noexcept {
+  using vu = typename _simd<N_>::u32;
+  using vs = typename _simd<N_>::s32;
+  using vf = typename _simd<N_>::f32;
+  const std::uint32_t f_e_pos = (0x00000017);
+  const std::uint32_t f_e_bias_plus_msb = (0x0000009e);
+  const std::uint32_t nlz_zero = (0x00000020);
+  const vf x_f = __builtin_convertvector((vs)x, vf);
+  const vu x_f_bits = (vu)x_f;
+  const vu x_f_e = (x_f_bits >> f_e_pos);
+  const vu nlz = (f_e_bias_plus_msb - x_f_e);
+  const vu is_x_eqz_msb = (x - 1);
+  result = ((vs)is_x_eqz_msb < 0) ? vu{} + nlz_zero : nlz;
+}
+
+// 16 bit lanes, by binary search in place: widening to 32 bit lanes would
+// split the widest vectors in two.
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_vec_uint16_cntlz(typename _simd<N_>::u16 &result,
+                  const typename _simd<N_>::u16 &x) noexcept {
+  using vh = typename _simd<N_>::u16;
+  using vs = typename _simd<N_>::s16;
+  const std::uint16_t msb_to_lsb_sa = (0x000f);
+  const std::uint16_t top8_sa = (0x0008);
+  const std::uint16_t top4_sa = (0x000c);
+  const std::uint16_t top2_sa = (0x000e);
+  const std::uint16_t top1_sa = (0x000f);
+  const std::uint16_t step8 = (0x0008);
+  const std::uint16_t step4 = (0x0004);
+  const std::uint16_t step2 = (0x0002);
+  const std::uint16_t step1 = (0x0001);
+  const vh is_top8_eqz_msb = ((x >> top8_sa) - 1);
+  const vh x8 = ((vs)is_top8_eqz_msb < 0) ? x << step8 : x;
+  const vh nlz8 = ((vs)is_top8_eqz_msb < 0) ? vh{} + step8 : vh{};
+  const vh is_top4_eqz_msb = ((x8 >> top4_sa) - 1);
+  const vh x4 = ((vs)is_top4_eqz_msb < 0) ? x8 << step4 : x8;
+  const vh nlz4 = ((vs)is_top4_eqz_msb < 0) ? nlz8 + step4 : nlz8;
+  const vh is_top2_eqz_msb = ((x4 >> top2_sa) - 1);
+  const vh x2 = ((vs)is_top2_eqz_msb < 0) ? x4 << step2 : x4;
+  const vh nlz2 = ((vs)is_top2_eqz_msb < 0) ? nlz4 + step2 : nlz4;
+  const vh is_top1_eqz_msb = ((x2 >> top1_sa) - 1);
+  const vh x1 = ((vs)is_top1_eqz_msb < 0) ? x2 << step1 : x2;
+  const vh nlz = ((vs)is_top1_eqz_msb < 0) ? nlz2 + step1 : nlz2;
+  const vh is_x_eqz = (~x1 >> msb_to_lsb_sa);
+  result = (nlz + is_x_eqz);
+}
+
+// x << sa and x >> sa in 16 bit lanes for any sa < 32, as a shift by each
+// set bit of sa: SSE2 and AVX2 only shift 16 bit lanes by constants. sa of 16
+// or more gives 0, as in the scalar code, whose operands are promoted to int.
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_vec_uint16_shl(typename _simd<N_>::u16 &result,
+                const typename _simd<N_>::u16 &x,
+                const typename _simd<N_>::u16 &sa) noexcept {
+  using vh = typename _simd<N_>::u16;
+  using vs = typename _simd<N_>::s16;
+  const vh is_sa16_msb = (sa << 11);
+  const vh is_sa8_msb = (sa << 12);
+  const vh is_sa4_msb = (sa << 13);
+  const vh is_sa2_msb = (sa << 14);
+  const vh is_sa1_msb = (sa << 15);
+  const vh x16 = ((vs)is_sa16_msb < 0) ? vh{} : x;
+  const vh x8 = ((vs)is_sa8_msb < 0) ? x16 << 8 : x16;
+  const vh x4 = ((vs)is_sa4_msb < 0) ? x8 << 4 : x8;
+  const vh x2 = ((vs)is_sa2_msb < 0) ? x4 << 2 : x4;
+  result = ((vs)is_sa1_msb < 0) ? x2 << 1 : x2;
+}
+
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_vec_uint16_shr(typename _simd<N_>::u16 &result,
+                const typename _simd<N_>::u16 &x,
+                const typename _simd<N_>::u16 &sa) noexcept {
+  using vh = typename _simd<N_>::u16;
+  using vs = typename _simd<N_>::s16;
+  const vh is_sa16_msb = (sa << 11);
+  const vh is_sa8_msb = (sa << 12);
+  const vh is_sa4_msb = (sa << 13);
+  const vh is_sa2_msb = (sa << 14);
+  const vh is_sa1_msb = (sa << 15);
+  const vh x16 = ((vs)is_sa16_msb < 0) ? vh{} : x;
+  const vh x8 = ((vs)is_sa8_msb < 0) ? x16 >> 8 : x16;
+  const vh x4 = ((vs)is_sa4_msb < 0) ? x8 >> 4 : x8;
+  const vh x2 = ((vs)is_sa2_msb < 0) ? x4 >> 2 : x4;
+  result = ((vs)is_sa1_msb < 0) ? x2 >> 1 : x2;
+}
+
+// Any x, from the two 16 bit halves.
+template <std::size_t N_>
+FLOAT16_T_SIMD_INLINE void
+_vec_uint32_cntlz(typename _simd<N_>::u32 &result,
+                  const typename _simd<N_>::u32 &x) noexcept {
+  using vu = typename _simd<N_>::u32;
+  using vs = typename _simd<N_>::s32;
+  const std::uint32_t half_pos = (0x00000010);
+  const std::uint32_t lo_mask = (0x0000ffff);
+  const vu x_hi = (x >> half_pos);
+  const vu x_lo = (x & lo_mask);
+  vu hi_nlz, lo_nlz;
+  _vec_uint32_cntlz_small<N_>(hi_nlz, x_hi);
+  _vec_uint32_cntlz_small<N_>(lo_nlz, x_lo);
+  const vu hi_nlz_in_x = (hi_nlz - half_pos);
+  const vu is_hi_eqz_msb = (x_hi - 1);
+  result = ((vs)is_hi_eqz_msb < 0) ? lo_nlz : hi_nlz_in_x;
+}
+
+} // namespace half::half_private
+
+#endif // FLOAT16_T_HAS_VECTOR_EXT
@@ -0,0 +1,7 @@
+#include <bit>
+#include <cstdint>
+
+static_assert(sizeof(_Float16) == 2);
+static_assert(std::bit_cast<std::uint16_t>(static_cast<_Float16>(1.0f) +
+                                           static_cast<_Float16>(1.0f)) ==
+              0x4000);
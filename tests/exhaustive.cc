@@ -0,0 +1,165 @@
+// Checks over all 2^32 floats; built optimised and run as its own test.
+// half::float_to_half is the reference here, so always the emulation.
+#undef FLOAT16_T_FLOAT_TO_HALF_TABLE
+#include "half-private/float16_t.hpp"
+#include "half-private/fp_convert.hh"
+#include "half-private/fp_convert_base_shift.hh"
+#include "catch_amalgamated.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cinttypes>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Calls fn(u) for every 32 bit u on all cores and returns the first u for
+// which it is false (0 and ok = true if there is none).
+template <typename Fn_>
+std::uint32_t first_failure(bool &ok, Fn_ fn) {
+  const std::uint64_t chunk = 1u << 20;
+  const std::uint64_t chunks = (std::uint64_t{1} << 32) / chunk;
+  std::atomic<std::uint64_t> next{0};
+  std::atomic<std::uint64_t> failure{~std::uint64_t{0}};
+  auto worker = [&] {
+    for (std::uint64_t c; (c = next.fetch_add(1)) < chunks;) {
+      for (std::uint64_t u = c * chunk; u < (c + 1) * chunk; ++u) {
+        if (fn(static_cast<std::uint32_t>(u)))
+          continue;
+        std::uint64_t seen = failure.load();
+        while (u < seen && !failure.compare_exchange_weak(seen, u)) {
+        }
+        break;
+      }
+    }
+  };
+  std::vector<std::thread> threads(
+    std::max(1u, std::thread::hardware_concurrency()));
+  for (auto &t : threads)
+    t = std::thread(worker);
+  for (auto &t : threads)
+    t.join();
+  ok = failure.load() == ~std::uint64_t{0};
+  return ok ? 0 : static_cast<std::uint32_t>(failure.load());
+}
+
+// Reference float -> half rounding to nearest even; NaNs give 0x7e00.
+std::uint16_t float_to_half_rne(float f) {
+  const std::uint32_t u = std::bit_cast<std::uint32_t>(f);
+  const std::uint32_t s = (u >> 16) & 0x8000;
+  const std::uint32_t a = u & 0x7fffffff;
+  if (a > 0x7f800000)
+    return 0x7e00;
+  if (a >= 0x477ff000) // 65520
+    return static_cast<std::uint16_t>(s | 0x7c00);
+  if (a < 0x38800000) { // below 2^-14, result is subnormal or 0x0400
+    const float m = std::nearbyint(std::fabs(f) * 0x1p24f);
+    return static_cast<std::uint16_t>(s | static_cast<std::uint32_t>(m));
+  }
+  const std::uint32_t rem = a & 0x1fff;
+  std::uint32_t h = ((a >> 23) - 112) << 10 | ((a >> 13) & 0x3ff);
+  h += (rem > 0x1000) || (rem == 0x1000 && (h & 1));
+  return static_cast<std::uint16_t>(s | h);
+}
+
+float half_value(std::uint16_t h) {
+  return std::bit_cast<float>(half::half_to_float(h));
+}
+
+// Reference double -> half rounding to nearest even, for finite d.
+std::uint16_t double_to_half_rne(double d) {
+  const std::uint32_t s = std::signbit(d) ? 0x8000 : 0;
+  const double a = std::fabs(d);
+  if (a >= 65520.0)
+    return static_cast<std::uint16_t>(s | 0x7c00);
+  if (a == 0.0)
+    return static_cast<std::uint16_t>(s);
+  const int e = std::max(std::ilogb(a), -14);
+  const double m = std::nearbyint(std::ldexp(a, 10 - e));
+  // m is in [1024, 2048] for normals and below 1024 for subnormals, where
+  // e + 14 is 0; a carry to 2048 moves into the exponent.
+  const std::uint32_t h = ((e + 14) << 10) + static_cast<std::uint32_t>(m);
+  return static_cast<std::uint16_t>(s | h);
+}
+
+// Reference fma: x * y is exact in double, the sum is rounded to odd there
+// (error from two-sum) and then to nearest even in half, which is a single
+// rounding since double has more than 11 + 2 bits.
+std::uint16_t fma_reference(std::uint16_t x, std::uint16_t y,
+                            std::uint16_t z) {
+  const double p = double(half_value(x)) * double(half_value(y));
+  const double c = half_value(z);
+  const double s = p + c;
+  if (std::isnan(s))
+    return 0x7e00;
+  if (std::isinf(s))
+    return std::signbit(s) ? 0xfc00 : 0x7c00;
+  const double b = s - p;
+  const double err = (p - (s - b)) + (c - b);
+  double odd = s;
+  if (err != 0.0 && (std::bit_cast<std::uint64_t>(s) & 1) == 0)
+    odd = std::nextafter(s, err > 0.0 ? HUGE_VAL : -HUGE_VAL);
+  return double_to_half_rne(odd);
+}
+
+} // namespace
+
+TEST_CASE("f2h_base_shift", "[f2h_base_shift]") {
+  bool ok = false;
+  const std::uint32_t u = first_failure(ok, [](std::uint32_t f) {
+    return half::half_private::_float_to_half_table(f) ==
+           half::float_to_half(f);
+  });
+  INFO("first mismatch at 0x" << std::hex << u);
+  REQUIRE(ok);
+}
+
+// float has more than 2 * 11 + 2 significant bits, so float division and
+// square root rounded to half are correctly rounded half results.
+TEST_CASE("half_div", "[half_div]") {
+  static_assert(half::half_div(0x3c00, 0x4000) == 0x3800); // 1 / 2
+  static_assert(half::half_div(0x4200, 0x4000) == 0x3e00); // 3 / 2
+  std::vector<float> value(65536);
+  for (std::uint32_t i = 0; i < 65536; ++i)
+    value[i] = half_value(static_cast<std::uint16_t>(i));
+  bool ok = false;
+  const std::uint32_t u = first_failure(ok, [&](std::uint32_t xy) {
+    const std::uint16_t x = static_cast<std::uint16_t>(xy >> 16);
+    const std::uint16_t y = static_cast<std::uint16_t>(xy);
+    return half::half_div(x, y) == float_to_half_rne(value[x] / value[y]);
+  });
+  INFO("first mismatch at 0x" << std::hex << u);
+  REQUIRE(ok);
+}
+
+TEST_CASE("half_sqrt", "[half_sqrt]") {
+  static_assert(half::half_sqrt(0x4400) == 0x4000); // sqrt(4)
+  for (std::uint32_t i = 0; i < 65536; ++i) {
+    const std::uint16_t x = static_cast<std::uint16_t>(i);
+    INFO("x = 0x" << std::hex << i);
+    REQUIRE(half::half_sqrt(x) == float_to_half_rne(std::sqrt(half_value(x))));
+  }
+}
+
+// A pseudo-random quarter of the x, y pairs (all of them take too long for
+// the test timeout), with z either pseudo-random or close to -(x * y) so
+// that the sum cancels.
+TEST_CASE("half_fma", "[half_fma]") {
+  bool ok = false;
+  const std::uint32_t u = first_failure(ok, [](std::uint32_t xy) {
+    const std::uint32_t mix = xy * 2654435761u;
+    if (mix >> 30)
+      return true;
+    const std::uint16_t x = static_cast<std::uint16_t>(xy >> 16);
+    const std::uint16_t y = static_cast<std::uint16_t>(xy);
+    const std::uint16_t p = float_to_half_rne(half_value(x) * half_value(y));
+    const std::uint16_t z = (xy & 1) ? static_cast<std::uint16_t>(mix >> 14)
+                                     : static_cast<std::uint16_t>(
+                                         (p ^ 0x8000) + ((mix >> 27) & 7) - 3);
+    return half::half_fma(x, y, z) == fma_reference(x, y, z);
+  });
+  INFO("first mismatch at 0x" << std::hex << u);
+  REQUIRE(ok);
+}
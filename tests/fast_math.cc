@@ -0,0 +1,24 @@
+// Built with -Ofast, as in the README's compile line: the reductions must
+// keep their guarantees when the compiler may reassociate float arithmetic.
+#define CATCH_CONFIG_MAIN
+#include "half-private/float16_t_reduce.hh"
+#include "catch_amalgamated.hpp"
+#include <vector>
+
+TEST_CASE("kahan under fast math", "[reduce]") {
+  using numeric::float16_t;
+  using numeric::summation;
+  // 2^25, then 2^18 terms of 2^-8 that fp32 lanes of 2^19 and more drop.
+  std::vector<float16_t> x(1024, float16_t{32768.0f});
+  x.resize(x.size() + (std::size_t{1} << 18), float16_t{0x1p-8f});
+  std::vector<float16_t> ones(x.size(), float16_t{1.0f});
+  const float exact = 0x1p25f + 1024.0f;
+  const auto initial = half::active_backend();
+  for (int b = 0; b <= int(half::supported_backend()); ++b) {
+    half::set_backend(static_cast<half::backend>(b));
+    REQUIRE(numeric::sum(x, summation::kahan) == exact);
+    REQUIRE(numeric::dot(x, ones, summation::kahan) == exact);
+    REQUIRE(numeric::sum(x, summation::fast) < exact);
+  }
+  half::set_backend(initial);
+}
@@ -1,11 +1,75 @@
 #define CATCH_CONFIG_MAIN // This tells Catch to provide a main() - only do this
                           // in one cpp file
 #include "half-private/float16_t.hpp"
+#include "fps/aligned_buffer.hh"
+#include "fps/arena.hh"
+#include "fps/execution.hh"
+#include "fps/fp16_storage_t.hh"
+#include "fps/gemm.hh"
+#include "fps/gemv.hh"
+#include "fps/stream_converter.hh"
+#include "fps/tensor_file.hh"
+#include "half-private/arith_n.hh"
+#include "half-private/compare_n.hh"
+#include "half-private/float16_t_finite.hh"
+#include "half-private/float16_t_loss_scaler.hh"
+#include "half-private/float16_t_sort.hh"
+#include "half-private/float16_t_select.hh"
+#include "half-private/float16_t_reduce.hh"
+#include "half-private/float16_t_table.hh"
+#include "half-private/fp_convert_stats.hh"
+#include "half-private/fp_convert_table.hh"
 #include "catch_amalgamated.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <bitset>
 #include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// The tests' pseudo-random numbers: a 32 bit linear congruential generator
+// (the Numerical Recipes constants).
+struct lcg {
+  std::uint32_t state;
+
+  std::uint32_t operator()() noexcept {
+    return state = state * 1664525u + 1013904223u;
+  }
+
+  // In [-1, 1), from the top 24 bits.
+  float uniform() noexcept { return float((*this)() >> 8) * 0x1p-23f - 1.0f; }
+};
+
+fps::fp16_storage_t half_of(float f) {
+  return fps::convert_f2h(std::bit_cast<fps::fp32_storage_t>(f));
+}
+
+float float_of(fps::fp16_storage_t h) {
+  return std::bit_cast<float>(fps::convert_h2f(h));
+}
+
+// How far got is from expected beyond tolerance; a NaN counts as infinitely
+// far.
+double excess(double got, double expected, double tolerance) {
+  const double error = std::abs(got - expected) - tolerance;
+  return std::isnan(error) ? HUGE_VAL : error;
+}
+
+} // namespace
 
 void print(float x) {
   using numeric::float16_t_private::float16_to_float32;
@@ -188,3 +252,1535 @@ TEST_CASE("constant2", "[constant2]") {
               << std::numeric_limits<float16_t>::max() << '\n';
   }
 }
+
+TEST_CASE("bulk_f2h", "[bulk_f2h]") {
+  std::vector<std::uint32_t> src;
+  for (std::uint32_t e = 0; e < 256; ++e)
+    for (std::uint32_t m : {0x0u, 0x1u, 0xfffu, 0x1000u, 0x1001u, 0x2000u,
+                            0x3000u, 0x400000u, 0x7fe000u, 0x7ff000u,
+                            0x7fffffu})
+      for (std::uint32_t s : {0x0u, 0x80000000u})
+        src.push_back(s | (e << 23) | m);
+  lcg rng{12345};
+  for (int i = 0; i < 100000; ++i)
+    src.push_back(rng());
+
+  // odd sizes exercise the scalar tail
+  for (std::size_t n : {std::size_t{0}, std::size_t{1}, std::size_t{7},
+                        std::size_t{17}, src.size()}) {
+    std::vector<std::uint16_t> dst(n);
+    half::float_to_half_n(std::span{src}.first(n), dst);
+    for (std::size_t i = 0; i < n; ++i)
+      REQUIRE(dst[i] == half::float_to_half(src[i]));
+  }
+}
+
+TEST_CASE("bulk_h2f", "[bulk_h2f]") {
+  std::vector<std::uint16_t> src(65536 + 3);
+  for (std::size_t i = 0; i < src.size(); ++i)
+    src[i] = static_cast<std::uint16_t>(i);
+  std::vector<std::uint32_t> dst(src.size());
+  half::half_to_float_n(src, dst);
+  for (std::size_t i = 0; i < src.size(); ++i)
+    REQUIRE(dst[i] == half::half_to_float(src[i]));
+}
+
+TEST_CASE("bulk_fps", "[bulk_fps]") {
+  using namespace fps;
+  std::vector<fp16_storage_t> h(1000);
+  for (std::size_t i = 0; i < h.size(); ++i)
+    h[i] = from_underlying<fp16_storage_t>(static_cast<std::uint16_t>(i * 61));
+  std::vector<fp32_storage_t> f(h.size());
+  convert_h2f(h, f);
+  std::vector<fp16_storage_t> back(h.size());
+  convert_f2h(f, back);
+  for (std::size_t i = 0; i < h.size(); ++i) {
+    REQUIRE(f[i] == convert_h2f(h[i]));
+    REQUIRE(back[i] == convert_f2h(f[i]));
+  }
+}
+
+TEST_CASE("dispatch", "[dispatch]") {
+  const auto initial = half::active_backend();
+  std::cout << "backend: " << half::backend_name(initial) << " (supported "
+            << half::backend_name(half::supported_backend()) << ")"
+            << std::endl;
+  REQUIRE(initial <= half::supported_backend());
+
+  std::vector<std::uint32_t> f(65536 + 5);
+  lcg rng{777};
+  for (auto &v : f)
+    v = rng();
+  std::vector<std::uint16_t> h(f.size());
+  for (std::size_t i = 0; i < h.size(); ++i)
+    h[i] = static_cast<std::uint16_t>(i);
+
+  for (int i = 0; i < half::backend_count; ++i) {
+    const auto b = half::set_backend(static_cast<half::backend>(i));
+    REQUIRE(b <= half::supported_backend());
+    std::vector<std::uint16_t> h_out(f.size());
+    std::vector<std::uint32_t> f_out(h.size());
+    half::float_to_half_n(f, h_out);
+    half::half_to_float_n(h, f_out);
+    for (std::size_t j = 0; j < f.size(); ++j) {
+      REQUIRE(h_out[j] == half::float_to_half(f[j]));
+      REQUIRE(f_out[j] == half::half_to_float(h[j]));
+    }
+  }
+  half::set_backend(initial);
+}
+
+TEST_CASE("f16c", "[f16c]") {
+  REQUIRE(half::float_to_half(0x47800100u) == 0x7c00); // 65536.5f
+  REQUIRE(half::float_to_half(0x47c35000u) == 0x7c00); // 100000.f
+  REQUIRE(half::float_to_half(0x387ff602u) == 0x0400); // rounds to min normal
+#if FLOAT16_T_HAS_X86_DISPATCH
+  if (half::supported_backend() < half::backend::avx2)
+    return;
+  using half::half_private::_float_to_half_f16c;
+  using half::half_private::_half_to_float_f16c;
+
+  std::vector<std::uint16_t> h(65536);
+  for (std::size_t i = 0; i < h.size(); ++i) {
+    h[i] = static_cast<std::uint16_t>(i);
+    REQUIRE(_half_to_float_f16c(h[i]) == half::half_to_float(h[i]));
+  }
+  std::vector<std::uint32_t> f_hw(h.size());
+  half::half_private::_half_to_float_n_f16c(h.data(), f_hw.data(), h.size());
+  for (std::size_t i = 0; i < h.size(); ++i)
+    REQUIRE(f_hw[i] == half::half_to_float(h[i]));
+
+  // float -> half only differs in the ways fp_convert_f16c.hh lists
+  std::vector<std::uint32_t> f;
+  for (std::uint64_t u = 0; u < 0x100000000u; u += 4099)
+    f.push_back(static_cast<std::uint32_t>(u));
+  for (std::uint32_t e = 100; e < 145; ++e)
+    for (std::uint32_t m : {0x0u, 0x1000u, 0x3000u, 0x7ff000u, 0x7fffffu})
+      f.push_back((e << 23) | m);
+  for (std::uint32_t v : f) {
+    const std::uint16_t sw = half::float_to_half(v);
+    const std::uint16_t hw = _float_to_half_f16c(v);
+    if (sw == hw)
+      continue;
+    const std::uint32_t em = v & 0x7fffffffu;
+    const bool is_nan = em > 0x7f800000u;
+    const bool is_denorm = (hw & 0x7fff) <= 0x400 || (sw & 0x7fff) <= 0x400;
+    const bool is_tie = (v & 0x1fffu) == 0x1000u && sw == hw + 1;
+    const int diff = int(sw & 0x7fff) - int(hw & 0x7fff);
+    REQUIRE((is_nan || (is_denorm && diff >= -1 && diff <= 1) || is_tie));
+  }
+  std::vector<std::uint16_t> h_out(f.size());
+  half::half_private::_float_to_half_n_f16c(f.data(), h_out.data(), f.size());
+  for (std::size_t i = 0; i < f.size(); ++i)
+    REQUIRE(h_out[i] == _float_to_half_f16c(f[i]));
+#endif
+}
+
+TEST_CASE("h2f_table", "[h2f_table]") {
+  std::vector<std::uint16_t> h(65536 + 9);
+  for (std::size_t i = 0; i < h.size(); ++i) {
+    h[i] = static_cast<std::uint16_t>(i * 40503u);
+    REQUIRE(half::half_to_float_table(h[i]) == half::half_to_float(h[i]));
+  }
+  const auto initial = half::active_backend();
+  for (int i = 0; i < half::backend_count; ++i) {
+    half::set_backend(static_cast<half::backend>(i));
+    std::vector<std::uint32_t> f(h.size());
+    half::half_to_float_table_n(h, f);
+    for (std::size_t j = 0; j < h.size(); ++j)
+      REQUIRE(f[j] == half::half_to_float(h[j]));
+  }
+  half::set_backend(initial);
+}
+
+TEST_CASE("native_float16", "[native_float16]") {
+  using numeric::float16_t;
+  static_assert(float16_t{1.0f} + float16_t{1.0f} == float16_t{2.0f});
+#ifdef FLOAT16_T_NATIVE_FLOAT16
+  static_assert(float16_t{3.0f} * float16_t{0.5f} == float16_t{1.5f});
+  static_assert(float16_t{3.0f} / float16_t{2.0f} == float16_t{1.5f});
+  // ties to even
+  REQUIRE(std::uint16_t(float16_t{1.00048828125f}) == 0x3c00);
+  REQUIRE(std::uint16_t(float16_t{1.00146484375f}) == 0x3c02);
+  REQUIRE(numeric::fp16_nan != numeric::fp16_nan);
+  REQUIRE(numeric::fp16_zero == numeric::fp16_zero_negative);
+
+  for (std::uint32_t i = 0; i < 65536; ++i) {
+    const float16_t h{static_cast<std::uint16_t>(i)};
+    const float f = float(h);
+    const float ref = std::bit_cast<float>(
+      half::half_to_float(static_cast<std::uint16_t>(i)));
+    REQUIRE((f == ref || (std::isnan(f) && std::isnan(ref))));
+  }
+
+  // float has more than 2 * 11 + 2 bits, so rounding the float result to
+  // half is the correctly rounded half result.
+  lcg rng{4242};
+  for (int i = 0; i < 200000; ++i) {
+    const std::uint32_t x = rng();
+    const float16_t a{static_cast<std::uint16_t>(x >> 16)};
+    const float16_t b{static_cast<std::uint16_t>(x)};
+    const auto same = [](float16_t r, float ref) {
+      return std::uint16_t(r) == std::uint16_t(float16_t{ref}) ||
+             (std::isnan(float(r)) && std::isnan(ref));
+    };
+    REQUIRE(same(a + b, float(a) + float(b)));
+    REQUIRE(same(a - b, float(a) - float(b)));
+    REQUIRE(same(a * b, float(a) * float(b)));
+    REQUIRE(same(a / b, float(a) / float(b)));
+    REQUIRE((a < b) == (float(a) < float(b)));
+  }
+#endif
+}
+
+TEST_CASE("fma", "[fma]") {
+  static_assert(half::half_fma(0x4000, 0x4200, 0x3c00) == 0x4700); // 2 * 3 + 1
+  // 1536 * 13.984375 is a tie between two halves; float drops the tiny
+  // addend that decides it, so fma in float and then rounding gives 0x753e.
+  REQUIRE(half::half_fma(0x6600, 0x4afe, 0x0c24) == 0x753f);
+  REQUIRE(numeric::fma(numeric::float16_t{std::uint16_t(0x6600)},
+                       numeric::float16_t{std::uint16_t(0x4afe)},
+                       numeric::float16_t{std::uint16_t(0x0c24)}) ==
+          numeric::float16_t{std::uint16_t(0x753f)});
+  REQUIRE(half::half_fma(0x8000, 0x3c00, 0x8000) == 0x8000); // -0 * 1 + -0
+  REQUIRE(half::half_fma(0x3c00, 0x3c00, 0xbc00) == 0x0000); // 1 * 1 - 1
+  REQUIRE(half::half_fma(0x7c00, 0x0000, 0x3c00) == 0x7e00); // inf * 0 + 1
+  REQUIRE(half::half_fma(0x7c00, 0x3c00, 0xfc00) == 0x7e00); // inf - inf
+
+  std::vector<std::uint16_t> x(65536 + 7), y(x.size()), z(x.size());
+  lcg rng{4242};
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    const std::uint32_t r = rng();
+    x[i] = static_cast<std::uint16_t>(i);
+    y[i] = static_cast<std::uint16_t>(r >> 16);
+    z[i] = static_cast<std::uint16_t>(r);
+  }
+  const auto initial = half::active_backend();
+  for (int i = 0; i < half::backend_count; ++i) {
+    half::set_backend(static_cast<half::backend>(i));
+    std::vector<std::uint16_t> out(x.size());
+    half::fma_n(x, y, z, out);
+    for (std::size_t j = 0; j < x.size(); ++j)
+      REQUIRE(out[j] == half::half_fma(x[j], y[j], z[j]));
+  }
+  half::set_backend(initial);
+}
+
+TEST_CASE("arith_n", "[arith_n]") {
+  // Every x, against random y or y close to -x so that sums cancel.
+  std::vector<std::uint16_t> x(65536 + 7), y(x.size()), out(x.size());
+  lcg rng{1234};
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    const std::uint32_t r = rng();
+    x[i] = static_cast<std::uint16_t>(i);
+    const std::uint16_t near_neg_x =
+      static_cast<std::uint16_t>((x[i] ^ 0x8000) + (r >> 29) - 3);
+    y[i] = (i & 1) ? static_cast<std::uint16_t>(r >> 16) : near_neg_x;
+  }
+  const std::uint16_t scalars[] = {0x0000, 0x8000, 0x0001, 0x03ff, 0x0400,
+                                   0x3c00, 0xc500, 0x7bff, 0x7c00, 0x7e00};
+  const auto initial = half::active_backend();
+  for (int i = 0; i < half::backend_count; ++i) {
+    half::set_backend(static_cast<half::backend>(i));
+    half::half_add_n(x, y, out);
+    for (std::size_t j = 0; j < x.size(); ++j)
+      REQUIRE(out[j] == half::half_add(x[j], y[j]));
+    half::half_sub_n(x, y, out);
+    for (std::size_t j = 0; j < x.size(); ++j)
+      REQUIRE(out[j] == half::half_sub(x[j], y[j]));
+    half::half_mul_n(x, y, out);
+    for (std::size_t j = 0; j < x.size(); ++j)
+      REQUIRE(out[j] == half::half_mul(x[j], y[j]));
+    for (const std::uint16_t s : scalars) {
+      half::half_add_n(x, s, out);
+      for (std::size_t j = 0; j < x.size(); ++j)
+        REQUIRE(out[j] == half::half_add(x[j], s));
+      half::half_sub_n(x, s, out);
+      for (std::size_t j = 0; j < x.size(); ++j)
+        REQUIRE(out[j] == half::half_sub(x[j], s));
+      half::half_mul_n(x, s, out);
+      for (std::size_t j = 0; j < x.size(); ++j)
+        REQUIRE(out[j] == half::half_mul(x[j], s));
+    }
+  }
+  half::set_backend(initial);
+}
+
+TEST_CASE("compare", "[compare]") {
+  static_assert(half::half_less(0x3c00, 0x4000));       // 1 < 2
+  static_assert(half::half_less(0xc000, 0xbc00));       // -2 < -1
+  static_assert(!half::half_less(0x8000, 0x0000));      // -0 < +0
+  static_assert(half::half_equal(0x8000, 0x0000));      // -0 == +0
+  static_assert(!half::half_equal(0x7e00, 0x7e00));     // NaN == NaN
+  static_assert(!half::half_less_equal(0x7e00, 0x7c00)); // NaN <= inf
+  static_assert(half::half_total_order(0x8000, 0x0000));
+  static_assert(!half::half_total_order(0x0000, 0x8000));
+  static_assert(half::half_total_order(0xfe00, 0xfc00)); // -NaN, -inf
+  static_assert(half::half_total_order(0x7c00, 0x7e00)); // inf, NaN
+  static_assert(half::half_total_order_mag(0x8000, 0x3c00));
+  static_assert(half::half_min(0x0000, 0x8000) == 0x8000);
+  static_assert(half::half_max(0x0000, 0x8000) == 0x0000);
+  static_assert(half::half_min(0x7e00, 0x3c00) == 0x3c00);
+  static_assert(half::half_max(0x3c00, 0x7e00) == 0x3c00);
+  static_assert(half::half_clamp(0x7e00, 0xbc00, 0x3c00) == 0x7e00);
+  static_assert(half::half_clamp(0x4000, 0xbc00, 0x3c00) == 0x3c00);
+
+  using numeric::float16_t;
+  REQUIRE(numeric::fmin(float16_t{1.0f}, float16_t{2.0f}) == float16_t{1.0f});
+  REQUIRE(numeric::total_order(numeric::fp16_zero_negative,
+                               numeric::fp16_zero));
+  lcg rng{99};
+  for (int i = 0; i < 200000; ++i) {
+    const std::uint32_t r = rng();
+    const float16_t a{static_cast<std::uint16_t>(r >> 16)};
+    const float16_t b{static_cast<std::uint16_t>(
+      (i & 1) ? r : (std::uint16_t(a) ^ ((r >> 15) & 0x8000)))};
+    REQUIRE((a < b) == (float(a) < float(b)));
+    REQUIRE((a <= b) == (float(a) <= float(b)));
+    REQUIRE((a > b) == (float(a) > float(b)));
+    REQUIRE((a >= b) == (float(a) >= float(b)));
+    REQUIRE((a == b) == (float(a) == float(b)));
+    REQUIRE((a != b) == (float(a) != float(b)));
+  }
+
+  std::vector<std::uint16_t> x(65536 + 7), y(x.size()), out(x.size());
+  const std::unique_ptr<bool[]> less_storage(new bool[x.size()]);
+  const std::span<bool> less{less_storage.get(), x.size()};
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    const std::uint32_t r = rng();
+    x[i] = static_cast<std::uint16_t>(i);
+    y[i] = static_cast<std::uint16_t>((i & 1) ? (r >> 16) : (i ^ 0x8000));
+  }
+  const auto initial = half::active_backend();
+  for (int i = 0; i < half::backend_count; ++i) {
+    half::set_backend(static_cast<half::backend>(i));
+    half::less_n(x, y, less);
+    for (std::size_t j = 0; j < x.size(); ++j)
+      REQUIRE(less[j] == half::half_less(x[j], y[j]));
+    half::min_n(x, y, out);
+    for (std::size_t j = 0; j < x.size(); ++j)
+      REQUIRE(out[j] == half::half_min(x[j], y[j]));
+    half::max_n(x, y, out);
+    for (std::size_t j = 0; j < x.size(); ++j)
+      REQUIRE(out[j] == half::half_max(x[j], y[j]));
+    half::clamp_n(x, 0xc500, 0x3c00, out); // [-5, 1]
+    for (std::size_t j = 0; j < x.size(); ++j)
+      REQUIRE(out[j] == half::half_clamp(x[j], 0xc500, 0x3c00));
+  }
+  half::set_backend(initial);
+}
+
+TEST_CASE("unary_table", "[unary_table]") {
+  std::vector<numeric::float16_t> src(65536), dst(65536);
+  for (std::size_t i = 0; i < src.size(); ++i)
+    src[i] = numeric::float16_t{static_cast<std::uint16_t>(i)};
+  auto check = [&](auto direct, auto tabulated) {
+    tabulated(src, dst);
+    for (std::size_t i = 0; i < src.size(); ++i) {
+      const std::uint16_t expected = std::uint16_t(direct(src[i]));
+      REQUIRE(std::uint16_t(tabulated(src[i])) == expected);
+      REQUIRE(std::uint16_t(dst[i]) == expected);
+    }
+  };
+  check(numeric::exp, numeric::table::exp);
+  check(numeric::tanh, numeric::table::tanh);
+  check(numeric::erf, numeric::table::erf);
+  check(numeric::floor, numeric::table::floor);
+  check(numeric::sqrt, numeric::table::sqrt);
+}
+
+TEST_CASE("sort", "[sort]") {
+  using numeric::float16_t;
+  const auto before = [](std::uint16_t a, std::uint16_t b) {
+    return a != b && half::half_total_order(a, b);
+  };
+  // Radix passes, one counting pass, and the parallel versions on 4 threads
+  // whatever the core count.
+  for (std::size_t n : {std::size_t{0}, std::size_t{1000}, std::size_t{70000},
+                        (std::size_t{1} << 20) + 3}) {
+    std::vector<float16_t> x(n);
+    lcg rng{777};
+    for (auto &v : x) {
+      const std::uint32_t r = rng();
+      v = float16_t{static_cast<std::uint16_t>(r >> 16)};
+    }
+    std::vector<std::uint16_t> expected(n);
+    for (std::size_t i = 0; i < n; ++i)
+      expected[i] = std::uint16_t(x[i]);
+    std::sort(expected.begin(), expected.end(), before);
+    std::vector<std::uint32_t> expected_indices(n);
+    std::iota(expected_indices.begin(), expected_indices.end(), 0u);
+    std::stable_sort(expected_indices.begin(), expected_indices.end(),
+                     [&](std::uint32_t a, std::uint32_t b) {
+                       return before(std::uint16_t(x[a]), std::uint16_t(x[b]));
+                     });
+
+    std::vector<float16_t> sorted = x, parallel_sorted = x;
+    std::vector<std::uint32_t> indices(n), parallel_indices(n);
+    numeric::sort(sorted);
+    numeric::parallel_sort(parallel_sorted, 4);
+    numeric::argsort(x, indices);
+    numeric::parallel_argsort(x, parallel_indices, 4);
+    for (std::size_t i = 0; i < n; ++i) {
+      REQUIRE(std::uint16_t(sorted[i]) == expected[i]);
+      REQUIRE(std::uint16_t(parallel_sorted[i]) == expected[i]);
+    }
+    REQUIRE(indices == expected_indices);
+    REQUIRE(parallel_indices == expected_indices);
+  }
+}
+
+TEST_CASE("select", "[select]") {
+  using numeric::float16_t;
+  // Reference: indices by value descending (NaNs last), then by index.
+  const auto above = [](float16_t a, float16_t b) {
+    return !std::isnan(float(a)) && (std::isnan(float(b)) || a > b);
+  };
+  const std::uint16_t nan = 0x7e00;
+  std::vector<float16_t> empty, nans(100, float16_t{nan});
+  REQUIRE(numeric::argmax(empty) == 0);
+  REQUIRE(numeric::argmax(nans) == nans.size());
+
+  std::vector<float16_t> x(70000);
+  lcg rng{4242};
+  for (auto &v : x) {
+    const std::uint32_t r = rng();
+    v = float16_t{static_cast<std::uint16_t>(r >> 16)};
+  }
+  std::vector<std::uint32_t> expected(x.size());
+  std::iota(expected.begin(), expected.end(), 0u);
+  std::stable_sort(expected.begin(), expected.end(),
+                   [&](std::uint32_t a, std::uint32_t b) {
+                     return above(x[a], x[b]);
+                   });
+  const auto initial = half::active_backend();
+  for (int i = 0; i < half::backend_count; ++i) {
+    half::set_backend(static_cast<half::backend>(i));
+    REQUIRE(numeric::argmax(x) == expected[0]);
+    // The only infinity in the tail of a block and of the span; the rest is
+    // finite, below 2 in magnitude.
+    for (std::size_t n : {std::size_t{4099}, std::size_t{69999}}) {
+      std::vector<float16_t> y(n);
+      for (std::size_t j = 0; j < n; ++j)
+        y[j] = float16_t{std::uint16_t(std::uint16_t(x[j]) & 0xbfff)};
+      y[n - 1] = float16_t{std::uint16_t(0x7c00)};
+      REQUIRE(numeric::argmax(y) == n - 1);
+    }
+  }
+  half::set_backend(initial);
+
+  std::vector<std::uint32_t> indices(x.size() + 1);
+  std::vector<float16_t> values(x.size() + 1);
+  for (std::size_t k : {std::size_t{0}, std::size_t{1}, std::size_t{50},
+                        std::size_t{4000}, x.size(), x.size() + 1}) {
+    const std::size_t count = numeric::topk(x, k, indices, values);
+    REQUIRE(count == std::min(k, x.size()));
+    for (std::size_t i = 0; i < count; ++i) {
+      REQUIRE(indices[i] == expected[i]);
+      REQUIRE(std::uint16_t(values[i]) == std::uint16_t(x[expected[i]]));
+    }
+  }
+  // Ties across the threshold are taken by index.
+  std::vector<float16_t> ties(1000, float16_t{1.0f});
+  ties[500] = float16_t{2.0f};
+  REQUIRE(numeric::topk(ties, 3, indices, values) == 3);
+  REQUIRE(indices[0] == 500);
+  REQUIRE(indices[1] == 0);
+  REQUIRE(indices[2] == 1);
+}
+
+TEST_CASE("reduce", "[reduce]") {
+  using numeric::float16_t;
+  using numeric::summation;
+  // Odd lengths leave scalar tails; 100003 spans several pairwise blocks.
+  for (std::size_t n : {std::size_t{0}, std::size_t{1}, std::size_t{77},
+                        std::size_t{100003}}) {
+    std::vector<float16_t> x(n), y(n);
+    lcg rng{99};
+    double sum = 0.0, dot = 0.0, sum_sq = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+      x[i] = float16_t{float(rng() >> 8) * 0x1p-22f - 1.0f};
+      y[i] = float16_t{float(rng() >> 8) * 0x1p-23f};
+      sum += double(float(x[i]));
+      dot += double(float(x[i])) * double(float(y[i]));
+      sum_sq += double(float(x[i])) * double(float(x[i]));
+    }
+    double squared_deviations = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+      const double deviation = double(float(x[i])) - sum / double(n);
+      squared_deviations += deviation * deviation;
+    }
+    const auto initial = half::active_backend();
+    for (int i = 0; i < half::backend_count; ++i) {
+      half::set_backend(static_cast<half::backend>(i));
+      for (summation method :
+           {summation::fast, summation::pairwise, summation::kahan}) {
+        // Relative to n, which bounds the sums of magnitudes; fast sums up
+        // to n terms in one fp32 accumulator on the scalar backend.
+        const double tolerance =
+          (method == summation::fast ? 1e-3 : 1e-4) * double(n);
+        REQUIRE(std::abs(numeric::sum(x, method) - sum) <= tolerance);
+        REQUIRE(std::abs(numeric::dot(x, y, method) - dot) <= tolerance);
+        REQUIRE(std::abs(numeric::sum_sq(x, method) - sum_sq) <= tolerance);
+        REQUIRE(std::abs(numeric::norm2(x, method) - std::sqrt(sum_sq)) <=
+                1e-5 * std::sqrt(sum_sq));
+        if (n == 0)
+          continue;
+        REQUIRE(std::abs(numeric::mean(x, method) - sum / double(n)) <= 1e-5);
+        REQUIRE(std::abs(numeric::variance(x, method) -
+                         squared_deviations / double(n)) <= 1e-5);
+      }
+    }
+    half::set_backend(initial);
+    if (n == 0)
+      REQUIRE(std::isnan(numeric::mean(x)));
+  }
+
+  // Ones after a large value: fp32 lanes lose them, Kahan keeps them.
+  std::vector<float16_t> x(1 << 20, float16_t{1.0f});
+  x[0] = float16_t{32768.0f};
+  REQUIRE(numeric::sum(x, summation::kahan) == 32768.0f + float(x.size() - 1));
+  REQUIRE(numeric::sum(x) == 32768.0f + float(x.size() - 1));
+}
+
+TEST_CASE("gemm", "[gemm]") {
+  using namespace fps;
+  // Element (i, j) of a rows x cols matrix stored with leading dimension ld.
+  const auto at = [](layout order, std::size_t ld, std::size_t i,
+                     std::size_t j) {
+    return order == layout::row_major ? i * ld + j : i + j * ld;
+  };
+  struct shape {
+    std::size_t m, n, k;
+    unsigned threads;
+  };
+  // 125 rows and 260 columns of A cross the row and panel blocks, 1030
+  // columns of C the column tiles; the last shape is split over threads.
+  const auto initial = half::active_backend();
+  for (const shape s : {shape{1, 1, 1, 1}, shape{125, 33, 260, 1},
+                        shape{9, 1030, 3, 1}, shape{130, 520, 128, 4}}) {
+    const std::size_t m = s.m, n = s.n, k = s.k;
+    lcg rng{7};
+    const auto next = [&rng] { return rng.uniform(); };
+    for (int layouts = 0; layouts < 8; ++layouts) {
+      // All row or all column major are enough to check the threads.
+      if (s.threads > 1 && layouts != 0 && layouts != 7)
+        continue;
+      const layout a_order = layouts & 1 ? layout::col_major
+                                         : layout::row_major;
+      const layout b_order = layouts & 2 ? layout::col_major
+                                         : layout::row_major;
+      const layout c_order = layouts & 4 ? layout::col_major
+                                         : layout::row_major;
+      // A has a padded leading dimension.
+      const std::size_t a_ld = (a_order == layout::row_major ? k : m) + 3;
+      const std::size_t b_ld = b_order == layout::row_major ? n : k;
+      const std::size_t c_ld = c_order == layout::row_major ? n : m;
+      const std::size_t a_lines = a_order == layout::row_major ? m : k;
+      std::vector<fp16_storage_t> a(a_ld * a_lines), b(k * n), c16(m * n);
+      std::vector<fp32_storage_t> c32(m * n);
+      for (auto &v : a)
+        v = half_of(next());
+      for (auto &v : b)
+        v = half_of(next());
+      std::vector<double> product(m * n);
+      for (std::size_t i = 0; i < m; ++i)
+        for (std::size_t j = 0; j < n; ++j)
+          for (std::size_t p = 0; p < k; ++p)
+            product[i * n + j] +=
+              double(float_of(a[at(a_order, a_ld, i, p)])) *
+              double(float_of(b[at(b_order, b_ld, p, j)]));
+      const matrix_view<const fp16_storage_t> a_view{a.data(), m, k, a_ld,
+                                                     a_order};
+      const matrix_view<const fp16_storage_t> b_view{b.data(), k, n, 0,
+                                                     b_order};
+      for (int i = 0; i < half::backend_count; ++i) {
+        if (s.threads > 1 && i != int(initial))
+          continue;
+        half::set_backend(static_cast<half::backend>(i));
+        for (const float beta : {0.0f, 2.0f}) {
+          // With beta 0 C is not read: its NaNs must not propagate.
+          std::vector<float> c0(m * n);
+          for (std::size_t e = 0; e < m * n; ++e) {
+            c0[e] = beta == 0.0f ? std::numeric_limits<float>::quiet_NaN()
+                                 : float_of(half_of(next()));
+            c32[e] = std::bit_cast<fp32_storage_t>(c0[e]);
+            c16[e] = half_of(c0[e]);
+          }
+          gemm(0.5f, a_view, b_view, beta,
+               matrix_view<fp32_storage_t>{c32.data(), m, n, c_ld, c_order},
+               s.threads);
+          gemm(0.5f, a_view, b_view, beta,
+               matrix_view<fp16_storage_t>{c16.data(), m, n, c_ld, c_order},
+               s.threads);
+          // The largest errors beyond the fp32 (and fp16) tolerances; a NaN
+          // counts as infinitely far.
+          double c32_excess = 0.0, c16_excess = 0.0;
+          for (std::size_t i = 0; i < m; ++i)
+            for (std::size_t j = 0; j < n; ++j) {
+              const std::size_t e = at(c_order, c_ld, i, j);
+              const double expected =
+                0.5 * product[i * n + j] +
+                (beta == 0.0f ? 0.0 : double(beta) * double(c0[e]));
+              const double tolerance = 1e-6 * double(k + 1);
+              c32_excess =
+                std::max(c32_excess, excess(std::bit_cast<float>(c32[e]),
+                                            expected, tolerance));
+              c16_excess = std::max(
+                c16_excess, excess(float_of(c16[e]), expected,
+                                   tolerance + std::abs(expected) * 0x1p-11));
+            }
+          REQUIRE(c32_excess <= 0.0);
+          REQUIRE(c16_excess <= 0.0);
+        }
+      }
+      half::set_backend(initial);
+    }
+  }
+}
+
+TEST_CASE("gemm_batched", "[gemm]") {
+  using namespace fps;
+  lcg rng{11};
+  const auto next = [&rng] { return half_of(rng.uniform()); };
+  // Mixed shapes and layouts, an empty product among them; each C must
+  // match a lone gemm bit for bit.
+  struct shape {
+    std::size_t m, n, k;
+    layout order;
+  };
+  const std::vector<shape> shapes{
+    {5, 7, 3, layout::row_major},   {0, 4, 4, layout::row_major},
+    {64, 64, 64, layout::col_major}, {130, 17, 300, layout::row_major},
+    {1, 40, 9, layout::col_major},   {33, 1100, 2, layout::row_major}};
+  std::vector<std::vector<fp16_storage_t>> a_data, b_data;
+  std::vector<std::vector<fp32_storage_t>> c32_data, expected32;
+  std::vector<std::vector<fp16_storage_t>> c16_data, expected16;
+  std::vector<matrix_view<const fp16_storage_t>> a, b;
+  for (const shape &s : shapes) {
+    a_data.emplace_back(s.m * s.k);
+    b_data.emplace_back(s.k * s.n);
+    for (auto &v : a_data.back())
+      v = next();
+    for (auto &v : b_data.back())
+      v = next();
+    c32_data.emplace_back(s.m * s.n, std::bit_cast<fp32_storage_t>(1.0f));
+    c16_data.emplace_back(s.m * s.n, next());
+    a.push_back({a_data.back().data(), s.m, s.k, 0, s.order});
+    b.push_back({b_data.back().data(), s.k, s.n});
+  }
+  expected32 = c32_data;
+  expected16 = c16_data;
+  std::vector<matrix_view<fp32_storage_t>> c32;
+  std::vector<matrix_view<fp16_storage_t>> c16;
+  for (std::size_t p = 0; p < shapes.size(); ++p) {
+    const shape &s = shapes[p];
+    c32.push_back({c32_data[p].data(), s.m, s.n, 0, s.order});
+    c16.push_back({c16_data[p].data(), s.m, s.n, 0, s.order});
+    gemm(0.5f, a[p], b[p], 2.0f,
+         matrix_view<fp32_storage_t>{expected32[p].data(), s.m, s.n, 0,
+                                     s.order},
+         1);
+    gemm(0.5f, a[p], b[p], 2.0f,
+         matrix_view<fp16_storage_t>{expected16[p].data(), s.m, s.n, 0,
+                                     s.order},
+         1);
+  }
+  gemm_batched(0.5f, std::span{std::as_const(a)}, std::span{std::as_const(b)},
+               2.0f, std::span{std::as_const(c32)}, 3);
+  gemm_batched(0.5f, std::span{std::as_const(a)}, std::span{std::as_const(b)},
+               2.0f, std::span{std::as_const(c16)}, 3);
+  REQUIRE(c32_data == expected32);
+  REQUIRE(c16_data == expected16);
+}
+
+TEST_CASE("gemv", "[gemv]") {
+  using namespace fps;
+  struct shape {
+    std::size_t m, n;
+    unsigned threads;
+  };
+  // 77 x 45 leaves tails after every vector width, 1100 rows cross the
+  // blocks of y and the last shape is split over threads.
+  const auto initial = half::active_backend();
+  for (const shape s : {shape{1, 1, 1}, shape{77, 45, 1},
+                        shape{1100, 70, 1}, shape{2100, 1030, 3}}) {
+    const std::size_t m = s.m, n = s.n;
+    lcg rng{5};
+    const auto next = [&rng] { return rng.uniform(); };
+    for (const layout order : {layout::row_major, layout::col_major}) {
+      // A has a padded leading dimension.
+      const std::size_t ld = (order == layout::row_major ? n : m) + 5;
+      std::vector<fp16_storage_t> a(ld * (order == layout::row_major ? m : n));
+      std::vector<fp16_storage_t> x16(n);
+      std::vector<fp32_storage_t> x32(n);
+      for (auto &v : a)
+        v = half_of(next());
+      for (std::size_t j = 0; j < n; ++j) {
+        x16[j] = half_of(next());
+        x32[j] = convert_h2f(x16[j]);
+      }
+      std::vector<double> product(m);
+      for (std::size_t i = 0; i < m; ++i)
+        for (std::size_t j = 0; j < n; ++j)
+          product[i] +=
+            double(float_of(a[order == layout::row_major ? i * ld + j
+                                                         : i + j * ld])) *
+            double(float_of(x16[j]));
+      const matrix_view<const fp16_storage_t> a_view{a.data(), m, n, ld,
+                                                     order};
+      for (int i = 0; i < half::backend_count; ++i) {
+        if (s.threads > 1 && i != int(initial))
+          continue;
+        half::set_backend(static_cast<half::backend>(i));
+        for (const float beta : {0.0f, 2.0f}) {
+          // With beta 0 y is not read: its NaNs must not propagate.
+          std::vector<float> y0(m);
+          for (auto &v : y0)
+            v = beta == 0.0f ? std::numeric_limits<float>::quiet_NaN()
+                             : float_of(half_of(next()));
+          double y32_excess = 0.0, y16_excess = 0.0;
+          for (int x_half = 0; x_half < 2; ++x_half) {
+            std::vector<fp32_storage_t> y32(m);
+            std::vector<fp16_storage_t> y16(m);
+            for (std::size_t e = 0; e < m; ++e) {
+              y32[e] = std::bit_cast<fp32_storage_t>(y0[e]);
+              y16[e] = half_of(y0[e]);
+            }
+            if (x_half) {
+              gemv(0.5f, a_view, std::span{std::as_const(x16)}, beta,
+                   std::span{y32}, s.threads);
+              gemv(0.5f, a_view, std::span{std::as_const(x16)}, beta,
+                   std::span{y16}, s.threads);
+            } else {
+              gemv(0.5f, a_view, std::span{std::as_const(x32)}, beta,
+                   std::span{y32}, s.threads);
+              gemv(0.5f, a_view, std::span{std::as_const(x32)}, beta,
+                   std::span{y16}, s.threads);
+            }
+            for (std::size_t e = 0; e < m; ++e) {
+              const double expected =
+                0.5 * product[e] +
+                (beta == 0.0f ? 0.0 : double(beta) * double(y0[e]));
+              const double tolerance = 1e-6 * double(n + 1);
+              y32_excess = std::max(
+                y32_excess,
+                excess(std::bit_cast<float>(y32[e]), expected, tolerance));
+              y16_excess = std::max(
+                y16_excess, excess(float_of(y16[e]), expected,
+                                   tolerance + std::abs(expected) * 0x1p-11));
+            }
+          }
+          REQUIRE(y32_excess <= 0.0);
+          REQUIRE(y16_excess <= 0.0);
+        }
+      }
+      half::set_backend(initial);
+    }
+  }
+}
+
+TEST_CASE("aligned_buffer", "[aligned_buffer]") {
+  using namespace fps;
+  const auto aligned = [](const void *p, std::size_t alignment) {
+    return reinterpret_cast<std::uintptr_t>(p) % alignment == 0;
+  };
+  // Padded to whole 64 byte vectors, zero past size().
+  const auto padding_zero = [](const auto &buffer) {
+    const auto *p = buffer.data();
+    return std::all_of(p + buffer.size(), p + buffer.padded_size(),
+                       [](auto v) { return v == decltype(v){}; });
+  };
+  aligned_buffer<fp16_storage_t> empty;
+  REQUIRE(empty.empty());
+  REQUIRE(empty.begin() == empty.end());
+  REQUIRE(empty.padded_size() == 0);
+
+  aligned_buffer<fp16_storage_t> h(45, fp16_storage_t{0x3c00});
+  REQUIRE(h.size() == 45);
+  REQUIRE(h.padded_size() == 64);
+  REQUIRE(aligned(h.data(), 64));
+  REQUIRE(std::count(h.begin(), h.end(), fp16_storage_t{0x3c00}) == 45);
+  REQUIRE(padding_zero(h));
+
+  aligned_buffer<float, 256> f{1.0f, 2.0f, 3.0f};
+  REQUIRE(aligned(f.data(), 256));
+  REQUIRE(f.padded_size() == 64);
+  const std::span<const float> f_span{f};
+  REQUIRE(f_span.size() == 3);
+  REQUIRE(std::accumulate(f.cbegin(), f.cend(), 0.0f) == 6.0f);
+  REQUIRE(*f.rbegin() == 3.0f);
+
+  // Copies are deep, moves take the allocation.
+  aligned_buffer<fp16_storage_t> copy = h;
+  copy[0] = fp16_storage_t{0};
+  REQUIRE(h[0] == fp16_storage_t{0x3c00});
+  const auto *storage = copy.data();
+  aligned_buffer<fp16_storage_t> moved = std::move(copy);
+  REQUIRE(moved.data() == storage);
+  REQUIRE(moved.size() == 45);
+  h = moved;
+  REQUIRE(h[0] == fp16_storage_t{0});
+
+  // Shrinking zeroes the dropped elements, growing keeps the contents.
+  h.resize(10);
+  REQUIRE(h.size() == 10);
+  REQUIRE(padding_zero(h));
+  h.resize(40);
+  REQUIRE(padding_zero(h));
+  REQUIRE(h[9] == fp16_storage_t{0x3c00});
+  REQUIRE(h[10] == fp16_storage_t{0});
+  h.resize(1000);
+  REQUIRE(h.size() == 1000);
+  REQUIRE(h.padded_size() == 1024);
+  REQUIRE(aligned(h.data(), 64));
+  REQUIRE(h[9] == fp16_storage_t{0x3c00});
+  REQUIRE(padding_zero(h));
+
+  // Large allocations hinted for huge pages start on one.
+  aligned_buffer<fp32_storage_t> large(huge_page_size / 4 + 1,
+                                       page_hint::huge);
+  REQUIRE(aligned(large.data(), huge_page_size));
+  REQUIRE(large.padded_size() == 2 * huge_page_size / 4);
+  REQUIRE(padding_zero(large));
+
+  // Sizes whose bytes do not fit are refused, as by std::vector.
+  REQUIRE_THROWS_AS(aligned_buffer<float>((std::size_t{1} << 62) + 16),
+                    std::bad_array_new_length);
+  REQUIRE_THROWS_AS(
+    aligned_buffer<fp16_storage_t>(std::numeric_limits<std::size_t>::max()),
+    std::bad_array_new_length);
+}
+
+TEST_CASE("arena", "[arena]") {
+  using namespace fps;
+  const auto aligned = [](const void *p, std::size_t alignment) {
+    return reinterpret_cast<std::uintptr_t>(p) % alignment == 0;
+  };
+  arena scratch(4096);
+  REQUIRE(scratch.allocate<float>(0).empty());
+  const auto h = scratch.allocate<fp16_storage_t>(3);
+  const auto f = scratch.allocate<float, 256>(5);
+  REQUIRE(h.size() == 3);
+  REQUIRE(aligned(h.data(), 64));
+  REQUIRE(aligned(f.data(), 256));
+  REQUIRE(scratch.stats().allocations == 2);
+  REQUIRE(scratch.stats().reserved == 4096);
+  {
+    // A scope gives back what was allocated in it.
+    const arena::scope step(scratch);
+    const auto big = scratch.allocate<fp32_storage_t>(3000);
+    REQUIRE(aligned(big.data(), 64));
+    REQUIRE(scratch.stats().reserved == 4096 + 12032);
+    REQUIRE(scratch.stats().in_use >= 2 * 64 + 12000);
+  }
+  REQUIRE(scratch.stats().in_use <= 512);
+  REQUIRE(scratch.stats().high_water >= 12000);
+  const auto again = scratch.allocate<float, 256>(5);
+  REQUIRE(again.data() != f.data());
+
+  // reset merges the blocks, and the same round then fits in one.
+  scratch.reset();
+  REQUIRE(scratch.stats().in_use == 0);
+  REQUIRE(scratch.stats().reserved == 4096 + 12032);
+  const auto first = scratch.allocate<fp16_storage_t>(3);
+  scratch.reset();
+  REQUIRE(scratch.allocate<fp16_storage_t>(3).data() == first.data());
+  scratch.reset_high_water();
+  REQUIRE(scratch.stats().high_water == 64);
+
+  // Moves take the blocks and leave the source empty but usable.
+  {
+    arena source(4096);
+    (void)source.allocate<float>(1000);
+    (void)source.allocate<float>(1000);
+    arena target(std::move(source));
+    REQUIRE(target.stats().reserved == 2 * 4096);
+    REQUIRE(source.stats().reserved == 0);
+    REQUIRE(source.stats().in_use == 0);
+    REQUIRE(source.allocate<float>(1000).size() == 1000);
+    source = std::move(target);
+    REQUIRE(source.stats().reserved == 2 * 4096);
+    REQUIRE(target.allocate<float>(1000).size() == 1000);
+  }
+  scratch.release();
+  REQUIRE(scratch.stats().reserved == 0);
+
+  buffer_pool pool;
+  const auto a = pool.allocate<fp16_storage_t>(100);
+  const auto b = pool.allocate<float, 1024>(3);
+  REQUIRE(aligned(a.data(), 256));
+  REQUIRE(aligned(b.data(), 1024));
+  REQUIRE(pool.stats().in_use == 256 + 1024);
+  pool.deallocate(a);
+  REQUIRE(pool.stats().in_use == 1024);
+  // The freed buffer serves the next allocation of its size class.
+  const auto c = pool.allocate<fp32_storage_t>(60);
+  REQUIRE(static_cast<void *>(c.data()) == static_cast<void *>(a.data()));
+  pool.deallocate(c);
+  pool.deallocate<float, 1024>(b);
+  REQUIRE(pool.stats().in_use == 0);
+  REQUIRE(pool.stats().high_water == 256 + 1024);
+  REQUIRE(pool.stats().reserved == 256 + 1024);
+  pool.release();
+  REQUIRE(pool.stats().reserved == 0);
+  REQUIRE_THROWS_AS(scratch.allocate<float>((std::size_t{1} << 62) + 16),
+                    std::bad_array_new_length);
+  REQUIRE_THROWS_AS(pool.allocate<float>((std::size_t{1} << 62) + 16),
+                    std::bad_array_new_length);
+  REQUIRE(pool.stats().allocations == 3);
+
+  // Every thread has its own.
+  arena *other = nullptr;
+  std::thread([&] { other = &thread_arena(); }).join();
+  REQUIRE(other != &thread_arena());
+  REQUIRE(&thread_buffer_pool() == &thread_buffer_pool());
+}
+
+#if FPS_HAS_TENSOR_FILE
+TEST_CASE("tensor_file", "[tensor_file]") {
+  using namespace fps;
+  const std::string path =
+    (std::filesystem::temp_directory_path() / "float16_t_test.fpst").string();
+  std::vector<fp16_storage_t> w(3 * 5 * 7);
+  for (std::size_t i = 0; i < w.size(); ++i)
+    w[i] = fp16_storage_t(i * 37);
+  const std::vector<fp32_storage_t> b(5, fp32_storage_t{0x3f800000});
+  const fp16_storage_t scale[] = {fp16_storage_t{0x3800}};
+  const std::size_t w_shape[] = {3, 5, 7}, b_shape[] = {5};
+  const tensor_source tensors[] = {
+    {"layer0.weight", w_shape, w}, {"layer0.bias", b_shape, b},
+    {"scale", {}, scale}};
+  REQUIRE(write_tensor_file(path.c_str(), tensors));
+
+  for (const map_prefetch prefetch :
+       {map_prefetch::none, map_prefetch::willneed, map_prefetch::populate}) {
+    const std::optional<tensor_file> file =
+      tensor_file::open(path.c_str(), prefetch);
+    REQUIRE(file);
+    REQUIRE(file->size() == 3);
+    const tensor_info info = file->info(0);
+    REQUIRE(info.name == "layer0.weight");
+    REQUIRE(info.dtype == tensor_dtype::fp16);
+    REQUIRE(info.rank == 3);
+    REQUIRE(info.shape[2] == 7);
+    REQUIRE(info.elements == w.size());
+    const std::span<const fp16_storage_t> w_view =
+      file->view<fp16_storage_t>(0);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(w_view.data()) % 64 == 0);
+    REQUIRE(std::equal(w_view.begin(), w_view.end(), w.begin(), w.end()));
+    // Views only of their own dtype.
+    REQUIRE(file->view<fp32_storage_t>(0).empty());
+    REQUIRE(file->find("layer0.bias") == 1);
+    REQUIRE_FALSE(file->find("layer1.bias"));
+    const std::span<const fp32_storage_t> b_view =
+      file->view<fp32_storage_t>(1);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(b_view.data()) % 64 == 0);
+    REQUIRE(std::equal(b_view.begin(), b_view.end(), b.begin(), b.end()));
+    REQUIRE(file->info(2).rank == 0);
+    REQUIRE(file->view<fp16_storage_t>(2)[0] == scale[0]);
+    file->prefetch(0);
+  }
+
+  // Malformed tensors are not written.
+  const std::size_t wrong_shape[] = {3, 5};
+  const tensor_source wrong[] = {{"w", wrong_shape, w}};
+  REQUIRE_FALSE(write_tensor_file(path.c_str(), wrong));
+  REQUIRE(errno == EINVAL);
+
+  // Nor are damaged files opened.
+  REQUIRE(write_tensor_file(path.c_str(), tensors));
+  std::filesystem::resize_file(path, 64 + 3 * 128 + 100);
+  REQUIRE_FALSE(tensor_file::open(path.c_str()));
+  REQUIRE(errno == EINVAL);
+  std::ofstream{path} << "not a tensor file";
+  REQUIRE_FALSE(tensor_file::open(path.c_str()));
+  std::filesystem::remove(path);
+  REQUIRE_FALSE(tensor_file::open(path.c_str()));
+  REQUIRE(errno == ENOENT);
+}
+#endif // FPS_HAS_TENSOR_FILE
+
+TEST_CASE("stream_converter", "[stream_converter]") {
+  using namespace fps;
+  // 10007 values cross chunks of 1000 with a short last one.
+  std::vector<fp32_storage_t> f(10007);
+  lcg rng{3};
+  for (auto &v : f)
+    v = fp32_storage_t(rng());
+  std::vector<fp16_storage_t> expected_h(f.size());
+  std::vector<fp32_storage_t> expected_f(f.size());
+  convert_f2h(f, expected_h);
+  convert_h2f(expected_h, expected_f);
+  for (const std::size_t buffers : {2, 3}) {
+    std::stringstream in, half_out, float_out;
+    in.write(reinterpret_cast<const char *>(f.data()),
+             std::streamsize(f.size() * 4));
+    stream_result result =
+      stream_converter(stream_conversion::f32_to_f16, 1000, buffers)
+        .run(istream_source(in), ostream_sink(half_out));
+    REQUIRE(result.ok);
+    REQUIRE(result.elements == f.size());
+    const std::string h = half_out.str();
+    REQUIRE(h.size() == f.size() * 2);
+    REQUIRE(std::memcmp(h.data(), expected_h.data(), h.size()) == 0);
+    result = stream_converter(stream_conversion::f16_to_f32, 1000, buffers)
+               .run(istream_source(half_out), ostream_sink(float_out));
+    REQUIRE(result.ok);
+    const std::string back = float_out.str();
+    REQUIRE(back.size() == f.size() * 4);
+    REQUIRE(std::memcmp(back.data(), expected_f.data(), back.size()) == 0);
+  }
+
+#if FPS_HAS_FD_STREAMS
+  // Through file descriptors, with a chunk boundary at the end.
+  std::FILE *src = std::tmpfile(), *dst = std::tmpfile();
+  REQUIRE(src);
+  REQUIRE(dst);
+  REQUIRE(std::fwrite(f.data(), 4, 10000, src) == 10000);
+  std::rewind(src);
+  const stream_result fd_result =
+    stream_converter(stream_conversion::f32_to_f16, 2500)
+      .run(fd_source(fileno(src)), fd_sink(fileno(dst)));
+  REQUIRE(fd_result.ok);
+  REQUIRE(fd_result.elements == 10000);
+  std::rewind(dst);
+  std::vector<fp16_storage_t> h(10001);
+  REQUIRE(std::fread(h.data(), 2, h.size(), dst) == 10000);
+  REQUIRE(std::equal(h.begin(), h.begin() + 10000, expected_h.begin()));
+  std::fclose(src);
+  std::fclose(dst);
+#endif // FPS_HAS_FD_STREAMS
+
+  // A stray byte at the end, and a failing sink.
+  std::stringstream odd(std::string(7, '\0')), odd_out;
+  stream_result result = stream_converter(stream_conversion::f16_to_f32, 4)
+                           .run(istream_source(odd), ostream_sink(odd_out));
+  REQUIRE_FALSE(result.ok);
+  REQUIRE(result.elements == 3);
+  std::stringstream many(std::string(4000, '\0'));
+  std::size_t calls = 0;
+  result = stream_converter(stream_conversion::f32_to_f16, 100)
+             .run(istream_source(many), [&](std::span<const std::byte>) {
+               return ++calls < 3;
+             });
+  REQUIRE_FALSE(result.ok);
+  REQUIRE(result.elements == 200);
+  REQUIRE(calls == 3);
+
+  // Exceptions from either end reach the caller after the workers stop.
+  std::stringstream short_in(std::string(10, '\0')), short_out;
+  short_in.exceptions(std::ios::failbit);
+  REQUIRE_THROWS_AS(stream_converter(stream_conversion::f32_to_f16, 4)
+                      .run(istream_source(short_in), ostream_sink(short_out)),
+                    std::ios::failure);
+  std::stringstream long_in(std::string(4000, '\0'));
+  calls = 0;
+  REQUIRE_THROWS_AS(
+    stream_converter(stream_conversion::f32_to_f16, 100)
+      .run(istream_source(long_in),
+           [&](std::span<const std::byte>) -> bool {
+             if (++calls == 2)
+               throw std::runtime_error("sink");
+             return true;
+           }),
+    std::runtime_error);
+  REQUIRE(calls == 2);
+}
+
+TEST_CASE("parallel_for", "[parallel]") {
+  half::thread_pool pool(4);
+  REQUIRE(pool.concurrency() == 4);
+  half::executor *const previous = half::set_executor(&pool);
+  REQUIRE(&half::active_executor() == &pool);
+
+  // Chunks cover the span once, with inner bounds on its cache lines.
+  fps::aligned_buffer<std::uint16_t> buffer(10003);
+  const std::span<std::uint16_t> out = std::span{buffer}.subspan(3);
+  std::mutex mutex;
+  std::vector<std::pair<std::size_t, std::size_t>> chunks;
+  half::parallel_for(
+    out,
+    [&](std::size_t begin, std::size_t end) {
+      const std::lock_guard lock(mutex);
+      chunks.emplace_back(begin, end);
+    },
+    100);
+  REQUIRE(chunks.size() > 1);
+  std::sort(chunks.begin(), chunks.end());
+  REQUIRE(chunks.front().first == 0);
+  REQUIRE(chunks.back().second == out.size());
+  for (std::size_t i = 1; i < chunks.size(); ++i) {
+    REQUIRE(chunks[i].first == chunks[i - 1].second);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(&out[chunks[i].first]) % 64 ==
+            0);
+  }
+
+  // Under two grains everything runs at once on the calling thread.
+  std::size_t calls = 0;
+  half::parallel_for(
+    std::size_t{199},
+    [&](std::size_t begin, std::size_t end) {
+      ++calls;
+      REQUIRE(begin == 0);
+      REQUIRE(end == 199);
+    },
+    100);
+  REQUIRE(calls == 1);
+
+  // Nested loops run the inner one serially instead of deadlocking.
+  std::atomic<std::size_t> total{0};
+  half::parallel_for(
+    std::size_t{1000},
+    [&](std::size_t begin, std::size_t end) {
+      half::parallel_for(
+        end - begin,
+        [&](std::size_t b, std::size_t e) { total += e - b; }, 10);
+    },
+    10);
+  REQUIRE(total == 1000);
+
+  // What a task throws reaches the caller, and the pool runs on.
+  const auto throw_in_chunk = [](std::size_t begin, std::size_t) {
+    if (begin != 0)
+      throw std::runtime_error("chunk");
+  };
+  REQUIRE_THROWS_AS(half::parallel_for(std::size_t{1000}, throw_in_chunk, 10),
+                    std::runtime_error);
+  const auto throw_in_task = [](unsigned t) {
+    if (t == 3)
+      throw std::bad_alloc();
+  };
+  REQUIRE_THROWS_AS(half::half_private::_on_threads(4, throw_in_task),
+                    std::bad_alloc);
+  total = 0;
+  half::parallel_for(
+    std::size_t{1000}, [&](std::size_t b, std::size_t e) { total += e - b; },
+    10);
+  REQUIRE(total == 1000);
+
+  // The bulk functions give the same bits in chunks as in one piece.
+  const std::size_t n = 100003;
+  std::vector<std::uint16_t> x(n), y(n), z(n);
+  std::vector<std::uint32_t> f(n);
+  lcg rng{11};
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::uint32_t r = rng();
+    x[i] = std::uint16_t(r >> 16);
+    y[i] = std::uint16_t(r);
+    z[i] = std::uint16_t(r >> 8);
+    f[i] = r;
+  }
+  const auto run_all = [&] {
+    std::vector<std::vector<std::uint16_t>> h(6, std::vector<std::uint16_t>(n));
+    std::vector<std::uint32_t> wide(n);
+    half::float_to_half_n(f, h[0]);
+    half::half_to_float_n(x, wide);
+    half::half_add_n(x, y, h[1]);
+    half::half_mul_n(x, y[0], h[2]);
+    half::fma_n(x, y, z, h[3]);
+    half::clamp_n(x, 0xbc00, 0x3c00, h[4]);
+    fps::convert_f2h(
+      std::span{reinterpret_cast<const fps::fp32_storage_t *>(f.data()), n},
+      std::span{reinterpret_cast<fps::fp16_storage_t *>(h[5].data()), n});
+    return std::pair{h, wide};
+  };
+  // So do the pairwise reductions; fast and kahan add per-chunk sums.
+  std::vector<numeric::float16_t> v(n);
+  for (auto &e : v)
+    e = numeric::float16_t{float(int(rng() % 2001) - 1000) / 64.0f};
+  const auto reduce_all = [&] {
+    using numeric::summation;
+    return std::vector{numeric::sum(v), numeric::dot(v, v),
+                       numeric::sum_sq(v), numeric::variance(v),
+                       numeric::sum(v, summation::kahan)};
+  };
+  half::serial_executor serial;
+  half::set_executor(&serial);
+  const auto expected = run_all();
+  const auto expected_sums = reduce_all();
+  half::set_executor(&pool);
+  const std::size_t grain = half::set_parallel_grain(64);
+  REQUIRE(half::parallel_grain() == 64);
+  REQUIRE(run_all() == expected);
+  const auto sums = reduce_all();
+  for (std::size_t i = 0; i < 4; ++i)
+    REQUIRE(sums[i] == expected_sums[i]);
+  REQUIRE(std::abs(sums[4] - expected_sums[4]) <= 1.0f);
+
+  half::set_parallel_grain(grain);
+  half::set_executor(previous);
+}
+
+TEST_CASE("execution policies", "[execution]") {
+  half::thread_pool pool(4);
+  half::executor *const previous = half::set_executor(&pool);
+  const std::size_t grain = half::set_parallel_grain(64);
+
+  // Every policy keeps the dispatched kernels, in the tasks of par as well.
+  const half::backend initial = half::active_backend();
+  {
+    const half::half_private::_policy_scope<std::execution::parallel_policy>
+      scope;
+    std::atomic<bool> dispatched{true};
+    half::parallel_for(
+      std::size_t{10000},
+      [&](std::size_t, std::size_t) {
+        if (half::active_backend() != initial)
+          dispatched = false;
+      },
+      64);
+    REQUIRE(dispatched);
+  }
+  {
+    const half::half_private::_policy_scope<
+      const std::execution::sequenced_policy &>
+      scope;
+    REQUIRE(half::active_backend() == initial);
+  }
+
+  const std::size_t n = 100003;
+  std::vector<std::uint16_t> x(n), y(n), z(n);
+  std::vector<std::uint32_t> f(n);
+  std::vector<numeric::float16_t> v(n), w(n);
+  lcg rng{5};
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::uint32_t r = rng();
+    x[i] = std::uint16_t(r >> 16);
+    y[i] = std::uint16_t(r);
+    z[i] = std::uint16_t(r >> 8);
+    f[i] = r;
+    v[i] = numeric::float16_t{std::uint16_t(0x3c00 | (r >> 22))};
+    w[i] = numeric::float16_t{std::uint16_t(0xb800 | (r & 0x3ff))};
+  }
+  std::vector<std::uint16_t> h(n), expected_h(n);
+  std::vector<std::uint32_t> wide(n), expected_wide(n);
+  std::vector<numeric::float16_t> t(n), expected_t(n);
+  half::float_to_half_n(f, expected_h);
+  half::half_to_float_n(x, expected_wide);
+  numeric::table::tanh(std::span<const numeric::float16_t>(w), expected_t);
+  const auto same = [](const auto &a, const auto &b) {
+    return std::memcmp(a.data(), b.data(), a.size() * sizeof(a[0])) == 0;
+  };
+  const std::span<const fps::fp32_storage_t> f_storage{
+    reinterpret_cast<const fps::fp32_storage_t *>(f.data()), n};
+  std::vector<fps::fp16_storage_t> expected_f2h(n);
+  fps::convert_f2h(f_storage, expected_f2h);
+  const auto check = [&](const auto &policy) {
+    half::float_to_half_n(policy, f, h);
+    REQUIRE(same(h, expected_h));
+    half::half_to_float_n(policy, x, wide);
+    REQUIRE(wide == expected_wide);
+    fps::convert_f2h(
+      policy, f_storage,
+      std::span{reinterpret_cast<fps::fp16_storage_t *>(h.data()), n});
+    REQUIRE(same(h, expected_f2h));
+    numeric::table::tanh(policy, std::span<const numeric::float16_t>(w), t);
+    REQUIRE(same(t, expected_t));
+    std::vector<std::uint16_t> a(n), b(n);
+    half::half_add_n(x, y, a);
+    half::half_add_n(policy, x, y, b);
+    REQUIRE(a == b);
+    half::fma_n(x, y, z, a);
+    half::fma_n(policy, x, y, z, b);
+    REQUIRE(a == b);
+    half::clamp_n(x, 0xbc00, 0x3c00, a);
+    half::clamp_n(policy, x, 0xbc00, 0x3c00, b);
+    REQUIRE(a == b);
+  };
+  check(std::execution::seq);
+  check(std::execution::unseq);
+  check(std::execution::par);
+  check(std::execution::par_unseq);
+
+  // Pairwise sums split over threads add up like one pass.
+  using numeric::summation;
+  const float seq_sum = numeric::sum(std::execution::seq, v);
+  REQUIRE(std::bit_cast<std::uint32_t>(seq_sum) ==
+          std::bit_cast<std::uint32_t>(numeric::sum(v)));
+  REQUIRE(std::bit_cast<std::uint32_t>(numeric::sum(std::execution::par, v)) ==
+          std::bit_cast<std::uint32_t>(seq_sum));
+  REQUIRE(std::bit_cast<std::uint32_t>(
+            numeric::sum(std::execution::par_unseq, v)) ==
+          std::bit_cast<std::uint32_t>(numeric::sum(v)));
+  REQUIRE(std::bit_cast<std::uint32_t>(
+            numeric::dot(std::execution::par_unseq, v, w)) ==
+          std::bit_cast<std::uint32_t>(numeric::dot(v, w)));
+  REQUIRE(std::bit_cast<std::uint32_t>(
+            numeric::variance(std::execution::par_unseq, w)) ==
+          std::bit_cast<std::uint32_t>(numeric::variance(w)));
+  for (const summation method : {summation::fast, summation::kahan}) {
+    const float serial = numeric::sum_sq(v, method);
+    REQUIRE(std::abs(numeric::sum_sq(std::execution::par_unseq, v, method) -
+                     serial) <= 1e-5f * serial);
+    REQUIRE(std::abs(numeric::norm2(std::execution::par, v, method) -
+                     std::sqrt(serial)) <= 1e-5f * std::sqrt(serial));
+  }
+  REQUIRE(std::abs(numeric::mean(std::execution::seq, v) - seq_sum / n) ==
+          0.0f);
+
+  half::set_parallel_grain(grain);
+  half::set_executor(previous);
+}
+
+TEST_CASE("float_to_half_n_stats", "[convert_stats]") {
+  // Random bits (a NaN in 256), and values that overflow, underflow, turn
+  // subnormal or stay normal, with a few infinities and negative zero.
+  const std::size_t n = 100003;
+  std::vector<std::uint32_t> f(n);
+  lcg rng{17};
+  const float scaled[] = {0x1p-30f, 0x1p-20f, 0x1p-10f, 1.0f, 0x1p10f,
+                          0x1p20f};
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::uint32_t r = rng();
+    const float value = scaled[(r >> 8) % 6] * (float(r >> 16) / 0x1p15f);
+    f[i] = i % 3 == 0 ? r : std::bit_cast<std::uint32_t>(value);
+  }
+  f[5] = 0x7f800000u;
+  f[n - 1] = 0xff800000u;
+  f[77] = 0x80000000u;
+
+  half::conversion_stats expected;
+  std::uint32_t absmax = 0;
+  std::vector<std::uint16_t> expected_h(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::uint16_t h = half::float_to_half(f[i]);
+    expected_h[i] = h;
+    const std::uint32_t f_abs = f[i] & 0x7fffffffu;
+    const std::uint16_t h_abs = h & 0x7fff;
+    if (f_abs > 0x7f800000u) {
+      ++expected.nan;
+      continue;
+    }
+    expected.inf += f_abs == 0x7f800000u;
+    expected.overflow += h_abs == 0x7c00 && f_abs != 0x7f800000u;
+    expected.underflow += h_abs == 0 && f_abs != 0;
+    expected.subnormal += h_abs != 0 && h_abs < 0x400;
+    expected.min = std::min(expected.min, std::bit_cast<float>(f[i]));
+    expected.max = std::max(expected.max, std::bit_cast<float>(f[i]));
+    absmax = std::max(absmax, f_abs);
+  }
+  expected.absmax = std::bit_cast<float>(absmax);
+  REQUIRE(expected.overflow > 0);
+  REQUIRE(expected.underflow > 0);
+  REQUIRE(expected.subnormal > 0);
+  REQUIRE(expected.inf == 2);
+  REQUIRE(expected.nan > 0);
+  REQUIRE_FALSE(expected.finite());
+
+  const auto check = [&](std::size_t count) {
+    std::vector<std::uint16_t> h(count);
+    const half::conversion_stats stats = half::float_to_half_n_stats(
+      std::span<const std::uint32_t>(f).first(count), h);
+    REQUIRE(std::equal(h.begin(), h.end(), expected_h.begin()));
+    return stats;
+  };
+  half::thread_pool pool(4);
+  half::executor *const previous = half::set_executor(&pool);
+  const std::size_t grain = half::parallel_grain();
+  const auto initial = half::active_backend();
+  for (int i = 0; i < half::backend_count; ++i) {
+    half::set_backend(static_cast<half::backend>(i));
+    for (const std::size_t g : {grain, std::size_t{64}}) {
+      half::set_parallel_grain(g);
+      const half::conversion_stats stats = check(n);
+      REQUIRE(stats.overflow == expected.overflow);
+      REQUIRE(stats.underflow == expected.underflow);
+      REQUIRE(stats.subnormal == expected.subnormal);
+      REQUIRE(stats.inf == expected.inf);
+      REQUIRE(stats.nan == expected.nan);
+      REQUIRE(stats.min == expected.min);
+      REQUIRE(stats.max == expected.max);
+      REQUIRE(stats.absmax == expected.absmax);
+    }
+    // No inputs, and only NaNs.
+    const half::conversion_stats empty = check(0);
+    REQUIRE(empty.finite());
+    REQUIRE(empty.min == HUGE_VALF);
+    REQUIRE(empty.max == -HUGE_VALF);
+    REQUIRE(empty.absmax == 0.0f);
+    const std::vector<std::uint32_t> nans(37, 0xffc00001u);
+    std::vector<std::uint16_t> h(37);
+    const half::conversion_stats nan_stats =
+      half::float_to_half_n_stats(nans, h);
+    REQUIRE(nan_stats.nan == 37);
+    REQUIRE(nan_stats.min == HUGE_VALF);
+    REQUIRE(nan_stats.absmax == 0.0f);
+  }
+  half::set_backend(initial);
+  half::set_parallel_grain(grain);
+  half::set_executor(previous);
+}
+
+TEST_CASE("classification", "[finite]") {
+  for (std::uint32_t bits = 0; bits < 0x10000; ++bits) {
+    const numeric::float16_t h{std::uint16_t(bits)};
+    const float f = std::bit_cast<float>(half::half_to_float(bits));
+    REQUIRE(numeric::is_nan(h) == std::isnan(f));
+    REQUIRE(numeric::is_inf(h) == std::isinf(f));
+    REQUIRE(numeric::is_finite(h) == std::isfinite(f));
+    // Subnormal halves widen to normal floats.
+    REQUIRE(numeric::is_normal(h) ==
+            (std::isfinite(f) && std::abs(f) >= 0x1p-14f));
+  }
+}
+
+TEST_CASE("all_finite", "[finite]") {
+  using numeric::float16_t;
+  half::thread_pool pool(4);
+  half::executor *const previous = half::set_executor(&pool);
+  const std::size_t grain = half::parallel_grain();
+  const auto initial = half::active_backend();
+  const std::size_t n = 100003;
+  std::vector<float16_t> x(n);
+  for (std::size_t i = 0; i < n; ++i)
+    x[i] = float16_t{std::uint16_t(i % 0x7c00 | (i & 1) << 15)};
+  for (int b = 0; b < half::backend_count; ++b) {
+    half::set_backend(static_cast<half::backend>(b));
+    for (const std::size_t g : {grain, std::size_t{64}}) {
+      half::set_parallel_grain(g);
+      REQUIRE(numeric::all_finite(x));
+      REQUIRE(numeric::all_finite(std::span<const float16_t>()));
+      // An infinity or a NaN anywhere, in the vector part or the tail.
+      for (const std::size_t at : {std::size_t{0}, std::size_t{37},
+                                   std::size_t{0x4000}, n - 1}) {
+        for (const std::uint16_t bad : {0x7c00, 0xfc00, 0x7e00, 0xfd01}) {
+          const float16_t saved = x[at];
+          x[at] = float16_t{bad};
+          REQUIRE_FALSE(numeric::all_finite(x));
+          REQUIRE_FALSE(numeric::all_finite(std::execution::par_unseq, x));
+          REQUIRE(numeric::all_finite(
+                    std::span<const float16_t>(x).first(at)));
+          x[at] = saved;
+        }
+      }
+    }
+  }
+  half::set_backend(initial);
+  half::set_parallel_grain(grain);
+  half::set_executor(previous);
+}
+
+TEST_CASE("loss_scaler", "[loss_scaler]") {
+  using numeric::float16_t;
+  half::thread_pool pool(4);
+  half::executor *const previous = half::set_executor(&pool);
+  const std::size_t grain = half::parallel_grain();
+  const auto initial = half::active_backend();
+
+  // Buffers of odd and empty sizes, unscaled in one pass: the same bits as
+  // dividing each gradient in fp32, on every backend.
+  const std::size_t sizes[] = {0, 1, 77, 0, 40000, 3, 100003, 0};
+  std::vector<std::vector<float16_t>> gradients;
+  lcg rng{5};
+  for (const std::size_t size : sizes) {
+    std::vector<float16_t> g(size);
+    for (float16_t &v : g) {
+      const std::uint32_t r = rng();
+      v = float16_t{std::uint16_t((r >> 16) % 0x7c00 | (r & 0x8000))};
+    }
+    gradients.push_back(std::move(g));
+  }
+  for (int b = 0; b < half::backend_count; ++b) {
+    half::set_backend(static_cast<half::backend>(b));
+    for (const std::size_t g : {grain, std::size_t{64}}) {
+      half::set_parallel_grain(g);
+      for (const float scale : {0x1p12f, 3.0f, 0.25f}) {
+        std::vector<std::vector<float16_t>> unscaled = gradients;
+        std::vector<std::span<float16_t>> spans(unscaled.begin(),
+                                                unscaled.end());
+        const numeric::loss_scaler scaler(scale);
+        const bool finite = scaler.unscale(spans);
+        bool expected_finite = true;
+        for (std::size_t k = 0; k < gradients.size(); ++k) {
+          for (std::size_t i = 0; i < gradients[k].size(); ++i) {
+            const std::uint16_t h = std::uint16_t(gradients[k][i]);
+            const float f = std::bit_cast<float>(half::half_to_float(h));
+            const std::uint16_t expected = half::float_to_half(
+              std::bit_cast<std::uint32_t>(f * (1.0f / scale)));
+            expected_finite &= numeric::is_finite(float16_t{expected});
+            if (scale != 0.25f)
+              REQUIRE(std::uint16_t(unscaled[k][i]) == expected);
+          }
+        }
+        // Under a scale below one, large gradients overflow.
+        REQUIRE(expected_finite == (scale != 0.25f));
+        REQUIRE(finite == expected_finite);
+
+        // Into fp32 master gradients, which do not overflow.
+        std::vector<std::vector<float>> master;
+        for (const std::vector<float16_t> &k : gradients)
+          master.emplace_back(k.size());
+        const std::vector<std::span<const float16_t>> inputs(gradients.begin(),
+                                                             gradients.end());
+        const std::vector<std::span<float>> outputs(master.begin(),
+                                                    master.end());
+        REQUIRE(scaler.unscale(inputs, outputs));
+        for (std::size_t k = 0; k < gradients.size(); ++k) {
+          for (std::size_t i = 0; i < gradients[k].size(); ++i) {
+            const float f = std::bit_cast<float>(
+              half::half_to_float(std::uint16_t(gradients[k][i])));
+            REQUIRE(std::bit_cast<std::uint32_t>(master[k][i]) ==
+                    std::bit_cast<std::uint32_t>(f * (1.0f / scale)));
+          }
+        }
+      }
+
+      // A NaN in the last buffer, an infinity in the first non-empty one.
+      for (const std::size_t k : {std::size_t{6}, std::size_t{1}}) {
+        std::vector<std::vector<float16_t>> unscaled = gradients;
+        unscaled[k].back() = float16_t{std::uint16_t(k == 6 ? 0x7e00 : 0xfc00)};
+        std::vector<std::span<float16_t>> spans(unscaled.begin(),
+                                                unscaled.end());
+        REQUIRE_FALSE(numeric::loss_scaler().unscale(spans));
+        std::vector<std::vector<float>> master;
+        for (const std::vector<float16_t> &u : unscaled)
+          master.emplace_back(u.size());
+        const std::vector<std::span<const float16_t>> inputs(unscaled.begin(),
+                                                             unscaled.end());
+        const std::vector<std::span<float>> outputs(master.begin(),
+                                                    master.end());
+        REQUIRE_FALSE(numeric::loss_scaler().unscale(inputs, outputs));
+      }
+    }
+  }
+  half::set_backend(initial);
+  half::set_parallel_grain(grain);
+  half::set_executor(previous);
+
+  // Grows after growth_interval finite steps, backs off on an overflow, and
+  // does not grow past the largest float.
+  std::vector<float16_t> g(100, float16_t{1.0f});
+  const std::span<float16_t> spans[] = {g};
+  numeric::loss_scaler scaler(1024.0f, 2.0f, 0.5f, 3);
+  REQUIRE(scaler.step(spans));
+  REQUIRE(scaler.step(spans));
+  REQUIRE(scaler.scale() == 1024.0f);
+  REQUIRE(scaler.good_steps() == 2);
+  REQUIRE(scaler.step(spans));
+  REQUIRE(scaler.scale() == 2048.0f);
+  REQUIRE(scaler.good_steps() == 0);
+  g[50] = float16_t{std::uint16_t(0x7c00)};
+  REQUIRE_FALSE(scaler.step(spans));
+  REQUIRE(scaler.scale() == 1024.0f);
+  REQUIRE(scaler.good_steps() == 0);
+  numeric::loss_scaler large(0x1p127f, 2.0f, 0.5f, 1);
+  large.update(true);
+  REQUIRE(large.scale() == 0x1p127f);
+
+  // Small gradients flush in place but not into fp32, over the shorter of
+  // each pair of buffers.
+  std::vector<float16_t> small(3, float16_t{std::uint16_t(0x0400)});
+  std::vector<float> master(2, 1.0f), extra(5, 1.0f);
+  const std::span<const float16_t> small_in[] = {small};
+  const std::span<float> master_out[] = {master, extra};
+  numeric::loss_scaler fine(0x1p16f);
+  REQUIRE(fine.step(small_in, master_out));
+  REQUIRE(fine.good_steps() == 1);
+  REQUIRE(master[0] == 0x1p-30f);
+  REQUIRE(master[1] == 0x1p-30f);
+  REQUIRE(extra[0] == 1.0f);
+  const std::span<float16_t> small_spans[] = {small};
+  REQUIRE(fine.unscale(small_spans));
+  REQUIRE(std::uint16_t(small[0]) == 0);
+}